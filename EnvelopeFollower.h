@@ -3,64 +3,170 @@
 #define ENVELOPEFOLLOWER_H
 
 #include <cmath>
-#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
 
-template <int Channels = 2, typename Value = double>
+/**
+ * @brief Block-based single precision envelope follower with an optional
+ * three band split and peak / RMS detectors.
+ *
+ * Only the (band, detector) pairs enabled with SetActive() are computed, and
+ * the crossover is skipped entirely while only the broadband signal is
+ * followed. The split is a pair of one-pole lowpasses: low is the lower
+ * lowpass, mid the difference between the two and high the remainder, so
+ * the three bands always sum back to the input.
+ */
+template <int Channels = 2>
 class EnvelopeFollower
 {
 public:
+    enum Band
+    {
+        Full,
+        Low,
+        Mid,
+        High,
+        NUM_BANDS
+    };
+
+    enum Detector
+    {
+        Peak,
+        Rms,
+        NUM_DETECTORS
+    };
+
+    static constexpr uint32_t Bit(int band, int detector)
+    {
+        return 1u << (band * NUM_DETECTORS + detector);
+    }
+
+    static const uint32_t DEFAULT_ACTIVE = 1u; // Bit(Full, Peak)
+
     EnvelopeFollower()
     {
-        for (int i = 0; i < Channels; i++)
-            m_env[i] = 0;
+        for (int c = 0; c < Channels; c++)
+        {
+            lp_low_[c] = lp_high_[c] = 0.f;
+            for (int b = 0; b < NUM_BANDS; b++)
+                for (int d = 0; d < NUM_DETECTORS; d++)
+                    state_[c][b][d] = out_[c][b][d] = 0.f;
+        }
+        active_ = DEFAULT_ACTIVE;
     }
 
-    Value operator[](int channel) const
+    /** Broadband peak envelope, kept for existing callers. */
+    float operator[](int channel) const
     {
-        return m_env[channel];
+        return out_[channel][Full][Peak];
     }
 
-    void Setup(int sampleRate, double attackMs, double releaseMs)
+    float Get(int channel, int band, int detector) const
     {
-        m_a = pow(0.01, 1.0 / (attackMs * sampleRate * 0.001));
-        m_r = pow(0.01, 1.0 / (releaseMs * sampleRate * 0.001));
+        return out_[channel][band][detector];
     }
 
-    void Process(size_t samples, Value **src)
+    void Setup(float sampleRate, float attackMs, float releaseMs,
+               float lowCrossoverHz = 250.f, float highCrossoverHz = 2500.f)
     {
-        for (int i = 0; i < Channels; i++)
-        {
-            const Value *cur = src[i];
-            double e = m_env[i];
+        m_a = powf(0.01f, 1.f / (attackMs * sampleRate * 0.001f));
+        m_r = powf(0.01f, 1.f / (releaseMs * sampleRate * 0.001f));
+        c_low_ = 1.f - expf(-6.2831853f * lowCrossoverHz / sampleRate);
+        c_high_ = 1.f - expf(-6.2831853f * highCrossoverHz / sampleRate);
+    }
+
+    /** @param mask OR of Bit(band, detector) for every output that will be read */
+    void SetActive(uint32_t mask) { active_ = mask; }
+    uint32_t GetActive() const { return active_; }
 
-            for (int n = samples; n; n--)
+    void Process(size_t samples, float **src)
+    {
+        const uint32_t split_mask = ~(Bit(Full, Peak) | Bit(Full, Rms));
+        const bool split = (active_ & split_mask) != 0;
+
+        for (int c = 0; c < Channels; c++)
+        {
+            const float *in = src[c];
+            size_t done = 0;
+            while (done < samples)
             {
-                double v = std::abs(*cur++);
-                if (v > e)
-                    e = m_a * (e - v) + v;
-                else
-                    e = m_r * (e - v) + v;
+                size_t n = samples - done;
+                if (n > CHUNK)
+                    n = CHUNK;
+
+                const float *band_src[NUM_BANDS] = {in + done, nullptr, nullptr, nullptr};
+                if (split)
+                {
+                    Split(c, in + done, n);
+                    band_src[Low] = scratch_[0];
+                    band_src[Mid] = scratch_[1];
+                    band_src[High] = scratch_[2];
+                }
+
+                for (int b = 0; b < NUM_BANDS; b++)
+                {
+                    if (active_ & Bit(b, Peak))
+                        state_[c][b][Peak] = FollowPeak(band_src[b], n, state_[c][b][Peak]);
+                    if (active_ & Bit(b, Rms))
+                        state_[c][b][Rms] = FollowSquare(band_src[b], n, state_[c][b][Rms]);
+                }
+                done += n;
             }
-            m_env[i] = e;
 
-            if (++last32posstepped == 24)
+            for (int b = 0; b < NUM_BANDS; b++)
             {
-                last32[i][last32pos] = e * -1.f;
-                if (++last32pos == 64)
-                    last32pos = 0;
-                last32posstepped = 0;
+                out_[c][b][Peak] = state_[c][b][Peak];
+                out_[c][b][Rms] = sqrtf(state_[c][b][Rms]);
             }
         }
     }
 
-    float last32[2][64];
-    int last32pos = 0;
-    int last32posstepped = 0;
-    double m_env[Channels];
+private:
+    static const size_t CHUNK = 96;
+
+    void Split(int c, const float *in, size_t n)
+    {
+        float l1 = lp_low_[c], l2 = lp_high_[c];
+        for (size_t i = 0; i < n; i++)
+        {
+            l1 += c_low_ * (in[i] - l1);
+            l2 += c_high_ * (in[i] - l2);
+            scratch_[0][i] = l1;
+            scratch_[1][i] = l2 - l1;
+            scratch_[2][i] = in[i] - l2;
+        }
+        lp_low_[c] = l1;
+        lp_high_[c] = l2;
+    }
+
+    float FollowPeak(const float *in, size_t n, float e) const
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            float v = fabsf(in[i]);
+            e = v + (v > e ? m_a : m_r) * (e - v);
+        }
+        return e;
+    }
+
+    float FollowSquare(const float *in, size_t n, float e) const
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            float v = in[i] * in[i];
+            e = v + (v > e ? m_a : m_r) * (e - v);
+        }
+        return e;
+    }
 
-protected:
-    double m_a; // Attack coefficient
-    double m_r; // Release coefficient
+    float m_a = 0.f; // Attack coefficient
+    float m_r = 0.f; // Release coefficient
+    float c_low_ = 0.f, c_high_ = 0.f;
+    float lp_low_[Channels], lp_high_[Channels];
+    float state_[Channels][NUM_BANDS][NUM_DETECTORS]; // RMS state holds mean square
+    float out_[Channels][NUM_BANDS][NUM_DETECTORS];
+    float scratch_[3][CHUNK];
+    uint32_t active_;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -2,7 +2,8 @@
 #include "dpt/daisy_dpt.h"
 #include "KaliDelayLine.h"
 #include "ParameterInterpolator.h"
-#include "dev/oled_ssd130x.h"
+#include "KaliOledDriver.h"
+#include "KaliTextCache.h"
 #include "util/oled_fonts.h"
 #include "util/hal_map.h"
 #include "dev/leddriver.h"
@@ -11,6 +12,7 @@
 #include "KaliFIR.h"
 #include "stringtables.h"
 #include "PresetNameGenerator.h"
+#include "KaliPresetLayout.h"
 #include "stdio.h"
 #include <memory>
 #include <algorithm>
@@ -22,6 +24,12 @@ static KaliDelayLine<float, MAX_DELAY> DSY_SDRAM_BSS delayl;
 static KaliDelayLine<float, MAX_DELAY> DSY_SDRAM_BSS delayr;
 static KaliDelayLine<float, MAX_DELAY> DSY_SDRAM_BSS delayx;
 static KaliDelayLine<float, MAX_DELAY> DSY_SDRAM_BSS delayy;
+static uint32_t DMA_BUFFER_MEM_SECTION gate_ring[KaliGateScheduler::RING];
+static uint8_t DMA_BUFFER_MEM_SECTION oled_dma[KaliOledDriver<I2CHandle>::DMA_BUFFER_SIZE];
+static uint8_t DSY_SDRAM_BSS store_staging[STORE_STAGING];
+static uint8_t DSY_SDRAM_BSS snapshot_staging[SNAPSHOT_STAGING];
+// Largest SysEx section (the config with its header), collected before it is stored
+static uint32_t DSY_SDRAM_BSS sysex_image[(sizeof(ConfigHeader) + sizeof(OptimizedKaliConfig) + 3) / 4];
 
 // extern "C" void initialise_monitor_handles(void);
 
@@ -36,8 +44,9 @@ const float cvfraction = 1.f / 4096.f;
 #define MIDI_STOP 0xFC
 // #define ENABLE_UNLINKED 0
 
-using MyOledDisplay = OledDisplay<SSD130xI2c128x32Driver>;
+using MyOledDisplay = OledDisplay<KaliOledDriver<I2CHandle>>;
 static MyOledDisplay display;
+static KaliTextCache text_cache;
 
 static Kali kali;
 
@@ -101,8 +110,12 @@ void Kali::Init(float samplerate)
     delays[2] = &delayx;
     delays[3] = &delayy;
 
+    midi.initNotePeriods(samplerate);
+
     // Global envelope follower
     Follower.Setup(samplerate, 50, 250);
+    telemetry.Init();
+    spectrum.Init(samplerate);
 #if ENABLE_WAVETABLE_EDITOR
     if (!wavetable_editor_ptr)
     {
@@ -165,7 +178,11 @@ void Kali::Init(float samplerate)
 
     for (int i = 0; i < 4; i++)
     {
-        delays[i]->Init();
+        // The SDRAM lines are zeroed by the MDMA while the rest of boot runs;
+        // main() waits for it before the audio starts
+        delays[i]->ResetPointers();
+        if (!delay_clear.Start(delays[i]->GetLine(), MAX_DELAY * sizeof(float)))
+            delays[i]->Reset();
         delays[i]->SetDelay(48000.f); // 1 second
 
         dc[i].Init(samplerate);
@@ -200,6 +217,16 @@ void Kali::Init(float samplerate)
     currentState = &KaliConfigOscState::getInstance();
     editstate.major_mode = KaliEditState::LFO_EDIT;
 
+    MountStore();
+
+    float *morph_lfo[KaliPresetMorph::LFOS];
+    float *morph_dsp[KaliPresetMorph::DSP_OPTIONS];
+    for (int i = 0; i < KaliPresetMorph::LFOS; i++)
+        morph_lfo[i] = warble[i].preset.Options;
+    for (int j = 0; j < KaliPresetMorph::DSP_OPTIONS; j++)
+        morph_dsp[j] = &OptionRules[BankType::DSP][j]->Value;
+    morph.Init(morph_lfo, morph_dsp);
+
     // Load last selected preset slot
     editstate.SelectedPresetIndex = LoadLastSelectedPresetSlot();
 
@@ -218,25 +245,25 @@ void Kali::Init(float samplerate)
     // UpdateFilter(0.8f);
 }
 
-void Kali::HandleMIDI()
+int Kali::ProcessMIDIEvents(uint8_t *clock_offsets)
 {
-    // Poll hardware
-    patch.midi.Listen();
-    midi_activity = patch.midi.HasEvents();
-
-    // Coalesce CC floods this cycle
-    static uint8_t last_cc_value[16][128];
-    static bool cc_seen[16][128];
-    for (int ch = 0; ch < 16; ++ch)
-        for (int c = 0; c < 128; ++c)
-            cc_seen[ch][c] = false;
+    int clocks = 0;
+    bool any = false;
+    // With clock out on, our own clock replaces the echo of the incoming one
+    const bool thru = !CheckFlag(OptionsPages::MidiClockOut);
 
-    const int maxDrain = 128; // drain up to 128 MIDI events per call
-    int drained = 0;
-    while (patch.midi.HasEvents() && drained < maxDrain)
+    const KaliMidiMessage *msg;
+    while ((msg = midibus.queue.Peek()) != nullptr)
     {
-        auto event = patch.midi.PopEvent();
-        drained++;
+        // Anything stamped after this block started is next block's business
+        if (timebase.IsFuture(msg->tick))
+            break;
+
+        KaliMidiMessage m = *msg;
+        midibus.queue.Drop();
+        any = true;
+
+        MidiEvent event = m.ToMidiEvent();
         AddMidiEvent(event);
 
         if (event.type == MidiMessageType::SystemRealTime)
@@ -244,25 +271,33 @@ void Kali::HandleMIDI()
             switch (event.srt_type)
             {
             case SystemRealTimeType::TimingClock:
-                patch.MIDISendClock();
+                if (thru)
+                    midiout.SendNow(m.status);
+                if (clocks < MAX_MIDI_CLOCKS_PER_BLOCK)
+                    clock_offsets[clocks++] = static_cast<uint8_t>(timebase.ToSampleOffset(m.tick));
                 kali.TriggerReceived = true;
                 midi_clock_flag = true;
                 break;
             case SystemRealTimeType::Continue:
-                patch.MIDISendClockContinue();
+                if (thru)
+                    midiout.SendNow(m.status);
                 ResetClocks();
                 kali.TriggerReceived = true;
                 break;
             case SystemRealTimeType::Start:
-                patch.MIDISendClockStart();
+                if (thru)
+                    midiout.SendNow(m.status);
                 ResetAllThings();
                 gate_count = 0;
+                clocks = 0; // clocks before the restart no longer count
                 kali.TriggerReceived = true;
                 break;
             case SystemRealTimeType::Stop:
-                patch.MIDISendClockStop();
+                if (thru)
+                    midiout.SendNow(m.status);
                 ResetAllThings();
                 gate_count = 0;
+                clocks = 0;
                 kali.TriggerReceived = false;
                 break;
             default:
@@ -271,13 +306,9 @@ void Kali::HandleMIDI()
         }
         else if (event.type == MidiMessageType::ControlChange)
         {
+            // Coalesce CC floods: only the last value per channel/CC this block is applied
             auto cc = event.AsControlChange();
-            int ch = cc.channel & 0x0F;
-            if (cc.control_number < 128 && ch >= 0 && ch < 16)
-            {
-                last_cc_value[ch][cc.control_number] = cc.value;
-                cc_seen[ch][cc.control_number] = true;
-            }
+            midi.queueControlChange(cc.channel & 0x0F, cc.control_number, cc.value, this);
 #if ENABLE_WAVETABLE_EDITOR
             const int startcc = 64;
             if (cc.control_number >= startcc && cc.control_number <= startcc + 16)
@@ -300,21 +331,14 @@ void Kali::HandleMIDI()
         }
     }
 
-    // Apply coalesced CC updates
-    for (int ch = 0; ch < 16; ++ch)
-    {
-        for (int c = 0; c < 128; ++c)
-        {
-            if (cc_seen[ch][c])
-            {
-                ControlChangeEvent e;
-                e.channel = ch;
-                e.control_number = (uint8_t)c;
-                e.value = last_cc_value[ch][c];
-                midi.receiveControlChange(e, this);
-            }
-        }
-    }
+    if (any)
+        midi_activity = true;
+
+    // Apply coalesced CC updates. Options are read once per block, so the
+    // sample offset of a CC inside the block makes no audible difference.
+    midi.applyPendingControlChanges(this);
+
+    return clocks;
 }
 
 void Kali::HitTick(size_t blocksize)
@@ -386,6 +410,18 @@ void kill_denormal_by_quantization(float &val)
     val -= anti_denormal;
 }
 
+void KaliInput::InitFilters(float rate)
+{
+    // CV settings for the 8 CV inputs, pot settings for ADC_9/10
+    for (int i = 0; i < 10; i++)
+    {
+        Filters[i].Init(rate, i < ADC_9 ? KALI_CV_FILTER : KALI_KNOB_FILTER);
+        // Small next to a slow turn; on a noisy CV at rest the value still
+        // moves by about this much some 20 times a second
+        Knobs[i].Hysteresis = 0.0005f;
+    }
+}
+
 /**
  * Processes the controls for KaliInput.
  *
@@ -404,7 +440,8 @@ void KaliInput::ProcessControls(DPT *patch)
         // get actual current knob position
         // abs that sucker unless it's lfo rate
         // float current_value = (i != 2) ? abs(patch->controls[i].Value()) : patch->controls[i].Value();
-        float current_value = abs((int)(patch->controls[i].Value() * 1000.f) * 0.001f); // truncate
+        // Filtered before the abs, so a bipolar CV around zero isn't rectified noise
+        float current_value = fabsf(Filters[i].Process(patch->controls[i].Value()));
 
         kill_denormal_by_quantization(current_value);
 
@@ -425,12 +462,10 @@ void KaliInput::ProcessControls(DPT *patch)
     Gate[0] = patch->gate_in_1.State();
     Gate[1] = patch->gate_in_2.State();
 
-    LFOAdjust = patch->GetAdcValue(ADC_9);
-    Knobs[8].Hysteresis = 0.01f;
+    LFOAdjust = Filters[8].Process(patch->GetAdcValue(ADC_9));
     Knobs[8].UpdateValue(LFOAdjust);
     // kali.KnobState[8].UpdateValue(LFOAdjust);
-    DelayAdjust = patch->GetAdcValue(ADC_10);
-    Knobs[9].Hysteresis = 0.01f;
+    DelayAdjust = Filters[9].Process(patch->GetAdcValue(ADC_10));
     Knobs[9].UpdateValue(DelayAdjust);
     // kali.KnobState[9].UpdateValue(DelayAdjust);
     patch->controls[0].GetRawFloat();
@@ -475,6 +510,8 @@ void AudioCallback(AudioHandle::InputBuffer in,
                    AudioHandle::OutputBuffer out,
                    size_t size)
 {
+    // Stamp the block first so ISR timestamps map onto it consistently
+    kali.timebase.BeginBlock(size);
 
     // all of this KaliInputState stuff feels weird
     KaliInputState s;
@@ -552,7 +589,7 @@ void AudioCallback(AudioHandle::InputBuffer in,
         kali.warble[0].SetLFOAdjust(inp->Knobs[Kali::CV::LFO_ADJUST].Value());
     }
 
-    if (inp->Knobs[Kali::CV::DELAY_ADJUST].Changed)
+    if (inp->Knobs[Kali::CV::DELAY_ADJUST].Changed && kali.GetValue(OptionsPages::MorphSource) != MORPH_CV)
     {
         // kali.warble[1].SetLFOAdjust(inp->Knobs[9].Value());
         // li::banktype::] dspoptionspages::distortionamount, 0, inp->knobs[9].value(), kali::banktype::dsp);
@@ -597,29 +634,32 @@ void AudioCallback(AudioHandle::InputBuffer in,
     kali.masterclock.internal_ppqn = 4;
     kali.masterclock.external_ppqn = kali.GetValue(OptionsPages::ExternalCvClockPPQN);
     kali.masterclock.Mode = (KaliClock::KaliClockMode)kali.GetValue(OptionsPages::SyncEngine); // actually sync mode, TODO: rename
+    kali.masterclock.tracker.SetBandwidth(kali.GetValue(OptionsPages::ClockTrackBandwidth) * 0.001f);
 
     // PLL clock outputs - calculate phase-locked timing
     // No need to set frequencies - we'll calculate pulses directly from master timing
 
-    bool trigger_event = false;
+    // MIDI and gate 1 edges from the previous block period, one block late but sample accurate
+    uint8_t midi_clock_offsets[Kali::MAX_MIDI_CLOCKS_PER_BLOCK];
+    int midi_clocks = kali.ProcessMIDIEvents(midi_clock_offsets);
+    uint8_t gate_clock_offsets[Kali::MAX_MIDI_CLOCKS_PER_BLOCK];
+    int gate_clocks = kali.gate1_capture.Collect(kali.timebase, gate_clock_offsets, Kali::MAX_MIDI_CLOCKS_PER_BLOCK);
+
+    // Edges that drive the master clock this block, depending on the sync source
+    const uint8_t *clock_offsets = nullptr;
+    int clocks = 0;
 
     switch (kali.masterclock.Mode)
     {
     case KaliClock::KaliClockMode::ClockIn:
         // External CV clock handling
-        if (inp->Gate[0] && !kali.prevgate1)
-        {
-            trigger_event = true;
-        }
+        clock_offsets = gate_clock_offsets;
+        clocks = gate_clocks;
         break;
 
     case KaliClock::KaliClockMode::MidiClock:
-        // MIDI clock handling
-        if (kali.midi_clock_flag)
-        {
-            kali.midi_clock_flag = false;
-            trigger_event = true;
-        }
+        clock_offsets = midi_clock_offsets;
+        clocks = midi_clocks;
         break;
 
     case KaliClock::KaliClockMode::Internal:
@@ -627,6 +667,7 @@ void AudioCallback(AudioHandle::InputBuffer in,
         // Internal clock handling - no external triggers needed
         break;
     }
+    int next_clock = 0;
 
     /* Internal Sync */
 
@@ -652,6 +693,14 @@ void AudioCallback(AudioHandle::InputBuffer in,
         kali.isfrozen = false;
     }
 
+    // Preset read by the main loop, applied here so it lands between blocks
+    if (kali.preset_apply_pending)
+    {
+        kali.ApplyMainPreset(kali.preset_loaded);
+        kali.preset_apply_pending = false;
+    }
+    kali.UpdateMorph(size);
+
     kali.HandleEncoders(inp);
 
     kali.prevgate1 = inp->Gate[0];
@@ -717,6 +766,9 @@ void AudioCallback(AudioHandle::InputBuffer in,
     kali.delaytargets[2] = newboop;
     kali.delaytargets[3] = newkoko;
 
+    // A held note takes over the delay targets when key tracking is on
+    kali.UpdateKeyTracking(size);
+
     ParameterInterpolator ampslide(&kali.warbamp, inp->Knobs[Kali::CV::META2].Value(), size * 2);
     ParameterInterpolator modmultslide(&kali.modmult, modmultnew, size * 2);
 
@@ -728,7 +780,6 @@ void AudioCallback(AudioHandle::InputBuffer in,
 
     // kali.pdsp.drama.SetWaveform((int)kali.patch.GetRandomFloat(0.0, 5.0));
     // kali.pdsp.drama.SetFreq(kali.warble[6].frequency);
-    // kali.pdsp.drama.last32possteppedmax = 384;
     //`}
 
     // ParameterInterpolator warbslide(&kali.warbfreq, newwarbfreq, size * 4);
@@ -825,8 +876,18 @@ void AudioCallback(AudioHandle::InputBuffer in,
     // Slower slewing for delay time parameters (restored from previous behavior)
     // Use extra smoothing for external sync to reduce jitter
     size_t slew_multiplier = (kali.masterclock.Mode != KaliClock::KaliClockMode::Internal) ? 128 : 64;
-    ParameterInterpolator boopslide(&kali.delaytimes[0], (newboop / choppe) + fineadj, size * slew_multiplier);
-    ParameterInterpolator kokoslide(&kali.delaytimes[1], (newkoko / choppe) + fineadj, size * slew_multiplier);
+    float boop_dest = (newboop / choppe) + fineadj;
+    float koko_dest = (newkoko / choppe) + fineadj;
+    if (kali.keytrack_active)
+    {
+        // Glide is already slewed per block, only interpolate across this one.
+        // Tracked times are exact periods, so chop and fine adjust stay out of it.
+        slew_multiplier = 1;
+        boop_dest = kali.keytrack_times[0];
+        koko_dest = kali.keytrack_times[1];
+    }
+    ParameterInterpolator boopslide(&kali.delaytimes[0], boop_dest, size * slew_multiplier);
+    ParameterInterpolator kokoslide(&kali.delaytimes[1], koko_dest, size * slew_multiplier);
 
     /*
     ****** DSP LOOP *****************************************************
@@ -834,29 +895,24 @@ void AudioCallback(AudioHandle::InputBuffer in,
     *********************************************************************
     */
 
+    kali.masterclock.BeginBlock();
+
     for (size_t i = 0; i < size; i++) // MAIN DSP LOOP
     {
         // has_clock here represents true/false
         // based on receiving a sync input trigger
 
-        // For external clock modes, only pass the trigger on the first sample
-        // to avoid double-triggering, but ensure accurate timing
-        bool current_trigger = (i == 0) ? trigger_event : false;
+        // External clock edges land on the sample they arrived at
+        bool current_trigger = false;
+        while (next_clock < clocks && clock_offsets[next_clock] <= i)
+        {
+            current_trigger = true;
+            next_clock++;
+        }
 
         kali.TriggerReceived =
             kali.masterclock.Tick(current_trigger);
 
-        // Reset PLL phase accumulators when we receive a trigger to keep clocks in sync
-        if (kali.TriggerReceived && i == 0)
-        {
-            kali.left_clock_phase_accumulator = 0;
-            kali.right_clock_phase_accumulator = 0;
-            kali.left_clock_state = true; // Start with a pulse
-            kali.right_clock_state = true;
-            kali.left_gate_timer = (int)(kali.masterclock.one_ms * 5); // 5ms pulse
-            kali.right_gate_timer = (int)(kali.masterclock.one_ms * 5);
-        }
-
         kali.size = size;
 
         kali.delaytimes[0] = kali.isfrozen ? kali.delaytargets[0] : boopslide.Next();
@@ -908,67 +964,6 @@ void AudioCallback(AudioHandle::InputBuffer in,
             frequencybase[j] = 48000.f / kali.delaytimes[j];
         }
 
-        // PLL clock output generation
-        // Calculate phase-locked clock outputs based on master clock timing
-        if (kali.masterclock.spqn > 0)
-        {
-            // Get PPQN multipliers from options
-            int left_ppqn = (int)kali.GetValue(OptionsPages::LeftClockRateMultiplier);
-            int right_ppqn = (int)kali.GetValue(OptionsPages::RightClockRateMultiplier);
-
-            // Calculate samples per pulse for each output
-            // Higher PPQN = more pulses per quarter note = fewer samples between pulses
-            int left_spp = (left_ppqn > 0) ? kali.masterclock.spqn / left_ppqn : kali.masterclock.spqn;
-            int right_spp = (right_ppqn > 0) ? kali.masterclock.spqn / right_ppqn : kali.masterclock.spqn;
-
-            // Ensure minimum pulse interval (prevent too-fast clocking)
-            left_spp = DSY_MAX(left_spp, 48); // Minimum ~1ms at 48kHz
-            right_spp = DSY_MAX(right_spp, 48);
-
-            // Update phase accumulators
-            kali.left_clock_phase_accumulator++;
-            kali.right_clock_phase_accumulator++;
-
-            // Generate left clock pulses
-            if (kali.left_clock_phase_accumulator >= left_spp)
-            {
-                kali.left_clock_phase_accumulator = 0;
-                kali.left_clock_state = true;
-                kali.left_gate_timer = (int)(kali.masterclock.one_ms * 5); // 5ms pulse
-            }
-
-            // Generate right clock pulses
-            if (kali.right_clock_phase_accumulator >= right_spp)
-            {
-                kali.right_clock_phase_accumulator = 0;
-                kali.right_clock_state = true;
-                kali.right_gate_timer = (int)(kali.masterclock.one_ms * 5); // 5ms pulse
-            }
-
-            // Handle gate pulse duration
-            if (kali.left_gate_timer > 0)
-            {
-                kali.left_gate_timer--;
-            }
-            else
-            {
-                kali.left_clock_state = false;
-            }
-
-            if (kali.right_gate_timer > 0)
-            {
-                kali.right_gate_timer--;
-            }
-            else
-            {
-                kali.right_clock_state = false;
-            }
-        }
-
-        // Output the phase-locked clocks to GPIO pins
-        dsy_gpio_write(&kali.patch.gate_out_1, kali.left_clock_state);
-        dsy_gpio_write(&kali.patch.gate_out_2, kali.right_clock_state);
-
         // this is a sin wave used w/ chorus modes
         float frequencybase_in;
 
@@ -1178,29 +1173,84 @@ void AudioCallback(AudioHandle::InputBuffer in,
     }
     // kali.in_audio_callback = false;
 
-    /*
-        MIDI clock output - use left clock state for MIDI timing
-    */
-    if (kali.left_clock_state && !kali.masterclock.gate)
+    // PLL clock outputs: restart on the master beat, edges go out through the DMA ring
+    if (kali.masterclock.spqn > 0)
     {
-        kali.queue_midi_clock = true;
+        const int ppqn[2] = {(int)kali.GetValue(OptionsPages::LeftClockRateMultiplier),
+                             (int)kali.GetValue(OptionsPages::RightClockRateMultiplier)};
+        const float pulse_len = kali.masterclock.one_ms * 5; // 5ms pulse
+        const int beat = kali.masterclock.GetBeatOffset();
+        bool *states[2] = {&kali.left_clock_state, &kali.right_clock_state};
+        dsy_gpio *pins[2] = {&kali.patch.gate_out_1, &kali.patch.gate_out_2};
+
+        if (kali.gate_scheduler.Running())
+            kali.gate_scheduler.BeginBlock();
+
+        for (int j = 0; j < 2; j++)
+        {
+            // Higher PPQN = more pulses per quarter note, never faster than ~1ms
+            float period = (float)kali.masterclock.spqn / (ppqn[j] > 0 ? ppqn[j] : 1);
+            period = DSY_MAX(period, 48.f);
+
+            KaliGateEdge edges[KaliClockOutput::MAX_EDGES];
+            int count = kali.clock_out[j].Process(size, beat, period, pulse_len, edges);
+            if (kali.gate_scheduler.Running())
+                kali.gate_scheduler.Schedule(j, edges, count);
+            else
+                dsy_gpio_write(pins[j], kali.clock_out[j].IsHigh());
+
+            *states[j] = kali.clock_out[j].IsHigh();
+            for (int e = 0; e < count; e++)
+                *states[j] |= edges[e].high;
+        }
     }
 
-    // For VU meter
+    // MIDI clock out: 24 PPQN ticks on the master clock timeline, due one block
+    // after this block started so they line up with the audio leaving the codec
+    if (kali.CheckFlag(OptionsPages::MidiClockOut) && kali.masterclock.spqn > 0)
+    {
+        if (!kali.midi_clock_out_running)
+        {
+            kali.midi_clock_gen.Reset();
+            kali.midiout.SendNow(0xFA); // Start
+            kali.midi_clock_out_running = true;
+        }
+
+        const float period = (float)kali.masterclock.spqn / KaliClock::MIDI_PPQN;
+        KaliGateEdge ticks[KaliClockOutput::MAX_EDGES];
+        int count = kali.midi_clock_gen.Process(size, kali.masterclock.GetBeatOffset(), period, 1.f, ticks);
 
-    kali.last_sample_in[0] = IN_L[0];
-    kali.last_sample_in[1] = IN_R[0];
-    kali.last_sample_in[2] = IN_L[0];
-    kali.last_sample_in[3] = IN_R[0];
+        const uint32_t block_ticks = kali.timebase.BlockTicks();
+        const float ticks_per_sample = (float)block_ticks / size;
+        const uint32_t start = kali.timebase.WindowEnd() + block_ticks;
+        for (int e = 0; e < count; e++)
+        {
+            if (ticks[e].high)
+                kali.midiout.Schedule(start + (uint32_t)(ticks[e].pos * ticks_per_sample), 0xF8);
+        }
+    }
+    else if (kali.midi_clock_out_running)
+    {
+        kali.midiout.SendNow(0xFC); // Stop
+        kali.midi_clock_out_running = false;
+    }
 
-    kali.last_sample_out[0] = OUT_L[0];
-    kali.last_sample_out[1] = OUT_R[0];
-    kali.last_sample_out[2] = OUT_L[0];
-    kali.last_sample_out[3] = OUT_R[0];
+    // For VU meter
+    kali.telemetry.AccumulatePeaks(in, out, size);
+    if (kali.editstate.major_mode == KaliEditState::SPECTRUM)
+        kali.spectrum.Push(out, size);
+#if ENABLE_SD_CARD
+    kali.recorder.Push(in, out, size);
+#endif
 
     // follow buffer
     float *fbout[2] = {fbbuffer[0], fbbuffer[1]};
 
+    // Only run the bands/detectors some LFO is listening to; broadband peak feeds the scope
+    uint32_t follow_mask = EnvelopeFollower<2>::DEFAULT_ACTIVE;
+    for (int j = 0; j < 6; j++)
+        follow_mask |= kali.warble[j].FollowMask();
+    kali.Follower.SetActive(follow_mask);
     kali.Follower.Process(size, fbout);
     for (int j = 0; j < 6; j++)
     {
@@ -1244,6 +1294,11 @@ void AudioCallback(AudioHandle::InputBuffer in,
     kali.warble[5].SetFreq(clockL);
     // eastside
 
+    // Pull the clock-derived LFOs back onto the beat that landed in this block, if any
+    const float pll_bandwidth = kali.GetValue(OptionsPages::LfoPllBandwidth) * 0.005f; // 100% removes half the error per beat
+    for (int i = 0; i < 6; i++)
+        kali.warble[i].PhaseLock(kali.masterclock.GetBeatOffset(), size, kali.masterclock.spqn, pll_bandwidth);
+
     /* FIXME: A lot of these are set where left delay and right delay knobs set the base frequency of l and r lfos respectively,
     this is a little awkward in practice, or at least hard to follow as I'm looking at it now. Assume it would be difficult for a user to remember. */
 
@@ -1268,6 +1323,22 @@ void AudioCallback(AudioHandle::InputBuffer in,
         // kali.warble[i].eschatonsource = &kali.warble[(int)(kali.warble[i]).preset.GetOption(LFOOptionsPages::FMSource)];
     }
 
+    // Telemetry frame, after the LFOs have produced this block's values; the
+    // probes (grain counting walks every grain) are only gathered when one is due
+    if (kali.telemetry.EndBlock())
+    {
+        static_assert(sizeof(kali.warble) / sizeof(kali.warble[0]) == KaliTelemetry::NUM_LFOS,
+                      "telemetry needs a row per LFO");
+        float lfo_probe[KaliTelemetry::NUM_LFOS];
+        for (int i = 0; i < KaliTelemetry::NUM_LFOS; i++)
+            lfo_probe[i] = kali.warble[i].last;
+        float env_probe[KaliTelemetry::NUM_ENV] = {kali.Follower[0], kali.Follower[1]};
+        uint8_t grain_probe[KaliTelemetry::NUM_AUDIO] = {
+            static_cast<uint8_t>(kali.dsp.CountActiveGrains(0)),
+            static_cast<uint8_t>(kali.dsp.CountActiveGrains(1))};
+        kali.telemetry.Publish(lfo_probe, env_probe, grain_probe);
+    }
+
     kali.patch.WriteCvOutExp(
         kali.warble[0].GetScaled(),
         kali.warble[1].GetScaled(),
@@ -1280,6 +1351,53 @@ void AudioCallback(AudioHandle::InputBuffer in,
     kali.patch.WriteCvOut(2, kali.warble[5].GetScaled(), true);
 }
 
+float Kali::KeyTrackTime(float period, float knob_time, int mode) const
+{
+    float t = period;
+    if (mode == KEYTRACK_CLOCK)
+    {
+        // Whole number of cycles so the repeats stay in tune, as close to the
+        // (clock synced) knob time as that allows
+        t = period * DSY_MAX(1.f, floorf(knob_time / period + 0.5f));
+    }
+    // Too short for the working range: go up whole octaves, which keeps the pitch class
+    while (t < MIN_DELAY_WORKING && t * 2.f <= MAX_DELAY_WORKING)
+        t *= 2.f;
+    return DSY_CLAMP(t, MIN_DELAY_WORKING, MAX_DELAY_WORKING);
+}
+
+void Kali::UpdateKeyTracking(size_t size)
+{
+    const int mode = static_cast<int>(GetValue(OptionsPages::KeyTrack));
+    const int note = midi.heldNote();
+    if (mode == KEYTRACK_OFF || note < 0)
+    {
+        keytrack_active = false;
+        return;
+    }
+
+    const float glide_ms = GetValue(OptionsPages::KeyGlide);
+    if (glide_ms != keytrack_glide_ms)
+    {
+        // One pole per block: reaches 63% of the way in glide_ms
+        const float glide_blocks = glide_ms * 0.001f * patch.AudioSampleRate() / size;
+        keytrack_coef = glide_blocks > 1.f ? 1.f - expf(-1.f / glide_blocks) : 1.f;
+        keytrack_glide_ms = glide_ms;
+    }
+
+    const float period = midi.notePeriod(note);
+    for (int c = 0; c < 2; c++)
+    {
+        const float target = KeyTrackTime(period, delaytargets[c], mode);
+        if (!keytrack_active)
+            keytrack_times[c] = delaytimes[c]; // glide in from wherever the knobs had it
+        keytrack_times[c] += (target - keytrack_times[c]) * keytrack_coef;
+        delaytargets[c] = target;
+        delaytargets[c + 2] = target;
+    }
+    keytrack_active = true;
+}
+
 void Kali::UpdateDelayRangeForExternalSync()
 {
     // Only update range in external sync modes
@@ -1296,11 +1414,6 @@ void Kali::UpdateDelayRangeForExternalSync()
         rawSamplesPerBeat = 24000.0f;
     }
 
-    // Apply heavy smoothing to prevent jitter from tempo detection fluctuations
-    // Use a very slow filter coefficient for stable tempo tracking
-    float smoothing_coeff = 0.002f; // Very slow smoothing (500 samples to reach ~63% of target)
-    smoothed_samples_per_beat += (rawSamplesPerBeat - smoothed_samples_per_beat) * smoothing_coeff;
-
     // Get the current range preset
     int rangePreset = (int)GetValue(DSPOptionsPages::DelayRangePreset, BankType::DSP);
 
@@ -1341,20 +1454,20 @@ void Kali::UpdateDelayRangeForExternalSync()
         break;
     }
 
-    // Calculate the delay range in samples using smoothed tempo
-    float calculatedMin = smoothed_samples_per_beat * minDivision;
-    float calculatedMax = smoothed_samples_per_beat * maxDivision;
+    // Calculate the delay range in samples; the tempo is already DLL filtered
+    float calculatedMin = rawSamplesPerBeat * minDivision;
+    float calculatedMax = rawSamplesPerBeat * maxDivision;
 
     // Apply hardware limits
     calculatedMin = DSY_CLAMP(calculatedMin, 12.0f, MAX_DELAY);
     calculatedMax = DSY_CLAMP(calculatedMax, calculatedMin, MAX_DELAY);
 
-    // Apply additional smoothing to the final range values to further reduce jitter
-    float range_smoothing_coeff = 0.005f; // Slightly faster than tempo smoothing
+    // Slew the range itself: a relock can step the tempo by a lot, and the
+    // delay time would jump with it
+    float range_smoothing_coeff = 0.005f; // per block, ~0.4s to 63%
     last_calculated_min += (calculatedMin - last_calculated_min) * range_smoothing_coeff;
     last_calculated_max += (calculatedMax - last_calculated_max) * range_smoothing_coeff;
 
-    // Update the working range with smoothed values
     MIN_DELAY_WORKING = last_calculated_min;
     MAX_DELAY_WORKING = last_calculated_max;
 }
@@ -1372,20 +1485,22 @@ void Kali::updateoled(void *data)
     if (displaycountdown > 0)
     {
         if (lastcontrast != 0xFF)
-            display.driver_.SetContrast(0xFF);
+            display.GetDriver().SetContrast(0xFF);
         lastcontrast = 0xFF;
     }
     else
     {
         if (lastcontrast != mincontrast)
-            display.driver_.SetContrast(mincontrast);
+            display.GetDriver().SetContrast(mincontrast);
         lastcontrast = mincontrast;
     }
 
     display.Fill(false);
     daisy::Rectangle screen(0, 0, 128, 32);
 
-    UpdateVuMeters();
+    // The spectrum page has meters of its own
+    if (editstate.major_mode != KaliEditState::SPECTRUM)
+        UpdateVuMeters();
     DrawActivityIndicators();
 
     switch (editstate.major_mode)
@@ -1399,6 +1514,9 @@ void Kali::updateoled(void *data)
     case KaliEditState::DSP_EDIT:
         UpdateDspEditScreen(screen);
         break;
+    case KaliEditState::SPECTRUM:
+        UpdateSpectrumScreen(screen);
+        break;
     case KaliEditState::PRESETS:
         UpdatePresetsScreen(screen);
         break;
@@ -1428,11 +1546,13 @@ void Kali::UpdateVuMeters()
     static const int yOffsetStart = 12;
     static const int yOffsetIncrement = 2;
 
+    const int f = telemetry.Newest();
+
     for (int i = 0; i < 4; ++i)
     {
-        float sample = (i % 2 == 0) ? last_sample_in[i / 2] : last_sample_out[i / 2];
-        int width = DSY_CLAMP(static_cast<int>(sample * scale), -center, center);
-        display.DrawLine(center, yOffsetStart + i * yOffsetIncrement, center + width, yOffsetStart + i * yOffsetIncrement, true);
+        float peak = (i % 2 == 0) ? telemetry.in_peak[i / 2][f] : telemetry.out_peak[i / 2][f];
+        int width = DSY_CLAMP(static_cast<int>(peak * scale), 0, center);
+        display.DrawLine(center - width, yOffsetStart + i * yOffsetIncrement, center + width, yOffsetStart + i * yOffsetIncrement, true);
     }
 }
 
@@ -1452,6 +1572,10 @@ void Kali::DrawActivityIndicators()
 
     if (midi_activity)
         display.DrawRect(4, 28, 8, 32, true, true);
+
+    // Both are latched by the audio callback; clear once shown
+    midi_clock_flag = false;
+    midi_activity = false;
 }
 
 void Kali::UpdateLfoEditScreen(const daisy::Rectangle &screen)
@@ -1463,7 +1587,7 @@ void Kali::UpdateLfoEditScreen(const daisy::Rectangle &screen)
     KaliOption *option = OptionRules[BankType::LFO][editstate.SelectedOptionIndex];
     PrintToScreen(screen, Alignment::topLeft, Font_5x5, true, "6xOSC");
     PrintLfoInfo(screen, curr_lfo, option);
-    DrawLfoWaveform(curr_lfo);
+    DrawLfoWaveform(editstate.SelectedIndex);
 }
 
 void Kali::PrintLfoInfo(const daisy::Rectangle &screen, KaliOscillator *curr_lfo, KaliOption *option)
@@ -1483,21 +1607,24 @@ void Kali::PrintLfoInfo(const daisy::Rectangle &screen, KaliOscillator *curr_lfo
     PrintEditableValueBig(screen, value, option->STType, option->IsFloat);
 }
 
-void Kali::DrawLfoWaveform(KaliOscillator *curr_lfo)
+void Kali::DrawLfoWaveform(int lfo_index)
 {
-    int waveformLength = 64;
+    int waveformLength = KaliTelemetry::FRAMES;
     int maxPixelHeight = 31;
     int yOffset = 16;
     float scale = 16.f;
-    int curry = yOffset;
 
+    if (lfo_index < 0 || lfo_index >= KaliTelemetry::NUM_LFOS)
+        return;
+
+    const float *row = telemetry.lfo[lfo_index];
+
+    // Oldest frame on the left, newest on the right
     for (int i = 0; i < waveformLength; ++i)
     {
-        int posWrapped = (i + curr_lfo->last32pos) % waveformLength;
-        float level = curr_lfo->last32[posWrapped] / 2048.f;
+        float level = (2048.f - row[telemetry.FrameIndex(waveformLength - 1 - i)]) / 2048.f;
         int nexty = DSY_CLAMP(static_cast<int>(yOffset + level * scale), 0, maxPixelHeight);
         display.DrawPixel(i * 2, nexty, true);
-        curry = nexty;
     }
 }
 
@@ -1507,6 +1634,101 @@ void Kali::UpdateOptionsScreen(const daisy::Rectangle &screen)
     PrintToScreen(screen, Alignment::topLeft, Font_5x5, true, "OPT");
     PrintToScreen(screen, Alignment::topRight, Font_5x5, true, "%s", option->ShortDescription);
     PrintEditableValueBig(screen, option->Value, option->STType, option->IsFloat);
+    if (editstate.SelectedOptionIndex == OptionsPages::Snapshot)
+    {
+        static const char *const states[] = {"", "ENCODE", "WRITE", "LOAD"};
+        const KaliSnapshot::State st = snapshot.GetState();
+        if (st != KaliSnapshot::IDLE)
+            PrintToScreen(screen, Alignment::bottomLeft, Font_5x5, true, "%s %d%%", states[st],
+                          static_cast<int>(snapshot.Progress() * 100.f));
+        else if (snapshot.failures)
+            PrintToScreen(screen, Alignment::bottomLeft, Font_5x5, true, "%s%s FAIL %d",
+                          snapshot.Valid() ? "STORED" : "EMPTY", isfrozen ? "" : " (thawed)",
+                          static_cast<int>(snapshot.failures));
+        else
+            PrintToScreen(screen, Alignment::bottomLeft, Font_5x5, true, "%s%s",
+                          snapshot.Valid() ? "STORED" : "EMPTY", isfrozen ? "" : " (thawed)");
+    }
+    else if (editstate.SelectedOptionIndex == OptionsPages::EnableDebugInfo)
+    {
+        // Power-on to StartAudio, and what the delay clear took of it
+        PrintToScreen(screen, Alignment::bottomLeft, Font_5x5, true, "BOOT %dms CLR %dms", static_cast<int>(boot_ms),
+                      static_cast<int>(delay_clear.elapsed_us / 1000));
+    }
+#if ENABLE_SD_CARD
+    if (editstate.SelectedOptionIndex == OptionsPages::SdRecord)
+    {
+        // Length of the take and blocks lost to a slow card
+        PrintToScreen(screen, Alignment::bottomLeft, Font_5x5, true, "%s %ds OVR:%d",
+                      !sd_mounted ? "NO SD" : (recorder.Recording() ? "REC" : "IDLE"),
+                      static_cast<int>(recorder.Seconds()), static_cast<int>(recorder.overruns));
+    }
+    else if (editstate.SelectedOptionIndex == OptionsPages::SdLoadSample)
+    {
+        switch (sample_loader.GetStatus())
+        {
+        case KaliSampleLoader::LOADING:
+            PrintToScreen(screen, Alignment::bottomLeft, Font_5x5, true, "LOAD %d%%",
+                          static_cast<int>(sample_loader.Progress() * 100.f));
+            break;
+        case KaliSampleLoader::DONE:
+            PrintToScreen(screen, Alignment::bottomLeft, Font_5x5, true, "%ds LOADED",
+                          static_cast<int>(sample_loader.Frames() / patch.AudioSampleRate()));
+            break;
+        case KaliSampleLoader::FAILED:
+            PrintToScreen(screen, Alignment::bottomLeft, Font_5x5, true, "%s", sd_mounted ? "BAD FILE" : "NO SD");
+            break;
+        default:
+            break;
+        }
+    }
+#endif
+}
+
+void Kali::UpdateSpectrumScreen(const daisy::Rectangle &screen)
+{
+    static const int bar_top = 7; // under the labels
+    static const int meter_x = 108;
+    static const float meter_floor_db = -48.f;
+
+    // Only while the page is up, once per display frame
+    const uint32_t t0 = System::GetUs();
+    spectrum.Analyze();
+    spectrum_us = System::GetUs() - t0;
+
+    const int bottom = screen.GetHeight() - 1;
+    const int span = bottom - bar_top;
+
+    for (int b = 0; b < KaliSpectrum::BANDS; b++)
+    {
+        const int x = b * 4;
+        const int h = static_cast<int>(spectrum.Level(b) * span);
+        const int ph = static_cast<int>(spectrum.Peak(b) * span);
+        if (h > 0)
+            display.DrawRect(x, bottom - h, x + 2, bottom, true, true);
+        if (ph > h)
+            display.DrawLine(x, bottom - ph, x + 2, bottom - ph, true);
+    }
+
+    // RMS as the bar, peak as the tick above it
+    float loudest = meter_floor_db;
+    for (int c = 0; c < KaliSpectrum::NUM_CHANNELS; c++)
+    {
+        const int x = meter_x + c * 10;
+        const float rms = DSY_CLAMP(1.f - spectrum.rms_db[c] / meter_floor_db, 0.f, 1.f);
+        const float peak = DSY_CLAMP(1.f - spectrum.peak_db[c] / meter_floor_db, 0.f, 1.f);
+        const int rh = static_cast<int>(rms * span);
+        const int ph = static_cast<int>(peak * span);
+        if (rh > 0)
+            display.DrawRect(x, bottom - rh, x + 7, bottom, true, true);
+        display.DrawLine(x, bottom - ph, x + 7, bottom - ph, true);
+        loudest = std::max(loudest, spectrum.peak_db[c]);
+    }
+
+    PrintToScreen(screen, Alignment::topLeft, Font_5x5, true, "SPEC");
+    if (GetDebugMode())
+        PrintToScreen(screen, Alignment::topCentered, Font_5x5, true, "%dus", static_cast<int>(spectrum_us));
+    PrintToScreen(screen, Alignment::topRight, Font_5x5, true, "%ddB", static_cast<int>(loudest));
 }
 
 void Kali::UpdateDspEditScreen(const daisy::Rectangle &screen)
@@ -1660,7 +1882,7 @@ void Kali::PrintToScreen(const daisy::Rectangle screen, const Alignment alignmen
     vsnprintf(toscreen, sizeof(toscreen), format, args);
     va_end(args);
 
-    display.WriteStringAligned(toscreen, f, screen, alignment, on);
+    text_cache.Print(display, toscreen, f, screen, alignment, on);
 }
 
 #ifndef NDEBUG
@@ -1800,8 +2022,9 @@ void Kali::UpdateDebugScreen(const daisy::Rectangle &screen)
         // Show mode and active grains
         const char *name = kali.dsp.GetCurrentModeName();
         PrintToScreen(screen, Alignment::topCentered, Font_5x5, true, "%s", name);
-        int gL = kali.dsp.CountActiveGrains(0);
-        int gR = kali.dsp.CountActiveGrains(1);
+        int f = telemetry.Newest();
+        int gL = telemetry.grains[0][f];
+        int gR = telemetry.grains[1][f];
         PrintToScreen(screen, Alignment::centeredLeft, Font_5x5, true, "GL:%d GR:%d", gL, gR);
         // Show key params
         PrintToScreen(screen, Alignment::bottomLeft, Font_5x5, true, "M1:%d M2:%d", (int)(inp.Knobs[Kali::CV::META1].Value() * 100), (int)(inp.Knobs[Kali::CV::META2].Value() * 100));
@@ -1859,11 +2082,13 @@ void Kali::UpdateClockDebugScreen(const daisy::Rectangle &screen)
                   masterclock.GetCurrentPPQN(),
                   masterclock.clock_timeout_counter);
 
-    // Gate input states
+    // Gate input states and MIDI clock out lateness (avg/max us)
     PrintToScreen(screen, Alignment::centeredLeft, Font_5x5, true,
-                  "G1:%s G2:%s",
+                  "G1:%s G2:%s Out:%d/%d",
                   inp.Gate[0] ? "HI" : "lo",
-                  inp.Gate[1] ? "HI" : "lo");
+                  inp.Gate[1] ? "HI" : "lo",
+                  static_cast<int>(midiout.late_avg_us),
+                  static_cast<int>(midiout.late_max_us));
 
     // Counter values - show both accumulators for debugging
     PrintToScreen(screen, Alignment::bottomLeft, Font_5x5, true,
@@ -1872,15 +2097,16 @@ void Kali::UpdateClockDebugScreen(const daisy::Rectangle &screen)
                   masterclock.SampleAccumulator,
                   masterclock.TimingAccumulator);
 
-    // Show averaging buffer contents to debug timing detection
-    if (masterclock.full > 0)
+    // Tempo tracker health: RMS jitter in samples, drift in ppm/pulse, rejected pulses
+    const KaliTempoTracker &trk = masterclock.tracker;
+    if (trk.IsLocked())
     {
         PrintToScreen(screen, Alignment::bottomRight, Font_5x5, true,
-                      "Buf:%d,%d,%d F:%d",
-                      (int)masterclock.foravg[0],
-                      masterclock.full > 1 ? (int)masterclock.foravg[1] : 0,
-                      masterclock.full > 2 ? (int)masterclock.foravg[2] : 0,
-                      masterclock.full);
+                      "J:%d D:%d R:%d L:%d",
+                      static_cast<int>(trk.GetJitter()),
+                      static_cast<int>(trk.GetDriftPpm()),
+                      static_cast<int>(trk.GetRejected()),
+                      static_cast<int>(trk.GetRelocks()));
     }
     else
     {
@@ -1935,44 +2161,395 @@ void Kali::PrintEditableValueBig(const daisy::Rectangle &screen, float value, St
     }
 }
 
-// ---- Presets (6 LFOs + 1 DSP) ----
+// ---- Presets (6 LFOs + 1 DSP), layout in KaliPresetLayout.h ----
+
+bool Kali::StartSnapshot(bool save)
+{
+    float *lines[4];
+    size_t bases[4];
+    for (int j = 0; j < 4; j++)
+    {
+        lines[j] = delays[j]->GetLine();
+        bases[j] = delays[j]->GetWritePtr();
+    }
+    if (save)
+        return isfrozen && snapshot.StartSave(lines, bases, 4, MAX_DELAY, static_cast<size_t>(MAX_DELAY_WORKING),
+                                              static_cast<uint32_t>(patch.AudioSampleRate()));
+    return snapshot.StartRestore(lines, bases, 4, MAX_DELAY);
+}
+
+void Kali::ServiceSnapshot()
+{
+    const int action = static_cast<int>(GetValue(OptionsPages::Snapshot));
+    if (action == SNAPSHOT_SAVE || action == SNAPSHOT_LOAD)
+    {
+        SetOptionValue(OptionsPages::Snapshot, snapshot_mode);
+        if (snapshot.GetState() == KaliSnapshot::IDLE)
+            StartSnapshot(action == SNAPSHOT_SAVE);
+    }
+    else
+    {
+        snapshot_mode = action;
+    }
+    snapshot.Step(isfrozen);
+}
+
+void Kali::RestoreSnapshotAtBoot()
+{
+    snapshot_mode = static_cast<int>(GetValue(OptionsPages::Snapshot));
+    if (snapshot_mode >= SNAPSHOT_SAVE)
+    {
+        // A saved config never holds an action, but don't act on one if it does
+        snapshot_mode = SNAPSHOT_MANUAL;
+        SetOptionValue(OptionsPages::Snapshot, snapshot_mode);
+    }
+    if (snapshot_mode != SNAPSHOT_AT_BOOT || !StartSnapshot(false))
+        return;
+    // Before the audio starts; decoding straight from QSPI takes well under a second
+    while (snapshot.GetState() == KaliSnapshot::RESTORING)
+        snapshot.Step(false);
+}
+
+void Kali::MountStore()
+{
+    qspi_flash.Init(&patch.qspi);
+    store.Init(&qspi_flash, STORE_BASE, STORE_SECTORS, store_staging, sizeof(store_staging));
+    snapshot.Init(&qspi_flash, SNAPSHOT_BASE, SNAPSHOT_SIZE, snapshot_staging, sizeof(snapshot_staging));
+    if (store.Mount())
+        ImportLegacyStore();
+    for (int slot = 0; slot < MAX_PRESETS; slot++)
+        CachePresetName(slot, ReadMainPreset(slot));
+}
+
+void Kali::ImportLegacyStore()
+{
+    // First boot on the record store: carry over whatever the old fixed
+    // layout holds. It stays where it is, so this runs again after a wipe.
+    OptimizedKaliConfig config;
+    if (KaliVersionManager::readLegacyConfig(patch, config))
+    {
+        KaliVersionManager::writeConfig(store, config);
+        store.Flush();
+    }
+
+    for (int slot = 0; slot < MAX_PRESETS; slot++)
+    {
+        // Copied out of QSPI, Put() may be followed by a flush
+        MainPresetEntry copy;
+        if (!KaliVersionManager::upgradeMainPreset(static_cast<const uint8_t *>(patch.qspi.GetData(preset_slot_addr(slot))),
+                                                   MAIN_PRESET_SECTOR, copy))
+            continue;
+        if (!store.Put(preset_slot_key(slot), &copy, sizeof(copy)))
+        {
+            store.Flush();
+            store.Put(preset_slot_key(slot), &copy, sizeof(copy));
+        }
+    }
+
+    auto *cfg = reinterpret_cast<const PersistentConfig *>(patch.qspi.GetData(PERSISTENT_CONFIG_ADDR));
+    if (cfg->magic == PERSISTENT_CONFIG_MAGIC)
+        store.Put(KEY_LAST_SLOT, &cfg->last_preset_slot, 1);
+    store.Flush();
+}
+
 namespace
 {
-    static constexpr uint32_t MAIN_PRESET_MAGIC = 0x4B414C50; // 'KALP'
-    static constexpr uint32_t MAIN_PRESET_VERSION = 1;
-    static constexpr uint32_t MAIN_PRESET_BASE = 0x0010000; // 64KB into QSPI
-    static constexpr uint32_t MAIN_PRESET_SECTOR = 0x1000;  // 4KB per slot
+    // Size of a SysEx section: the config (header + data) or one preset slot
+    bool sysex_section_size(uint8_t section, uint32_t &size)
+    {
+        if (section == KaliSysex::SECTION_CONFIG)
+        {
+            size = sizeof(ConfigHeader) + sizeof(OptimizedKaliConfig);
+            return true;
+        }
+        if (section >= 1 && section <= MAX_PRESETS)
+        {
+            size = sizeof(MainPresetEntry);
+            return true;
+        }
+        return false;
+    }
+}
+
+bool Kali::ReadSysexSection(uint8_t section, uint32_t offset, uint8_t *out, uint32_t len)
+{
+    uint32_t got;
+    const uint8_t *src;
+    if (section != KaliSysex::SECTION_CONFIG)
+    {
+        src = store.Get(preset_slot_key(section - 1), got);
+        if (!src || got != sizeof(MainPresetEntry) || offset + len > got)
+            return false;
+        memcpy(out, src + offset, len);
+        return true;
+    }
+
+    // The config section is a ConfigHeader and the config as it was last
+    // persisted, so the dump matches the store. The header checksum covers
+    // the whole config, so it is only worked out for the chunk that has it.
+    const OptimizedKaliConfig &config = KaliVersionManager::persistedConfig();
+    if (offset + len > sizeof(ConfigHeader) + sizeof(config))
+        return false;
+    ConfigHeader header = {KALI_CONFIG_MAGIC, KaliVersionManager::CURRENT_VERSION, 0, sizeof(config)};
+    if (offset < sizeof(ConfigHeader))
+        header.checksum = KaliVersionManager::calculateChecksum(&config, sizeof(config));
+    while (len > 0)
+    {
+        const bool in_header = offset < sizeof(ConfigHeader);
+        src = in_header ? reinterpret_cast<const uint8_t *>(&header) + offset
+                        : reinterpret_cast<const uint8_t *>(&config) + offset - sizeof(ConfigHeader);
+        got = in_header ? sizeof(ConfigHeader) - offset
+                        : sizeof(ConfigHeader) + sizeof(config) - offset;
+        const uint32_t n = DSY_MIN(len, got);
+        memcpy(out, src, n);
+        out += n;
+        offset += n;
+        len -= n;
+    }
+    return true;
+}
 
-    struct MainPresetEntry
+bool Kali::SendSysex(uint8_t source, const uint8_t *msg, size_t len)
+{
+    if (source == KaliMIDIBus::SOURCE_USB)
     {
-        uint32_t magic;
-        uint32_t version;
-        char name[16];
-        float lfo[6][LFOOptionsPages::KALI_LFO_OPTIONS_LAST];
-        float dsp[DSPOptionsPages::KALI_DSP_OPTIONS_LAST];
-        float knob_snapshot[8];     // Knob positions at save time (for soft takeover)
-        uint8_t last_selected_slot; // Remember last selection
-        uint8_t reserved[3];        // Padding for alignment
-    };
+        // The endpoint sends from sysex_usb_packets, so only refill it once the
+        // last message is out. Packed here rather than by usb_midi.Tx(), which
+        // splits off the F7 (see KaliSysex::ToUsbPackets)
+        if (!patch.UsbMidiTxReady())
+            return false;
+        const size_t packets = KaliSysex::ToUsbPackets(msg, len, sysex_usb_packets);
+        return patch.usb.TransmitInternal(sysex_usb_packets, packets) == UsbHandle::Result::OK;
+    }
+    return midiout.SendBulk(msg, len);
+}
+
+void Kali::SendSysexAck(uint8_t source, uint8_t section, uint8_t status)
+{
+    SysexAck ack = {source, section, status};
+    sysex_acks.Push(ack);
+}
 
-    // Persistent config location (separate from presets)
-    static const uint32_t PERSISTENT_CONFIG_ADDR = MAIN_PRESET_BASE + (MAX_PRESETS * MAIN_PRESET_SECTOR);
+void Kali::ServiceSysex()
+{
+    KaliSysexPacket packet;
+    while (midibus.sysex_queue.Pop(packet))
+        HandleSysex(packet);
 
-    struct PersistentConfig
+    // Acks first, in order; one that can't go yet is retried next pass
+    const SysexAck *ack;
+    while ((ack = sysex_acks.Peek()) != nullptr)
     {
-        uint32_t magic;
-        uint8_t last_preset_slot;
-        uint8_t reserved[251]; // Pad to 256 bytes
-    };
-    static const uint32_t PERSISTENT_CONFIG_MAGIC = 0xCA11C0FF; // CALLCOFF (Kali Config)
+        uint8_t msg[KaliSysex::MAX_MESSAGE];
+        const size_t len = KaliSysex::Encode(msg, KaliSysex::ACK, ack->section, 0, &ack->status, 1);
+        if (!SendSysex(ack->source, msg, len))
+            return;
+        sysex_acks.Drop();
+    }
 
-    static inline uint32_t preset_slot_addr(int slot)
+    if (!sysex_dump.active)
+        return;
+
+    // A few messages per pass keeps the main loop responsive; the UART
+    // drains about one 89 byte message every 30ms anyway. A message that
+    // can't go (UART queue full, USB endpoint busy) ends the pass and is
+    // sent again next time, nothing is skipped.
+    uint8_t msg[KaliSysex::MAX_MESSAGE];
+    for (int n = 0; n < 4 && sysex_dump.active; n++)
     {
-        if (slot < 0)
-            slot = 0;
-        if (slot >= MAX_PRESETS)
-            slot = MAX_PRESETS - 1;
-        return MAIN_PRESET_BASE + static_cast<uint32_t>(slot) * MAIN_PRESET_SECTOR;
+        SysexDump &d = sysex_dump;
+        uint32_t size;
+        sysex_section_size(d.section, size);
+
+        // Empty preset slots are not worth sending; the config is always there
+        uint8_t chunk_data[KaliSysex::CHUNK];
+        if (d.stage == 0 && d.section != KaliSysex::SECTION_CONFIG && !ReadSysexSection(d.section, 0, chunk_data, 1))
+        {
+            d.stage = 3;
+            if (!d.all)
+                SendSysexAck(d.source, d.section, KaliSysex::BAD_CONTENT);
+        }
+
+        size_t len = 0;
+        if (d.stage == 0)
+        {
+            len = KaliSysex::EncodeWord(msg, KaliSysex::BEGIN, d.section, size);
+        }
+        else if (d.stage == 1)
+        {
+            uint32_t chunk = size - d.offset;
+            if (chunk > KaliSysex::CHUNK)
+                chunk = KaliSysex::CHUNK;
+            if (!ReadSysexSection(d.section, d.offset, chunk_data, chunk))
+            {
+                // Moved or deleted under us; the END checksum would not match anyway
+                d.active = false;
+                SendSysexAck(d.source, d.section, KaliSysex::BAD_CONTENT);
+                return;
+            }
+            len = KaliSysex::Encode(msg, KaliSysex::DATA, d.section, d.seq, chunk_data, chunk);
+            if (!SendSysex(d.source, msg, len))
+                return;
+            KaliSysex::Checksum(d.checksum, chunk_data, chunk);
+            d.offset += chunk;
+            d.seq++;
+            if (d.offset >= size)
+                d.stage = 2;
+            continue;
+        }
+        else if (d.stage == 2)
+        {
+            len = KaliSysex::EncodeWord(msg, KaliSysex::END, d.section, d.checksum);
+        }
+
+        if (len > 0 && !SendSysex(d.source, msg, len))
+            return;
+
+        if (d.stage == 0)
+        {
+            d.stage = 1;
+            d.offset = 0;
+            d.seq = 0;
+            d.checksum = KaliSysex::CHECKSUM_INIT;
+        }
+        else if (!d.all || d.section >= MAX_PRESETS)
+        {
+            d.active = false;
+        }
+        else
+        {
+            d.section++;
+            d.stage = 0;
+        }
+    }
+}
+
+void Kali::HandleSysex(const KaliSysexPacket &packet)
+{
+    KaliSysex::Header h = {0, 0, 0};
+    uint8_t data[KaliSysex::CHUNK];
+    size_t len = 0;
+    const uint8_t status = KaliSysex::Decode(packet.data, packet.length, h, data, len);
+    if (status == KaliSysex::BAD_CONTENT)
+        return; // someone else's SysEx
+    if (status != KaliSysex::OK)
+    {
+        sysex_restore.active = false;
+        SendSysexAck(packet.source, h.section, status);
+        return;
+    }
+
+    SysexRestore &r = sysex_restore;
+    uint32_t size = 0;
+    const bool known = sysex_section_size(h.section, size);
+    uint8_t *image = reinterpret_cast<uint8_t *>(sysex_image);
+
+    switch (h.command)
+    {
+    case KaliSysex::REQUEST:
+        if (sysex_dump.active || r.active)
+        {
+            SendSysexAck(packet.source, h.section, KaliSysex::BUSY);
+            break;
+        }
+        if (!known && h.section != KaliSysex::SECTION_ALL)
+        {
+            SendSysexAck(packet.source, h.section, KaliSysex::BAD_SECTION);
+            break;
+        }
+        sysex_dump.active = true;
+        sysex_dump.source = packet.source;
+        sysex_dump.all = (h.section == KaliSysex::SECTION_ALL);
+        sysex_dump.section = sysex_dump.all ? KaliSysex::SECTION_CONFIG : h.section;
+        sysex_dump.stage = 0;
+        break;
+
+    case KaliSysex::BEGIN:
+        if (sysex_dump.active)
+        {
+            SendSysexAck(packet.source, h.section, KaliSysex::BUSY);
+            break;
+        }
+        if (!known)
+        {
+            SendSysexAck(packet.source, h.section, KaliSysex::BAD_SECTION);
+            break;
+        }
+        if (len != 4 || KaliSysex::ReadWord(data) != size)
+        {
+            SendSysexAck(packet.source, h.section, KaliSysex::BAD_SIZE);
+            break;
+        }
+        // Nothing is stored until END, so there is nothing to prepare either;
+        // the sender still waits for this before DATA
+        r.active = true;
+        r.source = packet.source;
+        r.section = h.section;
+        r.offset = 0;
+        r.seq = 0;
+        r.checksum = KaliSysex::CHECKSUM_INIT;
+        SendSysexAck(packet.source, h.section, KaliSysex::OK);
+        break;
+
+    case KaliSysex::DATA:
+        if (!r.active || h.section != r.section)
+            break;
+        if (h.seq != r.seq || r.offset + len > size)
+        {
+            r.active = false;
+            SendSysexAck(packet.source, h.section,
+                         h.seq != r.seq ? KaliSysex::BAD_SEQUENCE : KaliSysex::BAD_SIZE);
+            break;
+        }
+        memcpy(image + r.offset, data, len);
+        KaliSysex::Checksum(r.checksum, data, len);
+        r.offset += len;
+        r.seq++;
+        break;
+
+    case KaliSysex::END:
+    {
+        if (!r.active || h.section != r.section)
+            break;
+        r.active = false;
+
+        uint8_t result = KaliSysex::OK;
+        if (r.offset != size)
+            result = KaliSysex::BAD_SIZE;
+        else if (len != 4 || KaliSysex::ReadWord(data) != r.checksum)
+            result = KaliSysex::BAD_CHECKSUM;
+        else if (h.section == KaliSysex::SECTION_CONFIG)
+        {
+            auto *hdr = reinterpret_cast<const ConfigHeader *>(image);
+            auto *config = reinterpret_cast<const OptimizedKaliConfig *>(image + sizeof(ConfigHeader));
+            if (KaliVersionManager::needsInitialization(*hdr) ||
+                hdr->checksum != KaliVersionManager::calculateChecksum(config, sizeof(OptimizedKaliConfig)))
+                result = KaliSysex::BAD_CONTENT;
+            else if (!KaliVersionManager::writeConfig(store, *config))
+                result = KaliSysex::BUSY;
+            else
+                LoadOptions(false);
+        }
+        else
+        {
+            auto *e = reinterpret_cast<const MainPresetEntry *>(image);
+            if (e->magic != MAIN_PRESET_MAGIC || e->version != MAIN_PRESET_VERSION)
+                result = KaliSysex::BAD_CONTENT;
+            else if (!store.Put(preset_slot_key(h.section - 1), image, sizeof(MainPresetEntry)))
+                result = KaliSysex::BUSY;
+            else
+            {
+                morph_source = -1; // decode a morph pair again in case it uses this slot
+                CachePresetName(h.section - 1, e);
+            }
+        }
+        // A rejected restore leaves the stored section as it was
+        SendSysexAck(packet.source, h.section, result);
+        break;
+    }
+
+    default:
+        break;
     }
 }
 
@@ -1981,14 +2558,9 @@ bool Kali::ReadMainPresetMeta(int slot, char *name_out, bool &valid)
     valid = false;
     if (!name_out)
         return false;
-    uint32_t addr = preset_slot_addr(slot);
-    auto *entry = reinterpret_cast<const MainPresetEntry *>(patch.qspi.GetData(addr));
-    if (entry && entry->magic == MAIN_PRESET_MAGIC && entry->version == MAIN_PRESET_VERSION)
-    {
-        // Copy name (ensure null-termination)
-        for (int i = 0; i < 15; ++i)
-            name_out[i] = entry->name[i];
-        name_out[15] = '\0';
+    if (slot >= 0 && slot < MAX_PRESETS && preset_named[slot])
+    {
+        memcpy(name_out, preset_names[slot], sizeof(preset_names[slot]));
         valid = true;
         return true;
     }
@@ -1996,7 +2568,161 @@ bool Kali::ReadMainPresetMeta(int slot, char *name_out, bool &valid)
     return false;
 }
 
-void Kali::SaveMainPreset(int slot)
+void Kali::CachePresetName(int slot, const MainPresetEntry *e)
+{
+    if (slot < 0 || slot >= MAX_PRESETS)
+        return;
+    preset_named[slot] = e != nullptr;
+    // Copy name (ensure null-termination)
+    for (int i = 0; i < 15; ++i)
+        preset_names[slot][i] = e ? e->name[i] : '\0';
+    preset_names[slot][15] = '\0';
+}
+
+void Kali::ServicePresets()
+{
+    const int save = preset_save_request.load();
+    if (save >= 0 && SaveMainPreset(save))
+        preset_save_request = -1; // otherwise retried once the store has caught up
+
+    const int load = preset_load_request.exchange(-1);
+    if (load >= 0)
+        LoadMainPreset(load);
+
+    ServiceMorph();
+}
+
+#if ENABLE_SD_CARD
+// 1 s of four channel audio
+static float DSY_SDRAM_BSS record_fifo[1 << 18];
+
+void Kali::InitRecorder()
+{
+    SdmmcHandler::Config sd_cfg;
+    sd_cfg.Defaults();
+    sdcard.Init(sd_cfg);
+    fsi.Init(FatFSInterface::Config::MEDIA_SD);
+    sd_mounted = f_mount(&fsi.GetSDFileSystem(), fsi.GetSDPath(), 1) == FR_OK;
+    recorder.Init(record_fifo, sizeof(record_fifo) / sizeof(record_fifo[0]), patch.AudioSampleRate(), RECORD_TRANSFER);
+    SetOptionValue(OptionsPages::SdRecord, RECORD_OFF); // a saved config never starts a take at boot
+}
+
+void Kali::ServiceRecorder()
+{
+    const int mode = static_cast<int>(GetValue(OptionsPages::SdRecord));
+    if (mode != record_mode)
+    {
+        // Any change ends the take; a new one starts once the old file is closed
+        recorder.Stop();
+        record_mode = mode;
+        record_start_pending = mode != RECORD_OFF;
+    }
+
+    recorder.Service();
+
+    if (record_start_pending && !recorder.Recording())
+    {
+        record_start_pending = false;
+        if (!sd_mounted)
+            return;
+
+        char name[16];
+        FILINFO info;
+        do
+        {
+            snprintf(name, sizeof(name), "KALI%04d.WAV", record_index++);
+        } while (record_index < 10000 && f_stat(name, &info) == FR_OK);
+
+        if (!recorder.Start(name, mode == RECORD_OUT_IN))
+            record_errors++;
+    }
+}
+
+void Kali::ServiceSampleLoader()
+{
+    const int n = static_cast<int>(GetValue(OptionsPages::SdLoadSample));
+    if (n > 0)
+    {
+        // One-shot action, like the preset loads
+        SetOptionValue(OptionsPages::SdLoadSample, 0);
+        sample_loader.Cancel();
+
+        char name[16];
+        snprintf(name, sizeof(name), "SAMPLE%02d.WAV", n);
+        float *lines[4];
+        size_t bases[4];
+        for (int j = 0; j < 4; j++)
+        {
+            lines[j] = delays[j]->GetLine();
+            bases[j] = delays[j]->GetWritePtr();
+        }
+        // Only as much as the current delay range can reach
+        if (!sample_loader.Start(&sample_file, name, lines, bases, 4, MAX_DELAY,
+                                 static_cast<size_t>(MAX_DELAY_WORKING), patch.AudioSampleRate()))
+            return;
+    }
+    sample_loader.Step();
+}
+#endif
+
+void Kali::ServiceMorph()
+{
+    const int source = static_cast<int>(GetValue(OptionsPages::MorphSource));
+    const int from = static_cast<int>(GetValue(OptionsPages::MorphFrom)) - 1;
+    const int to = static_cast<int>(GetValue(OptionsPages::MorphTo)) - 1;
+    if (source == morph_source && from == morph_from && to == morph_to)
+        return;
+    morph_source = source;
+    morph_from = from;
+    morph_to = to;
+
+    morph.Stop();
+    if (source != MORPH_MANUAL && source != MORPH_CV)
+        return; // Time mode waits for a preset load
+
+    // Load() copies both entries, so the record pointers only need to last until then
+    const MainPresetEntry *a = ReadMainPreset(from);
+    const MainPresetEntry *b = ReadMainPreset(to);
+    if (a && b)
+        morph.Load(*a, *b);
+}
+
+void Kali::UpdateMorph(size_t size)
+{
+    const int source = static_cast<int>(GetValue(OptionsPages::MorphSource));
+    switch (source)
+    {
+    case MORPH_MANUAL:
+        morph.Process(GetValue(OptionsPages::MorphPosition) * 0.01f);
+        break;
+    case MORPH_CV:
+        morph.Process(inp.Knobs[Kali::CV::DELAY_ADJUST].Value());
+        break;
+    case MORPH_TIME:
+        if (morph_glide_pending.exchange(false))
+        {
+            morph.Start();
+            for (int i = 0; i < 8; ++i)
+                inp.Knobs[i].EnableSoftTakeover(preset_loaded.knob_snapshot[i]);
+            morph_glide_pos = 0.f;
+            morph_gliding = true;
+        }
+        if (!morph_gliding)
+            break;
+        morph_glide_pos += size / (patch.AudioSampleRate() * GetValue(OptionsPages::MorphTime));
+        if (morph_glide_pos >= 1.f)
+        {
+            morph_glide_pos = 1.f;
+            morph_gliding = false; // options now hold the loaded preset and are free to edit
+        }
+        morph.Process(morph_glide_pos);
+        break;
+    default:
+        break;
+    }
+}
+
+bool Kali::SaveMainPreset(int slot)
 {
     MainPresetEntry e{};
     e.magic = MAIN_PRESET_MAGIC;
@@ -2014,6 +2740,26 @@ void Kali::SaveMainPreset(int slot)
     // Store this as last selected slot
     e.last_selected_slot = static_cast<uint8_t>(slot);
 
+    CaptureMainPreset(e);
+
+    // Staged only, programmed a page at a time by store.Step()
+    if (!store.Put(preset_slot_key(slot), &e, sizeof(e)))
+        return false;
+    CachePresetName(slot, &e);
+
+    // A morph pair using this slot is decoded again
+    if (slot == morph_from || slot == morph_to)
+        morph_source = -1;
+
+    // Cache last name for UI popup
+    for (int i = 0; i < 15; ++i)
+        last_preset_name[i] = e.name[i];
+    last_preset_name[15] = '\0';
+    return true;
+}
+
+void Kali::CaptureMainPreset(MainPresetEntry &e)
+{
     // Copy 6 LFOs (0..5)
     for (int i = 0; i < 6; ++i)
     {
@@ -2027,78 +2773,91 @@ void Kali::SaveMainPreset(int slot)
     {
         e.dsp[j] = OptionRules[BankType::DSP][j]->Value;
     }
+}
 
-    uint32_t addr = preset_slot_addr(slot);
-    // Erase sector, then write
-    patch.qspi.Erase(addr, addr + MAIN_PRESET_SECTOR);
-    patch.qspi.Write(addr, sizeof(MainPresetEntry), reinterpret_cast<uint8_t *>(&e));
-
-    // Cache last name for UI popup
-    for (int i = 0; i < 15; ++i)
-        last_preset_name[i] = e.name[i];
-    last_preset_name[15] = '\0';
+const MainPresetEntry *Kali::ReadMainPreset(int slot)
+{
+    if (slot < 0 || slot >= MAX_PRESETS)
+        return nullptr;
+    uint32_t len;
+    auto *e = reinterpret_cast<const MainPresetEntry *>(store.Get(preset_slot_key(slot), len));
+    if (!e || len != sizeof(MainPresetEntry) || e->magic != MAIN_PRESET_MAGIC || e->version != MAIN_PRESET_VERSION)
+        return nullptr;
+    return e;
 }
 
 bool Kali::LoadMainPreset(int slot)
 {
-    uint32_t addr = preset_slot_addr(slot);
-    auto *e = reinterpret_cast<const MainPresetEntry *>(patch.qspi.GetData(addr));
-    if (!e || e->magic != MAIN_PRESET_MAGIC || e->version != MAIN_PRESET_VERSION)
+    const MainPresetEntry *e = ReadMainPreset(slot);
+    if (!e)
         return false;
 
+    // A load already waiting to be applied is simply replaced
+    preset_apply_pending = false;
+    morph_glide_pending = false;
+    preset_loaded = *e;
+    if (GetValue(OptionsPages::MorphSource) == MORPH_TIME)
+    {
+        // Glide there from wherever the options are now, no engine reset
+        CaptureMainPreset(morph_capture);
+        morph.Prepare(morph_capture, *e);
+        morph_glide_pending = true;
+    }
+    else
+    {
+        preset_apply_pending = true;
+    }
+
+    // Cache last name for UI
+    for (int i = 0; i < 15; ++i)
+        last_preset_name[i] = e->name[i];
+    last_preset_name[15] = '\0';
+
+    // Save this as last selected slot
+    SaveLastSelectedPresetSlot(slot);
+
+    return true;
+}
+
+void Kali::ApplyMainPreset(const MainPresetEntry &e)
+{
     // Apply to runtime
     for (int i = 0; i < 6; ++i)
     {
         for (int j = 0; j < LFOOptionsPages::KALI_LFO_OPTIONS_LAST; ++j)
         {
-            warble[i].preset.Options[j] = e->lfo[i][j];
+            warble[i].preset.Options[j] = e.lfo[i][j];
         }
     }
     for (int j = 0; j < DSPOptionsPages::KALI_DSP_OPTIONS_LAST; ++j)
     {
-        OptionRules[BankType::DSP][j]->Value = e->dsp[j];
+        OptionRules[BankType::DSP][j]->Value = e.dsp[j];
     }
 
     // Enable soft takeover for the 8 main knobs using saved snapshot
     for (int i = 0; i < 8; ++i)
     {
-        inp.Knobs[i].EnableSoftTakeover(e->knob_snapshot[i]);
+        inp.Knobs[i].EnableSoftTakeover(e.knob_snapshot[i]);
     }
 
     // Reset some engines to ensure clean state after large changes
     ResetAllThings();
-
-    // Cache last name for UI
-    for (int i = 0; i < 15; ++i)
-        last_preset_name[i] = e->name[i];
-    last_preset_name[15] = '\0';
-
-    // Save this as last selected slot
-    SaveLastSelectedPresetSlot(slot);
-
-    return true;
 }
 
 void Kali::SaveLastSelectedPresetSlot(int slot)
 {
-    PersistentConfig cfg{};
-    cfg.magic = PERSISTENT_CONFIG_MAGIC;
-    cfg.last_preset_slot = static_cast<uint8_t>(slot);
-
-    // Write to QSPI
-    patch.qspi.Erase(PERSISTENT_CONFIG_ADDR, PERSISTENT_CONFIG_ADDR + 4096);
-    patch.qspi.Write(PERSISTENT_CONFIG_ADDR, sizeof(PersistentConfig),
-                     reinterpret_cast<uint8_t *>(&cfg));
+    // One byte record, and none at all when the slot is unchanged
+    const uint8_t last = static_cast<uint8_t>(slot);
+    store.Put(KEY_LAST_SLOT, &last, 1);
 }
 
 int Kali::LoadLastSelectedPresetSlot()
 {
-    auto *cfg = reinterpret_cast<const PersistentConfig *>(
-        patch.qspi.GetData(PERSISTENT_CONFIG_ADDR));
-
-    if (cfg && cfg->magic == PERSISTENT_CONFIG_MAGIC)
+    uint32_t len;
+    const uint8_t *last = store.Get(KEY_LAST_SLOT, len);
+    if (last && len == 1 && *last < MAX_PRESETS)
     {
-        return static_cast<int>(cfg->last_preset_slot);
+        return static_cast<int>(*last);
     }
 
     return 0; // Default to slot 0
@@ -2142,6 +2901,18 @@ int lastdacatten = -1;
 /*
  * TIM2 IRQ HANDLER
  */
+// Gate 1 (PG13) shares this vector with the rest of lines 10-15
+extern "C" void EXTI15_10_IRQHandler(void)
+{
+    kali.gate1_capture.OnInterrupt();
+}
+
+// Only the boot time delay line clear uses the MDMA
+extern "C" void MDMA_IRQHandler(void)
+{
+    kali.delay_clear.OnInterrupt();
+}
+
 void handlar(void *data)
 {
     // Timer ISR: Avoid heavy/blocking I2C OLED operations here.
@@ -2152,15 +2923,12 @@ void handlar(void *data)
         kali.displaycountdown--;
     }
 
-    /*
-    TODO: This is for midi clock out but it was interrupting other time
-    sensitive things, very jittery. Leaving here just in case.
+    // Next interpolated expander CV frame, if the block has one left
+    kali.patch.TickCvOutExp();
 
-    if(!kali.midi_clock_flag && kali.queue_midi_clock) {
-        patch.MIDISendClock();
-        kali.queue_midi_clock = false;
-    }
-    */
+    // Timestamp incoming MIDI as close to reception as we can get
+    kali.midibus.PollUart(kali.patch.midi_uart);
+    kali.midibus.PollUsb(kali.patch.usb_midi);
 }
 
 void Kali::HandleEncoders(KaliInput *inp)
@@ -2284,7 +3052,7 @@ void Kali::LoadOptions(bool init)
     }
     else
     {
-        wasInitialized = KaliVersionManager::readConfig(patch, config);
+        wasInitialized = KaliVersionManager::readConfig(store, config);
     }
 
     // Transfer config data to actual objects (only first 6 LFOs are stored in config)
@@ -2309,9 +3077,11 @@ void Kali::LoadOptions(bool init)
     }
 }
 
-void Kali::SaveOptions()
+bool Kali::SaveOptions()
 {
-    OptimizedKaliConfig config;
+    // Start from what is stored so the preset banks carry over and only the
+    // sections that really changed get written
+    OptimizedKaliConfig config = KaliVersionManager::persistedConfig();
 
     // Copy current state to config
     for (int i = 0; i < OptionsPages::KALI_OPTIONS_LAST; i++)
@@ -2332,7 +3102,7 @@ void Kali::SaveOptions()
         config.DSPOptions[i] = OptionRules[BankType::DSP][i]->Value;
     }
 
-    KaliVersionManager::writeConfig(patch, config);
+    return KaliVersionManager::writeConfig(store, config);
 }
 
 int main(void)
@@ -2360,6 +3130,7 @@ int main(void)
 
     kali.patch.SetAudioSampleRate(samplerate);
     kali.patch.SetAudioBlockSize(96);
+    kali.inp.InitFilters(kali.patch.AudioCallbackRate());
 
     kali.patch.Delay(20);
 
@@ -2381,6 +3152,7 @@ int main(void)
     disp_cfg.driver_config.transport_config.i2c_config.pin_config.scl = DPT::B7;
     disp_cfg.driver_config.transport_config.i2c_config.pin_config.sda = DPT::B8;
     disp_cfg.driver_config.transport_config.i2c_address = 0x3c;
+    disp_cfg.driver_config.transport_config.dma_buffer = oled_dma;
 
     I2CHandle i2c_oled;
     i2c_oled.Init(disp_cfg.driver_config.transport_config.i2c_config);
@@ -2418,7 +3190,7 @@ int main(void)
     }
 
     /*
-    // display.driver_.SetContrast(0xi0);
+    // display.GetDriver().SetContrast(0xi0);
     for (int blinking = 0; blinking < 3; blinking++)
     {
         for (frame = 0; frame < frame_count; frame++)
@@ -2445,31 +3217,47 @@ int main(void)
     display.Update();
     */
 
+    kali.midibus.Init();
+    kali.midiout.Init(USART1);
+    kali.timebase.Init(96);
+    kali.gate1_capture.Init(DPT::B10);
+    const dsy_gpio_pin gate_pins[2] = {kali.patch.gate_out_1.pin, kali.patch.gate_out_2.pin};
+    kali.gate_scheduler.Init(gate_ring, gate_pins, 2, kali.patch.AudioSampleRate(), 96);
+
+#if ENABLE_SD_CARD
+    kali.InitRecorder();
+#endif
+    // Normally long done by now: the clear runs under the fixed delays above
+    kali.delay_clear.Wait();
+    kali.RestoreSnapshotAtBoot();
+    kali.boot_ms = System::GetNow();
+    // The audio callback runs in the SAI1 DMA interrupts. One level down, the
+    // MIDI out service timer and the gate 1 EXTI preempt it instead of waiting
+    // for the block to finish
+    HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, 1, 0);
+    HAL_NVIC_SetPriority(DMA1_Stream1_IRQn, 1, 0);
     kali.patch.StartAudio(AudioCallback);
+    // TIM5 ticks at ~2.1kHz, enough for 4 expander CV frames per 2ms block
+    kali.patch.SetCvOutExpFrames(4);
     kali.patch.InitTimer(handlar, nullptr);
 
     kali.inp.ProcessControls(&kali.patch);
 
-    kali.patch.midi.StartReceive();
+    kali.patch.midi_uart.StartRx();
+    kali.patch.usb_midi.StartRx();
 
     // kali.SaveOptions();
     // kali.patch.Delay(10);
 
-    // UI/OLED + MIDI + maintenance loop (decoupled from ISR/audio)
+    // UI/OLED + maintenance loop (decoupled from ISR/audio)
     uint32_t last_oled_ms = 0;
     const uint32_t min_oled_interval_ms = 33; // ~30 fps
-    uint32_t last_midi_ms = 0;
-    const uint32_t midi_poll_interval_ms = 1; // poll MIDI frequently in main loop
     while (1)
     {
         uint32_t now_ms = System::GetNow();
 
-        // Poll MIDI in main loop (not ISR)
-        if (now_ms - last_midi_ms >= midi_poll_interval_ms)
-        {
-            kali.HandleMIDI();
-            last_midi_ms = now_ms;
-        }
+        kali.ServiceSysex();
+        kali.ServicePresets();
 
         // Deferred saves and codec attenuation updates (avoid ISR work)
         if (kali.saveSettings)
@@ -2479,10 +3267,19 @@ int main(void)
                 kali.LoadOptions(kali.initSettings);
                 kali.initSettings = false;
             }
-            kali.SaveOptions();
-            kali.saveSettings = false;
+            // Only staged here; kept pending while the store is still busy with the last one
+            if (kali.SaveOptions())
+                kali.saveSettings = false;
         }
 
+        // Background flash work: a few pages, or one sector erase, per pass
+        kali.store.Step();
+        kali.ServiceSnapshot();
+#if ENABLE_SD_CARD
+        kali.ServiceRecorder();
+        kali.ServiceSampleLoader();
+#endif
+
         // Ensure sane attenuation defaults, and apply when changed
         if (kali.GetValue(OptionsPages::AdcAttenuation) == 0)
         {
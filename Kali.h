@@ -26,11 +26,31 @@
 #include "KaliSpread.h"
 #include "DelayPhasor.h"
 #include "KaliMIDI.h"
+#include "KaliMIDIBus.h"
+#include "KaliTimebase.h"
+#include "KaliGateCapture.h"
+#include "KaliGateScheduler.h"
+#include "KaliMIDIOut.h"
+#include "KaliSysex.h"
 #include "KaliVersion.h"
+#include "KaliRecordStore.h"
+#include "KaliQspiFlash.h"
+#include "KaliPresetLayout.h"
+#include "KaliPresetMorph.h"
+#include "KaliRecorder.h"
+#include "KaliSampleLoader.h"
+#include "KaliSnapshot.h"
+#include "KaliMemClear.h"
+#if ENABLE_SD_CARD
+#include "KaliSdFile.h"
+#endif
 #include "KaliFreezeEngine.h"
 #include "EnvelopeFollower.h" // Include the new header
+#include "KaliTelemetry.h"
+#include "KaliSpectrum.h"
 #include "stringtables.h"
 #include <memory>
+#include <atomic>
 #include <map>
 // Add to Kali class:
 
@@ -63,18 +83,27 @@ public:
     bool midi_clock_flag = false;
     bool midi_activity = false;
 
+    // Timestamped MIDI input, filled by the timer ISR and drained by the audio callback
+    KaliMIDIBus midibus;
+    KaliTimebase timebase;
+    // Realtime echo and generated MIDI clock, sent from the TIM4 interrupt
+    KaliMIDIOut midiout;
+    KaliClockOutput midi_clock_gen; // 24 PPQN tick train locked to masterclock
+    bool midi_clock_out_running = false;
+    static const int MAX_MIDI_CLOCKS_PER_BLOCK = 8;
+    // Gate 1 clock edges, stamped in the EXTI interrupt
+    KaliGateCapture gate1_capture;
+
     float diffpll;
     // CpuLoadMeter cpu;
 
     KaliClock masterclock;
 
-    // PLL variables for phase-locked clock outputs
-    int left_clock_phase_accumulator = 0;  // Tracks phase for left output
-    int right_clock_phase_accumulator = 0; // Tracks phase for right output
-    bool left_clock_state = false;         // Current left output state
-    bool right_clock_state = false;        // Current right output state
-    int left_gate_timer = 0;               // Gate pulse duration for left
-    int right_gate_timer = 0;              // Gate pulse duration for right
+    // Phase-locked clock outputs, edges computed once per block
+    KaliClockOutput clock_out[2];
+    KaliGateScheduler gate_scheduler;
+    bool left_clock_state = false;  // High at some point during the last block
+    bool right_clock_state = false;
 
     float frequencybase[2], samps[2];
 
@@ -98,7 +127,6 @@ public:
     float slewtime = size * 16;
 
     // Smoothing for external sync range updates to reduce jitter
-    float smoothed_samples_per_beat = 24000.0f; // Default 120 BPM
     float last_calculated_min = 4.f;
     float last_calculated_max = MAX_DELAY;
 
@@ -121,6 +149,14 @@ public:
     float delaytimes[8]; // boop n koko - delay time l / r
     float delaytargets[4];
 
+    // Keyboard tracking: glided delay times for the held note, slewed once per block
+    float keytrack_times[2] = {0.f, 0.f};
+    bool keytrack_active = false;
+    float keytrack_glide_ms = -1.f; // glide the coefficient was computed for
+    float keytrack_coef = 1.f;
+    float KeyTrackTime(float period, float knob_time, int mode) const;
+    void UpdateKeyTracking(size_t size);
+
     // toggles
     bool lfo_unlink;
     // bool delay_unlink;
@@ -207,9 +243,11 @@ public:
     KaliDSP dsp;
     // KaliH949DSP pdsp;
 
-    /* a few things for reference on oled */
-    float last_sample_in[4];
-    float last_sample_out[4];
+    /* probes for the oled, written once per block by the audio callback */
+    KaliTelemetry telemetry;
+    /* output spectrum and meters, fed only while the page is up */
+    KaliSpectrum spectrum;
+    uint32_t spectrum_us = 0; // time the last Analyze() took
     float new_normal;
     float ppqn[4];
 
@@ -229,7 +267,7 @@ public:
     // float apbuf[2][512];
     // Allpass ap[2];
 
-    EnvelopeFollower<2, float> Follower;
+    EnvelopeFollower<2> Follower;
 
     float damp_scaled = 0.5;
 
@@ -258,14 +296,10 @@ public:
 
     bool TriggerReceived;
 
-    bool queue_midi_clock;
-
     bool periodically_sync;
 
     KaliEditState editstate;
 
-    EnvelopeFollower<2, float> follower;
-
     KaliPlayheadEngine playhead_engine;
 
     void HitTick(size_t blocksize);
@@ -278,7 +312,12 @@ public:
 
     void SetLFOMode(int8_t, uint8_t);
 
-    void HandleMIDI();
+    /**
+     * @brief Apply queued MIDI input that belongs to the current audio block
+     * @param clock_offsets Receives the sample offset of each TimingClock in this block
+     * @return Number of clock offsets written (at most MAX_MIDI_CLOCKS_PER_BLOCK)
+     */
+    int ProcessMIDIEvents(uint8_t *clock_offsets);
 
     void HandleCallbackSync();
     void HandleSyncTrigger();
@@ -342,10 +381,11 @@ public:
     void DrawActivityIndicators();
     void PrintToScreen(const daisy::Rectangle screen, const Alignment alignment, const FontDef f, bool on, const char *format, ...);
     void PrintLfoInfo(const daisy::Rectangle &screen, KaliOscillator *curr_lfo, KaliOption *option);
-    void DrawLfoWaveform(KaliOscillator *curr_lfo);
+    void DrawLfoWaveform(int lfo_index);
     void UpdateLfoEditScreen(const daisy::Rectangle &screen);
     void UpdateOptionsScreen(const daisy::Rectangle &screen);
     void UpdateDspEditScreen(const daisy::Rectangle &screen);
+    void UpdateSpectrumScreen(const daisy::Rectangle &screen);
 #ifndef NDEBUG
     void UpdateDebugScreen(const daisy::Rectangle &screen);
     void UpdateMIDIScreen(const daisy::Rectangle &screen);
@@ -376,6 +416,7 @@ public:
         statesByMode[KaliEditState::LFO_EDIT] = &KaliConfigOscState::getInstance();
         statesByMode[KaliEditState::OPTIONS] = &KaliConfigState::getInstance();
         statesByMode[KaliEditState::DSP_EDIT] = &KaliDSPConfigState::getInstance();
+        statesByMode[KaliEditState::SPECTRUM] = &KaliSpectrumState::getInstance();
         statesByMode[KaliEditState::PRESETS] = &KaliPresetsState::getInstance();
         statesByMode[KaliEditState::MIDI_MODE] = &KaliMIDIState::getInstance();
         statesByMode[KaliEditState::DEBUG_MODE] = &KaliDebugState::getInstance();
@@ -396,7 +437,7 @@ public:
         // Skip debug type panels if it's disabled
         if (!DEBUG_MODE)
         {
-            newstate = DSY_CLAMP(newstate, 0, KaliEditState::DSP_EDIT); // kinda awkward looking, whatever
+            newstate = DSY_CLAMP(newstate, 0, KaliEditState::SPECTRUM); // kinda awkward looking, whatever
         }
         else
         {
@@ -648,17 +689,130 @@ public:
     }
     KaliOptions *data; // data in memory
     KaliOptions options;
-    void SaveOptions();
+    bool SaveOptions(); // false if the store had no room, try again later
     void SaveLFOPreset(int, int);
     void LoadLFOPreset(int, int);
     void SaveDSPPreset();
     void LoadOptions(bool init);
-    // Combined main preset (6 LFOs + 1 DSP) stored in QSPI
-    void SaveMainPreset(int slot);
+    // Config and main presets live in a log-structured record store on QSPI.
+    // Only the main loop touches it; Step() does the flash work a little at a time.
+    KaliQspiFlash qspi_flash;
+    KaliRecordStore store;
+    void MountStore();
+    void ImportLegacyStore();
+
+    // Combined main preset (6 LFOs + 1 DSP). The UI runs in the audio callback,
+    // so it only posts requests; ServicePresets() does them from the main loop
+    // and a loaded preset is handed back to the audio callback to apply.
+    void RequestPresetSave(int slot) { preset_save_request = slot; }
+    void RequestPresetLoad(int slot) { preset_load_request = slot; }
+    void ServicePresets();
+    bool SaveMainPreset(int slot);
     bool LoadMainPreset(int slot);
+    void ApplyMainPreset(const MainPresetEntry &e);
     bool ReadMainPresetMeta(int slot, char *name_out, bool &valid);
+    // Names of the stored main presets, kept up to date on every Put() and at
+    // mount, so drawing the preset page never waits on a store erase
+    char preset_names[MAX_PRESETS][16];
+    bool preset_named[MAX_PRESETS];
+    void CachePresetName(int slot, const MainPresetEntry *e);
     void SaveLastSelectedPresetSlot(int slot);
     int LoadLastSelectedPresetSlot();
+    std::atomic<int> preset_save_request{-1};
+    std::atomic<int> preset_load_request{-1};
+    MainPresetEntry preset_loaded;
+    std::atomic<bool> preset_apply_pending{false};
+    void CaptureMainPreset(MainPresetEntry &e);
+    const MainPresetEntry *ReadMainPreset(int slot);
+
+    // Morphing between two presets. ServiceMorph() (main loop) keeps the
+    // From/To pair decoded, UpdateMorph() (audio callback) moves the position.
+    // In Time mode a preset load glides there from the current settings.
+    KaliPresetMorph morph;
+    void ServiceMorph();
+    void UpdateMorph(size_t size);
+    int morph_source = -1; // source the decoded pair was set up for
+    int morph_from = -1;
+    int morph_to = -1;
+    MainPresetEntry morph_capture;
+    std::atomic<bool> morph_glide_pending{false};
+    bool morph_gliding = false;
+    float morph_glide_pos = 0.f;
+
+    // Zeroes the SDRAM delay lines in the background during boot
+    KaliMemClear delay_clear;
+    uint32_t boot_ms = 0; // System::GetNow() when the audio started
+
+    // Frozen delay contents kept on QSPI, saved and restored a slice per main loop pass
+    KaliSnapshot snapshot;
+    int snapshot_mode = SNAPSHOT_MANUAL; // what the Snapshot option falls back to after an action
+    void ServiceSnapshot();
+    bool StartSnapshot(bool save);
+    void RestoreSnapshotAtBoot();
+
+#if ENABLE_SD_CARD
+    // Recording to SD card, driven by the Record option. The audio callback
+    // only pushes into the recorder's FIFO; the card is written from the main loop.
+    static const size_t RECORD_TRANSFER = 16384;
+    SdmmcHandler sdcard;
+    FatFSInterface fsi;
+    bool sd_mounted = false;
+    KaliRecorder<WavWriter<RECORD_TRANSFER>> recorder;
+    int record_mode = RECORD_OFF; // Record option value last acted on
+    bool record_start_pending = false;
+    int record_index = 0; // next KALInnnn.WAV to try
+    uint32_t record_errors = 0;
+    void InitRecorder();
+    void ServiceRecorder();
+
+    // SAMPLEnn.WAV into all four delay lines, a chunk per main loop pass
+    KaliSdFile sample_file;
+    KaliSampleLoader sample_loader;
+    void ServiceSampleLoader();
+#endif
+
+    // SysEx bulk dump / restore of the config and main presets (see KaliSysex.h),
+    // run from the main loop. Dumps read the store a chunk at a time, restores
+    // are collected in RAM and only stored once END checks out.
+    void ServiceSysex();
+    bool ReadSysexSection(uint8_t section, uint32_t offset, uint8_t *out, uint32_t len);
+    void HandleSysex(const KaliSysexPacket &packet);
+    bool SendSysex(uint8_t source, const uint8_t *msg, size_t len);
+    void SendSysexAck(uint8_t source, uint8_t section, uint8_t status);
+
+    // Acks wait here until the transport takes them, sent first thing in ServiceSysex()
+    struct SysexAck
+    {
+        uint8_t source;
+        uint8_t section;
+        uint8_t status;
+    };
+    KaliSpscQueue<SysexAck, 8> sysex_acks;
+
+    // The USB IN endpoint sends straight from here, so it stays put until UsbMidiTxReady()
+    uint8_t sysex_usb_packets[KaliSysex::MAX_USB];
+
+    struct SysexDump
+    {
+        bool active = false;
+        uint8_t source;
+        uint8_t section;
+        bool all;        // walk every section after this one
+        uint8_t stage;   // 0 BEGIN, 1 DATA, 2 END
+        uint32_t offset;
+        uint16_t seq;
+        uint32_t checksum;
+    } sysex_dump;
+
+    struct SysexRestore
+    {
+        bool active = false;
+        uint8_t source;
+        uint8_t section;
+        uint32_t offset;
+        uint16_t seq;
+        uint32_t checksum;
+    } sysex_restore;
 
     uint8_t max_notes = 2;
     uint8_t notes_pos = 0;
@@ -762,82 +916,11 @@ public:
             return 1.0f;
         }
 
-        float A = 1.f + (amount * TWOPI_F * 0.01f);
-        float B = amount * 0.01f;
-        float C = 1.f + (amount * 0.01f);
-        float gain = 0.0f, threshold = 0.0f;
-        float feedback_gain = 1.f;
-
+        const float trim = GetValue(DSPOptionsPages::DistortionTrim, BankType::DSP);
         for (int i = 0; i < 2; ++i)
-        {
-            switch (algo)
-            {
-            case 0: // Sine Distortion
-                dry[i] = sinf(dry[i] * A * 1.5f);
-                feedback_gain = 1.0f;
-                break;
-
-            case 1: // Foldback Distortion
-                gain = fmap(B, 1.f, 10.f, daisysp::Mapping::LINEAR);
-                threshold = fmap(B, 8.0f, 1.0f);
-                dry[i] = KaliDSP::foldback(dry[i] * gain, threshold);
-                feedback_gain = 1.0f; // 0.9f;
-                break;
-
-            case 2: // Tanh Distortion
-                dry[i] = tanhf(dry[i] * A * 2.0f);
-                feedback_gain = 1.0f;
-                break;
-
-            case 3: // Quantizer
-                gain = fmap(B, 1.f, 3.f, daisysp::Mapping::LINEAR);
-                dry[i] = KaliDSP::quantizer(dry[i] * gain, A * 2.0f, B * 2.0f);
-                feedback_gain = 1.0f;
-                break;
-
-            case 4: // Diode Clipper
-                gain = fmap(B, 1.f, 2.f, daisysp::Mapping::LINEAR);
-                threshold = 1.f - fmap(B, 0.25f, 1.0f);
-                dry[i] = KaliDSP::diode(dry[i] * gain, DSY_CLAMP(threshold, 0.f, 1.f));
-                feedback_gain = 1.0f;
-                break;
-
-            case 5: // Hard Clip
-                gain = fmap(B, 1.f, 10.0f, daisysp::Mapping::LINEAR);
-                dry[i] *= gain;
-                dry[i] = (dry[i] < -1.0) ? -1.0f : (dry[i] > 1.0 ? 1.0 : dry[i]);
-                feedback_gain = 1.0f;
-                break;
-
-            case 6: // Soft Clip
-                gain = fmap(B, 1.f, 10.f, daisysp::Mapping::LINEAR);
-                dry[i] *= gain;
-                dry[i] = dry[i] / (1.f + fabsf(dry[i]));
-                feedback_gain = 1.0f;
-                break;
-
-            case 7: // Asymmetric Clipping
-                gain = fmap(B, 1.f, 5.f, daisysp::Mapping::LINEAR);
-                dry[i] *= gain;
-                dry[i] = (dry[i] > 0.f) ? tanhf(dry[i] * A) : dry[i] * B;
-                feedback_gain = 1.0f;
-                break;
-
-            case 8: // Modulo Distortion
-                gain = fmap(B, 1.f, 5.f, daisysp::Mapping::LINEAR);
-                dry[i] *= gain;
-                dry[i] = KaliDSP::modulo(dry[i] * gain, A, B);
-                break;
-
-            default:
-                feedback_gain = 1.0f;
-                break;
-            }
-            float trim = GetValue(DSPOptionsPages::DistortionTrim, BankType::DSP);
-            dry[i] *= trim;
-        }
+            dry[i] = KaliDSP::Distort(dry[i], algo, amount) * trim;
 
-        return feedback_gain;
+        return 1.0f;
     }
 };
 #endif
@@ -55,26 +55,8 @@ void KaliClock::Init(float samplerate_, size_t size_, int internal_ppqn_, int sp
     clock_timeout_counter = 0;
     Mode = Mode_;
 
-    // Initialize averaging buffer with default tempo values if in external mode
-    foravgindex = 0;
-    if (Mode != KaliClockMode::Internal)
-    {
-        // Fill averaging buffer with default SPQN value
-        full = 1; // Start with one entry
-        foravg[0] = spqn;
-        for (int i = 1; i < foravgsize; i++)
-        {
-            foravg[i] = 0;
-        }
-    }
-    else
-    {
-        full = 0;
-        for (int i = 0; i < foravgsize; i++)
-        {
-            foravg[i] = 0;
-        }
-    }
+    // Forget the previous pulse stream; the first pulse after this only anchors timing
+    tracker.Reset();
 
     // Initialize state variables with non-zero values for external modes
     gate = false;
@@ -83,12 +65,17 @@ void KaliClock::Init(float samplerate_, size_t size_, int internal_ppqn_, int sp
     TriggerAccumulator = 0;
     SampleAccumulator = 0;
     TimingAccumulator = 0;
+    block_pos = 0;
+    beat_offset = -1;
+    beat_count = 0;
 
     InitializeMode();
 }
 
 bool KaliClock::Tick(bool TriggerReceived)
 {
+    const int pos = block_pos++;
+
     // Handle gate timing
     if (gate_timer > 0)
     {
@@ -142,6 +129,8 @@ bool KaliClock::Tick(bool TriggerReceived)
                     gate = true;
                     gate_timer = static_cast<int>(one_ms * 5); // 5ms gate pulse
                     TriggerAccumulator = 0;
+                    beat_offset = pos;
+                    beat_count++;
                     return true;
                 }
             }
@@ -152,7 +141,13 @@ bool KaliClock::Tick(bool TriggerReceived)
     else
     {
         SampleAccumulator++;
-        return ProcessInternalClock(spqn / static_cast<float>(internal_ppqn));
+        if (ProcessInternalClock(spqn / static_cast<float>(internal_ppqn)))
+        {
+            beat_offset = pos;
+            beat_count++;
+            return true;
+        }
+        return false;
     }
 }
 
@@ -161,74 +156,39 @@ void KaliClock::ProcessTrigger()
     // Don't generate gate here - that's handled by the unified clock generation
     // This function is purely for timing detection
 
-    // If this is the first trigger, don't try to calculate timing yet
-    if (full == 0)
-    {
-        full++;
-        TimingAccumulator = 0;
-        return;
-    }
-
-    // Store the raw sample count for timing calculations
     int rawSampleCount = TimingAccumulator;
+    TimingAccumulator = 0;
 
-    // Update moving average only if the accumulated samples are reasonable
-    if (rawSampleCount > 0 && rawSampleCount < samplerate) // Limit to reasonable range
-    {
-        // Convert incoming pulse timing to quarter note timing (spqn)
-        int scaledCount;
-
-        if (Mode == KaliClockMode::ClockIn && external_ppqn > 1)
-        {
-            // External clock: scale up to quarter note duration
-            // external_ppqn tells us how many pulses per quarter note we expect
-            scaledCount = rawSampleCount * external_ppqn;
-        }
-        else if (Mode == KaliClockMode::MidiClock)
-        {
-            // MIDI clock: scale up to quarter note duration (24 PPQN standard)
-            scaledCount = rawSampleCount * MIDI_PPQN;
-        }
-        else
-        {
-            // Single-pulse-per-quarter modes or ClockIn with PPQN=1
-            scaledCount = rawSampleCount;
-        }
+    if (!tracker.Process(static_cast<float>(rawSampleCount)))
+        return;
 
-        // Add to moving average buffer
-        foravg[foravgindex] = scaledCount;
-        foravgindex = (foravgindex + 1) % foravgsize;
-        if (full < foravgsize)
-            full++;
+    // Convert the filtered pulse period to quarter note timing (spqn)
+    float scale = 1.f;
+    if (Mode == KaliClockMode::ClockIn && external_ppqn > 1)
+    {
+        // External clock: external_ppqn pulses make up one quarter note
+        scale = static_cast<float>(external_ppqn);
+    }
+    else if (Mode == KaliClockMode::MidiClock)
+    {
+        scale = static_cast<float>(MIDI_PPQN);
+    }
 
-        // Calculate simple average
-        float sum = 0;
-        int count = full;
-        for (int i = 0; i < count; i++)
-        {
-            sum += foravg[i];
-        }
-        float avgSamples = sum / count; // TEMPORARY: Disable smoothing to see raw timing data
-        // Use direct average value with minimal bounds checking
-        int new_spqn = static_cast<int>(avgSamples);
-
-        // Only prevent obviously broken values (system limits)
-        // Min: 10 samples (insanely fast, ~4800 BPM at 48kHz)
-        // Max: 10 million samples (insanely slow, ~0.3 BPM at 48kHz)
-        if (new_spqn >= 10 && new_spqn <= 10000000)
-        {
-            spqn = new_spqn;
-        }
+    int new_spqn = static_cast<int>(tracker.GetPeriod() * scale + 0.5f);
 
-        // Store for timeout recovery
-        if (spqn > 0)
-        {
-            last_valid_spqn = spqn;
-        }
+    // Only prevent obviously broken values (system limits)
+    // Min: 10 samples (insanely fast, ~4800 BPM at 48kHz)
+    // Max: 10 million samples (insanely slow, ~0.3 BPM at 48kHz)
+    if (new_spqn >= 10 && new_spqn <= 10000000)
+    {
+        spqn = new_spqn;
     }
 
-    // Reset timing accumulator for next measurement
-    TimingAccumulator = 0;
+    // Store for timeout recovery
+    if (spqn > 0)
+    {
+        last_valid_spqn = spqn;
+    }
 }
 
 bool KaliClock::ProcessInternalClock(float maxsamples)
@@ -8,6 +8,7 @@
 #include "daisy.h"
 #include "dpt/daisy_dpt.h"
 #include "daisysp.h"
+#include "KaliTempoTracker.h"
 
 using namespace daisy;
 using namespace daisysp;
@@ -40,11 +41,8 @@ public:
 
     KaliClockMode Mode;
 
-    // Moving average for tempo tracking - reduced for responsiveness
-    static const uint8_t foravgsize = 3; // number for average
-    float foravg[3];
-    uint8_t foravgindex = 0;
-    uint8_t full = 0;
+    // Incoming pulse interval filter (shared by CV and MIDI clock)
+    KaliTempoTracker tracker;
 
     float one_ms = 48.f; // Default to 48 samples per ms - will be set correctly in Init
 
@@ -61,6 +59,11 @@ public:
     // Initialization tracking
     bool initialized = false;
 
+    // Beat position within the current audio block, for sample-accurate sync
+    int block_pos = 0;       // Samples ticked since BeginBlock()
+    int beat_offset = -1;    // Offset of the last beat in this block, -1 if none
+    uint32_t beat_count = 0; // Beats since Init
+
     /**
      * Initialize the clock with basic parameters
      * @param samplerate_ System sample rate
@@ -78,6 +81,21 @@ public:
      */
     bool Tick(bool TriggerReceived);
 
+    /**
+     * Start a new audio block; call once before the first Tick() of each block
+     */
+    void BeginBlock()
+    {
+        block_pos = 0;
+        beat_offset = -1;
+    }
+
+    /**
+     * Sample offset of the beat that fell in the current block
+     * @return Offset from the start of the block, or -1 if there was no beat
+     */
+    int GetBeatOffset() const { return beat_offset; }
+
     /**
      * Process trigger from external source
      */
@@ -0,0 +1,109 @@
+#pragma once
+#ifndef KALI_CLOCK_OUTPUT_H
+#define KALI_CLOCK_OUTPUT_H
+
+#include <cstddef>
+
+/** A gate transition at a fractional sample position inside the block. */
+struct KaliGateEdge
+{
+    float pos;
+    bool high;
+};
+
+/**
+ * @brief Pulse train for one clock output, worked out once per block
+ *
+ * Instead of stepping a counter every sample, the output keeps the time to
+ * its next pulse and to the end of the current pulse and lists the edges
+ * that fall inside the block. A beat from the master clock restarts the
+ * train on that sample so the output stays phase locked. Positions are
+ * fractional, so a division that is not a whole number of samples does not
+ * accumulate rounding.
+ */
+class KaliClockOutput
+{
+public:
+    static const int MAX_EDGES = 8;
+
+    void Reset()
+    {
+        to_pulse_ = 0.f;
+        to_fall_ = 0.f;
+        high_ = false;
+        running_ = false;
+    }
+
+    /**
+     * @param size block size
+     * @param sync_offset sample of the master clock beat in this block, -1 if none
+     * @param period samples between pulses
+     * @param pulse_len pulse length in samples, shortened to half the period if needed
+     * @param edges receives up to MAX_EDGES edges in time order
+     * @return number of edges written
+     */
+    int Process(size_t size, int sync_offset, float period, float pulse_len, KaliGateEdge *edges)
+    {
+        if (pulse_len > period * 0.5f)
+            pulse_len = period * 0.5f;
+
+        const float end = static_cast<float>(size);
+        float sync = sync_offset >= 0 ? static_cast<float>(sync_offset) : end;
+        if (!running_ && sync_offset < 0)
+            return 0; // free run only starts from a beat
+
+        int count = 0;
+        for (;;)
+        {
+            const float pulse = running_ ? to_pulse_ : end;
+            const float fall = high_ ? to_fall_ : end;
+
+            float t = fall < pulse ? fall : pulse;
+            if (sync < t)
+                t = sync;
+            if (t >= end)
+                break;
+
+            if (t == fall && fall < pulse && fall < sync)
+            {
+                high_ = false;
+                Emit(edges, count, t, false);
+                continue;
+            }
+
+            // Pulse from the free running train or a beat resync; a beat wins a tie
+            if (t == sync)
+                sync = end;
+            if (!high_)
+                Emit(edges, count, t, true);
+            high_ = true;
+            running_ = true;
+            to_pulse_ = t + period;
+            to_fall_ = t + pulse_len;
+        }
+
+        to_pulse_ -= end;
+        to_fall_ -= end;
+        return count;
+    }
+
+    bool IsHigh() const { return high_; }
+
+private:
+    static void Emit(KaliGateEdge *edges, int &count, float pos, bool high)
+    {
+        if (count < MAX_EDGES)
+        {
+            edges[count].pos = pos;
+            edges[count].high = high;
+            count++;
+        }
+    }
+
+    float to_pulse_ = 0.f; // relative to the start of the next block
+    float to_fall_ = 0.f;
+    bool high_ = false;
+    bool running_ = false;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#pragma once
+#ifndef KALI_CONTROL_FILTER_H
+#define KALI_CONTROL_FILTER_H
+
+#include <cmath>
+
+/**
+ * @brief 1-euro filter for one knob or CV, run once per audio block
+ *
+ * A one pole lowpass whose cutoff follows how fast the input is moving:
+ * at rest it sits at min_cutoff and irons out ADC noise, on a fast turn or
+ * a CV jump it opens up by beta per unit/second of (smoothed) speed, so
+ * there is little lag when it matters. The speed comes from the raw input,
+ * not the filtered output, so it does not lag behind the input either.
+ * See Casiez, Roussel and Vogel, "1 Euro Filter", CHI 2012.
+ */
+class KaliControlFilter
+{
+public:
+    struct Config
+    {
+        float min_cutoff; // Hz, at rest
+        float beta;       // Hz added per unit/second of speed
+        float d_cutoff;   // Hz, smoothing of the speed estimate
+    };
+
+    /** @param rate how often Process() is called, e.g. samplerate / blocksize */
+    void Init(float rate, const Config &config)
+    {
+        rate_ = rate;
+        config_ = config;
+        d_alpha_ = Alpha(config.d_cutoff);
+        primed_ = false;
+    }
+
+    float Process(float x)
+    {
+        if (!primed_)
+        {
+            y_ = x;
+            x_prev_ = x;
+            dx_ = 0.f;
+            primed_ = true;
+            return y_;
+        }
+        dx_ += d_alpha_ * ((x - x_prev_) * rate_ - dx_);
+        x_prev_ = x;
+        const float cutoff = config_.min_cutoff + config_.beta * fabsf(dx_);
+        y_ += Alpha(cutoff) * (x - y_);
+        return y_;
+    }
+
+    float Value() const { return y_; }
+    /** Smoothed speed in units per second. */
+    float Speed() const { return dx_; }
+
+private:
+    float Alpha(float cutoff) const
+    {
+        const float tau = 1.f / (2.f * 3.14159265f * cutoff);
+        return 1.f / (1.f + tau * rate_);
+    }
+
+    float rate_ = 500.f;
+    Config config_ = {1.f, 0.f, 1.f};
+    float d_alpha_ = 0.f;
+    float y_ = 0.f;
+    float x_prev_ = 0.f;
+    float dx_ = 0.f;
+    bool primed_ = false;
+};
+
+// KaliInput's settings. The 8 CV inputs follow a step within a block; the
+// two front panel pots sit stiller at rest and lag more on a slow turn.
+// tests/test_control_filter.cpp measures both on ADC traces.
+const KaliControlFilter::Config KALI_CV_FILTER = {4.f, 120.f, 2.f};
+const KaliControlFilter::Config KALI_KNOB_FILTER = {1.f, 30.f, 1.f};
+
+#endif
@@ -29,8 +29,15 @@ public:
         {
             line_[i] = T(0);
         }
+        ResetPointers();
+    }
+
+    /** Rewind without touching the buffer, for when it is cleared elsewhere (see KaliMemClear). */
+    void ResetPointers()
+    {
         write_ptr_ = 0;
         delay_ = 1;
+        frac_ = 0.0f;
     }
 
     inline void SetDelay(size_t delay)
@@ -129,6 +136,9 @@ public:
 
     inline size_t GetWritePtr() { return write_ptr_; }
 
+    // Raw storage, for filling the line from outside the audio path
+    inline T *GetLine() { return line_; }
+
 private:
     float frac_;
     size_t write_ptr_;
@@ -1,5 +1,4 @@
 #include "KaliDsp.h"
-#include <cstdlib> // For rand() and RAND_MAX
 #include <cmath>   // For cosf and M_PI
 #include <cstring> // For strncpy
 #include <algorithm>
@@ -53,7 +52,7 @@ static int crystal_steps_done[4] = {0, 0, 0, 0};
 static float crystal_pitch_state[4] = {0.0f, 0.0f, 0.0f, 0.0f};
 void KaliDSP::Init(float samplerate_)
 {
-    srand(0); // Seed the random number generator with a fixed value
+    Seed(1);
     samplerate = samplerate_;
     sample_interval = 1.0f / DSY_MAX(1.0f, samplerate);
 
@@ -72,7 +71,6 @@ void KaliDSP::Init(float samplerate_)
         chorus[i].SetAmp(1.0f);
         chorus[i].SetFreq(2.0f);
         chorus[i].meta = 1;
-        chorus[i].last32possteppedmax = 384;
     }
 
     // Initialize drama oscillator
@@ -124,12 +122,18 @@ void KaliDSP::Init(float samplerate_)
     // Initialize fluid state
     for (int j = 0; j < 4; ++j)
     {
-        float r1 = (float)rand() / (float)RAND_MAX;
-        float r2 = (float)rand() / (float)RAND_MAX;
+        float r1 = Random01();
+        float r2 = Random01();
         fluid_pos[j][0] = 0.1f + 0.8f * r1;
         fluid_pos[j][1] = 0.1f + 0.8f * r2;
         fluid_vel[j][0] = 0.0f;
         fluid_vel[j][1] = 0.0f;
+        fluid_noise[j][0] = 0.0f;
+        fluid_noise[j][1] = 0.0f;
+        pitch_accumulators[j] = 0.0f;
+        octave_accumulators[j] = 0.0f;
+        texture_accumulators[j] = 0.0f;
+        shimmer_accumulators[j] = 0.0f;
     }
     fluid_theta1 = 0.0f;
     fluid_theta2 = 1.5707963f;
@@ -830,7 +834,6 @@ void KaliDSP::ProcessFluid(KaliInputState &s)
     float c2y = 0.5f + 0.33f * sinf(fluid_theta2 + 0.7f);
 
     // Smoothed noise for turbulence (per channel)
-    static float nx[4] = {0}, ny[4] = {0};
     float noise_tc_ms = daisysp::fmap(p4_turb, 10.0f, 200.0f); // 10..200 ms
     float noise_a = mstocoeff(noise_tc_ms);
 
@@ -863,12 +866,12 @@ void KaliDSP::ProcessFluid(KaliInputState &s)
         float vy = vort * (v1y * (1.0f - w2) + v2y * w2);
 
         // Add small turbulence (smoothed random to avoid zippering)
-        float tgtx = 2.0f * ((float)rand() / (float)RAND_MAX) - 1.0f;
-        float tgty = 2.0f * ((float)rand() / (float)RAND_MAX) - 1.0f;
-        fonepole(nx[j], tgtx, noise_a);
-        fonepole(ny[j], tgty, noise_a);
-        vx += turb_amt * nx[j];
-        vy += turb_amt * ny[j];
+        float tgtx = 2.0f * Random01() - 1.0f;
+        float tgty = 2.0f * Random01() - 1.0f;
+        fonepole(fluid_noise[j][0], tgtx, noise_a);
+        fonepole(fluid_noise[j][1], tgty, noise_a);
+        vx += turb_amt * fluid_noise[j][0];
+        vy += turb_amt * fluid_noise[j][1];
 
         // Semi-implicit Euler with viscosity damping
         fluid_vel[j][0] = (1.0f - visc) * (fluid_vel[j][0] + step * vx);
@@ -915,7 +918,7 @@ void KaliDSP::TriggerGrain(int channel, float base_delay_samples, float position
     g.active = true;
     // Compute spread window relative to base delay (allow up to 50% of base when position_spread=1)
     float max_spread = base_delay_samples * (0.05f + position_spread * 0.45f);
-    float r = (static_cast<float>(rand()) / RAND_MAX) * 2.f - 1.f; // -1..1
+    float r = Random01() * 2.f - 1.f; // -1..1
     float offset = r * max_spread;
     float target = base_delay_samples + offset;
     float upper_limit = DSY_CLAMP(base_delay_samples * 2.0f, 2000.f, (float)MAX_DELAY - 8.f);
@@ -928,7 +931,7 @@ void KaliDSP::TriggerGrain(int channel, float base_delay_samples, float position
 
     // Slight playback rate jitter for texture
     float rate_jitter = 0.02f * position_spread; // up to ±2%
-    float rate_r = (static_cast<float>(rand()) / RAND_MAX) * 2.f - 1.f;
+    float rate_r = Random01() * 2.f - 1.f;
     g.increment = 1.0f + rate_r * rate_jitter;
     g.amp = 1.0f;
     g.crossfade_pos = 0.0f;
@@ -985,7 +988,62 @@ float KaliDSP::modulo(float x, float A, float B)
 
 float KaliDSP::diode(float in, float factor)
 {
-    return in / (factor + abs(in));
+    // factor reaches 0 at full amount, where silence would be 0 / 0
+    const float d = factor + fabsf(in);
+    return d > 0.f ? in / d : 0.f;
+}
+
+float KaliDSP::Distort(float x, int algo, int amount)
+{
+    const float A = 1.f + (amount * TWOPI_F * 0.01f);
+    const float B = amount * 0.01f;
+    float gain, threshold;
+
+    switch (algo)
+    {
+    case 0: // Sine Distortion
+        return sinf(x * A * 1.5f);
+
+    case 1: // Foldback Distortion
+        gain = fmap(B, 1.f, 10.f, daisysp::Mapping::LINEAR);
+        threshold = fmap(B, 8.0f, 1.0f);
+        return foldback(x * gain, threshold);
+
+    case 2: // Tanh Distortion
+        return tanhf(x * A * 2.0f);
+
+    case 3: // Quantizer
+        gain = fmap(B, 1.f, 3.f, daisysp::Mapping::LINEAR);
+        return quantizer(x * gain, A * 2.0f, B * 2.0f);
+
+    case 4: // Diode Clipper
+        gain = fmap(B, 1.f, 2.f, daisysp::Mapping::LINEAR);
+        threshold = 1.f - fmap(B, 0.25f, 1.0f);
+        return diode(x * gain, DSY_CLAMP(threshold, 0.f, 1.f));
+
+    case 5: // Hard Clip
+        gain = fmap(B, 1.f, 10.0f, daisysp::Mapping::LINEAR);
+        x *= gain;
+        return (x < -1.0) ? -1.0f : (x > 1.0 ? 1.0 : x);
+
+    case 6: // Soft Clip
+        gain = fmap(B, 1.f, 10.f, daisysp::Mapping::LINEAR);
+        x *= gain;
+        return x / (1.f + fabsf(x));
+
+    case 7: // Asymmetric Clipping
+        gain = fmap(B, 1.f, 5.f, daisysp::Mapping::LINEAR);
+        x *= gain;
+        return (x > 0.f) ? tanhf(x * A) : x * B;
+
+    case 8: // Modulo Distortion (the gain goes in twice)
+        gain = fmap(B, 1.f, 5.f, daisysp::Mapping::LINEAR);
+        x *= gain;
+        return modulo(x * gain, A, B);
+
+    default:
+        return x;
+    }
 }
 
 void KaliDSP::Allpass(float &wetl, float &wetr, float c)
@@ -1100,16 +1158,15 @@ void KaliDSP::ProcessPhasorPitch(KaliInputState &s)
         if (fabsf(playback_rate - 1.0f) > 0.01f)
         {
             // Accumulate rate offset over time for pitch shifting
-            static float rate_accumulators[4] = {0.0f, 0.0f, 0.0f, 0.0f};
-            rate_accumulators[j] += (playback_rate - 1.0f) * 0.1f;
+            pitch_accumulators[j] += (playback_rate - 1.0f) * 0.1f;
 
             // Wrap accumulator to prevent overflow
-            if (rate_accumulators[j] > s.delaytimes[j] * 0.5f)
-                rate_accumulators[j] -= s.delaytimes[j];
-            if (rate_accumulators[j] < -s.delaytimes[j] * 0.5f)
-                rate_accumulators[j] += s.delaytimes[j];
+            if (pitch_accumulators[j] > s.delaytimes[j] * 0.5f)
+                pitch_accumulators[j] -= s.delaytimes[j];
+            if (pitch_accumulators[j] < -s.delaytimes[j] * 0.5f)
+                pitch_accumulators[j] += s.delaytimes[j];
 
-            read_pos += rate_accumulators[j];
+            read_pos += pitch_accumulators[j];
         }
 
         // Apply time division/quantization if enabled
@@ -1206,20 +1263,19 @@ void KaliDSP::ProcessPhasorPitchOctave(KaliInputState &s)
 
         if (fabsf(playback_rate - 1.0f) > 0.0001f)
         {
-            static float rate_accumulators[4] = {0.0f, 0.0f, 0.0f, 0.0f};
             // Accumulate a position offset proportional to playback rate difference
             // Scale by base delay so an octave shift is clearly audible across ranges
             // Limit scaling on large delay ranges to avoid runaway offsets
             float base_scale = s.delaytimes[j] * 0.002f;       // 0.2% of base
             base_scale = DSY_CLAMP(base_scale, 12.0f, 512.0f); // 0.25..10.7 ms at 48k
-            rate_accumulators[j] += (playback_rate - 1.0f) * base_scale;
+            octave_accumulators[j] += (playback_rate - 1.0f) * base_scale;
 
-            if (rate_accumulators[j] > s.delaytimes[j])
-                rate_accumulators[j] -= s.delaytimes[j];
-            if (rate_accumulators[j] < -s.delaytimes[j])
-                rate_accumulators[j] += s.delaytimes[j];
+            if (octave_accumulators[j] > s.delaytimes[j])
+                octave_accumulators[j] -= s.delaytimes[j];
+            if (octave_accumulators[j] < -s.delaytimes[j])
+                octave_accumulators[j] += s.delaytimes[j];
 
-            read_pos += rate_accumulators[j];
+            read_pos += octave_accumulators[j];
         }
 
         if (time_division > 1.01f)
@@ -1313,7 +1369,6 @@ void KaliDSP::ProcessGranularTexture(KaliInputState &s)
         // Apply subtle pitch changes
         if (fabsf(playback_rate - 1.0f) > 0.005f)
         {
-            static float texture_accumulators[4] = {0.0f, 0.0f, 0.0f, 0.0f};
             texture_accumulators[j] += (playback_rate - 1.0f) * 0.05f; // Slower rate changes
 
             if (texture_accumulators[j] > s.delaytimes[j] * 0.3f)
@@ -1404,7 +1459,6 @@ void KaliDSP::ProcessGranularShimmer(KaliInputState &s)
         read_pos = s.delaytimes[j] - s.dp[j]->GetDelayPosition();
 
         // Apply shimmer pitch changes
-        static float shimmer_accumulators[4] = {0.0f, 0.0f, 0.0f, 0.0f};
         shimmer_accumulators[j] += (playback_rate - 1.0f) * 0.08f; // Faster pitch changes
 
         if (shimmer_accumulators[j] > s.delaytimes[j] * 0.4f)
@@ -97,8 +97,6 @@ public:
     float chorusConst = (480.f / 96.f);
     KaliOscillator drama;
     KaliOscillator chorus[2];
-    float last32[4][64];
-    int last32pos;
     float phsL, phsR, panl, panr;
 
     // slicey meta 2
@@ -116,11 +114,27 @@ public:
     int loop_xfade_len = 24; // ~0.5 ms @ 48k
     float last_output_sample[4]{0.f, 0.f, 0.f, 0.f};
 
+    // Read position drift of the pitch and granular modes, cleared by Init()
+    float pitch_accumulators[4]{0.f, 0.f, 0.f, 0.f};
+    float octave_accumulators[4]{0.f, 0.f, 0.f, 0.f};
+    float texture_accumulators[4]{0.f, 0.f, 0.f, 0.f};
+    float shimmer_accumulators[4]{0.f, 0.f, 0.f, 0.f};
+
     // Lightweight fluid field state for Fluid mode
     float fluid_pos[4][2]{{0.25f, 0.25f}, {0.75f, 0.25f}, {0.25f, 0.75f}, {0.75f, 0.75f}};
     float fluid_vel[4][2]{{0.0f, 0.0f}, {0.0f, 0.0f}, {0.0f, 0.0f}, {0.0f, 0.0f}};
     float fluid_theta1 = 0.0f;
     float fluid_theta2 = 1.5707963f; // 90deg offset
+    float fluid_noise[4][2]{{0.f, 0.f}, {0.f, 0.f}, {0.f, 0.f}, {0.f, 0.f}}; // smoothed turbulence
+
+    /**
+     * @brief Restart the grain/fluid random sequence
+     *
+     * Init() seeds with 1, so two instances fed the same input and controls
+     * produce the same output, whatever else in the firmware draws random
+     * numbers in between.
+     */
+    void Seed(uint32_t seed) { rng_state = seed ? seed : 1; }
 
     // Minimal FDN reverb state (removed - ProcessWeirdVerb inactive)
     // static constexpr int FDN_TAPS = 8;
@@ -180,6 +194,8 @@ public:
     static float quantizer(float in, float A, float B);
     static float modulo(float x, float A, float B);
     static float diode(float in, float factor);
+    /** One sample through distortion algorithm 0..8 at amount 0..100, before the trim */
+    static float Distort(float x, int algo, int amount);
 
     static void kill_denormal_by_quantization(float &val);
 
@@ -195,6 +211,16 @@ public:
 
 private:
     unsigned int mode;
+    uint32_t rng_state = 1;
+
+    /** xorshift32, 0..1 */
+    float Random01()
+    {
+        rng_state ^= rng_state << 13;
+        rng_state ^= rng_state >> 17;
+        rng_state ^= rng_state << 5;
+        return static_cast<float>(rng_state >> 8) * (1.f / 16777215.f);
+    }
     void ProcessPhasorPitch(KaliInputState &s);
     void ProcessPhasorPitchOctave(KaliInputState &s);
     void ProcessGranularTexture(KaliInputState &s);
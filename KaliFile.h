@@ -0,0 +1,27 @@
+#pragma once
+#ifndef KALI_FILE_H
+#define KALI_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief A sequential file as the loaders and snapshot writer see it
+ *
+ * KaliSdFile is the FatFs implementation; a host build can back it with
+ * stdio. Read() and Write() return the number of bytes moved, short on
+ * end of file or error.
+ */
+class KaliFile
+{
+public:
+    virtual ~KaliFile() {}
+    virtual bool Open(const char *path, bool write) = 0;
+    virtual void Close() = 0;
+    virtual size_t Read(void *dst, size_t len) = 0;
+    virtual size_t Write(const void *src, size_t len) = 0;
+    virtual bool Seek(uint32_t pos) = 0;
+    virtual uint32_t Size() = 0;
+};
+
+#endif
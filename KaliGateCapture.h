@@ -0,0 +1,118 @@
+#pragma once
+#ifndef KALI_GATE_CAPTURE_H
+#define KALI_GATE_CAPTURE_H
+
+#include "daisy.h"
+#include "KaliSpscQueue.h"
+#include "KaliTimebase.h"
+#include <cstdint>
+
+extern "C"
+{
+#include "util/hal_map.h"
+}
+
+/**
+ * @brief Timestamped gate edge capture through the pin's EXTI line
+ *
+ * The interrupt only stamps the rising gate edge with System::GetTick() and
+ * queues it. Once per block the audio callback collects the edges that fell
+ * inside the block window and gets them back as sample offsets, the same way
+ * MIDI clock is delivered through KaliMIDIBus, so a CV clock is one block
+ * late but no longer quantized to the block boundary.
+ *
+ * The GPIO keeps working as a normal input, so GateIn::State() is unaffected.
+ */
+class KaliGateCapture
+{
+public:
+    /**
+     * @param pin gate input pin, already set up by GateIn
+     * @param inverted true when the input circuit inverts (the pin falls on a rising gate)
+     * @param holdoff_us edges closer than this to the previous one are ignored
+     */
+    void Init(const dsy_gpio_pin &pin, bool inverted = true, uint32_t holdoff_us = 500)
+    {
+        edges_.Clear();
+        holdoff_ticks_ = daisy::System::GetTickFreq() / 1000000 * holdoff_us;
+        last_edge_ = daisy::System::GetTick() - holdoff_ticks_;
+        edge_count = 0;
+        rejected = 0;
+
+        pin_mask_ = dsy_hal_map_get_pin(&pin);
+        line_ = static_cast<uint8_t>(pin.pin);
+
+        __HAL_RCC_SYSCFG_CLK_ENABLE();
+        dsy_hal_map_gpio_clk_enable(pin.port);
+
+        GPIO_InitTypeDef init;
+        init.Pin = pin_mask_;
+        init.Mode = inverted ? GPIO_MODE_IT_FALLING : GPIO_MODE_IT_RISING;
+        init.Pull = GPIO_NOPULL;
+        init.Speed = GPIO_SPEED_FREQ_LOW;
+        init.Alternate = 0;
+        HAL_GPIO_Init(dsy_hal_map_get_port(&pin), &init);
+
+        // Above the timer that polls MIDI so an edge is never stamped late by it
+        HAL_NVIC_SetPriority(Irq(), 0, 0);
+        HAL_NVIC_EnableIRQ(Irq());
+    }
+
+    /** Call from the matching EXTIx_IRQHandler. */
+    void OnInterrupt()
+    {
+        if (!__HAL_GPIO_EXTI_GET_IT(pin_mask_))
+            return;
+        __HAL_GPIO_EXTI_CLEAR_IT(pin_mask_);
+
+        const uint32_t now = daisy::System::GetTick();
+        if (now - last_edge_ < holdoff_ticks_)
+        {
+            rejected++;
+            return;
+        }
+        last_edge_ = now;
+        edge_count++;
+        edges_.Push(now);
+    }
+
+    /**
+     * @brief Audio side: edges that belong to this block, as sample offsets
+     * @param timebase already stamped with BeginBlock() for this block
+     * @param offsets receives up to max_edges ascending offsets
+     * @return number of offsets written
+     */
+    int Collect(const KaliTimebase &timebase, uint8_t *offsets, int max_edges)
+    {
+        int count = 0;
+        const uint32_t *tick;
+        while ((tick = edges_.Peek()) != nullptr)
+        {
+            if (timebase.IsFuture(*tick))
+                break;
+            if (count < max_edges)
+                offsets[count++] = static_cast<uint8_t>(timebase.ToSampleOffset(*tick));
+            edges_.Drop();
+        }
+        return count;
+    }
+
+    uint32_t edge_count = 0;
+    uint32_t rejected = 0; // edges swallowed by the holdoff (bounce, ringing)
+
+private:
+    IRQn_Type Irq() const
+    {
+        if (line_ <= 4)
+            return static_cast<IRQn_Type>(EXTI0_IRQn + line_);
+        return line_ <= 9 ? EXTI9_5_IRQn : EXTI15_10_IRQn;
+    }
+
+    KaliSpscQueue<uint32_t, 16> edges_;
+    uint32_t holdoff_ticks_ = 0;
+    uint32_t last_edge_ = 0;
+    uint16_t pin_mask_ = 0;
+    uint8_t line_ = 0;
+};
+
+#endif
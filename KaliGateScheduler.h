@@ -0,0 +1,158 @@
+#pragma once
+#ifndef KALI_GATE_SCHEDULER_H
+#define KALI_GATE_SCHEDULER_H
+
+#include "daisy.h"
+#include "KaliClockOutput.h"
+#include <cstdint>
+#include <cstring>
+
+extern "C"
+{
+#include "util/hal_map.h"
+}
+
+/**
+ * @brief Plays gate edges out of a DMA ring into the GPIO BSRR register
+ *
+ * The gate outputs are plain GPIOs with no timer channel, so TIM3 paces a
+ * circular DMA transfer at OVERSAMPLE times the audio rate that copies one
+ * word per slot into the port's BSRR. Empty slots are zero and leave the
+ * pins alone, so the CPU only writes the slots where an edge falls, once
+ * per block, a fixed lead ahead of the DMA read position. That lead is
+ * about one block, which lines the gates up with the audio output.
+ *
+ * TIM3 does not run off the codec clock, so the write cursor is nudged by
+ * a slot at a time whenever it drifts away from the DMA position.
+ */
+class KaliGateScheduler
+{
+public:
+    static const int OVERSAMPLE = 4;
+    static const uint32_t RING = 1024;
+
+    /**
+     * @param ring RING words the DMA can reach (not DTCM), e.g. DMA_BUFFER_MEM_SECTION
+     * @param pins gate output pins, must all be on the same GPIO port
+     * @return false if the pins can't share one BSRR; nothing is started
+     */
+    bool Init(uint32_t *ring, const dsy_gpio_pin *pins, int num_pins, float samplerate, size_t block_size)
+    {
+        running_ = false;
+        if (num_pins < 1 || num_pins > MAX_PINS)
+            return false;
+        for (int i = 0; i < num_pins; i++)
+        {
+            if (pins[i].port != pins[0].port)
+                return false;
+            masks_[i] = dsy_hal_map_get_pin(&pins[i]);
+        }
+        num_pins_ = num_pins;
+        port_ = dsy_hal_map_get_port(&pins[0]);
+        block_slots_ = static_cast<uint32_t>(block_size) * OVERSAMPLE;
+        lead_ = block_slots_ + block_slots_ / 2;
+        ring_ = ring;
+        memset(ring_, 0, RING * sizeof(uint32_t));
+
+        __HAL_RCC_DMA2_CLK_ENABLE();
+        __HAL_RCC_TIM3_CLK_ENABLE();
+
+        hdma_.Instance = DMA2_Stream5;
+        hdma_.Init.Request = DMA_REQUEST_TIM3_UP;
+        hdma_.Init.Direction = DMA_MEMORY_TO_PERIPH;
+        hdma_.Init.PeriphInc = DMA_PINC_DISABLE;
+        hdma_.Init.MemInc = DMA_MINC_ENABLE;
+        hdma_.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+        hdma_.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+        hdma_.Init.Mode = DMA_CIRCULAR;
+        hdma_.Init.Priority = DMA_PRIORITY_LOW;
+        hdma_.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+        if (HAL_DMA_Init(&hdma_) != HAL_OK)
+            return false;
+        if (HAL_DMA_Start(&hdma_, reinterpret_cast<uint32_t>(ring_),
+                          reinterpret_cast<uint32_t>(&port_->BSRR), RING) != HAL_OK)
+            return false;
+
+        // APB1 timers run at twice PCLK1
+        const uint32_t timer_clock = daisy::System::GetPClk1Freq() * 2;
+        const uint32_t rate = static_cast<uint32_t>(samplerate) * OVERSAMPLE;
+        TIM3->CR1 = 0;
+        TIM3->PSC = 0;
+        TIM3->ARR = (timer_clock + rate / 2) / rate - 1;
+        TIM3->CNT = 0;
+        TIM3->EGR = TIM_EGR_UG;
+        TIM3->DIER = TIM_DIER_UDE;
+        TIM3->CR1 = TIM_CR1_CEN;
+
+        clear_pos_ = ReadPos();
+        cursor_ = (clear_pos_ + lead_) & (RING - 1);
+        running_ = true;
+        return true;
+    }
+
+    bool Running() const { return running_; }
+
+    /** Call once per block, before Schedule(). */
+    void BeginBlock()
+    {
+        const uint32_t pos = ReadPos();
+
+        // Zero whatever the DMA played since last time so the ring can be reused
+        while (clear_pos_ != pos)
+        {
+            ring_[clear_pos_] = 0;
+            clear_pos_ = (clear_pos_ + 1) & (RING - 1);
+        }
+
+        cursor_ = (cursor_ + block_slots_) & (RING - 1);
+        int32_t error = static_cast<int32_t>((pos + lead_ - cursor_) & (RING - 1));
+        if (error >= static_cast<int32_t>(RING / 2))
+            error -= RING;
+
+        if (error > static_cast<int32_t>(block_slots_) || -error > static_cast<int32_t>(block_slots_))
+        {
+            cursor_ = (pos + lead_) & (RING - 1); // stalled or first block: start over
+            resyncs++;
+        }
+        else if (error > OVERSAMPLE)
+            cursor_ = (cursor_ + 1) & (RING - 1);
+        else if (error < -OVERSAMPLE)
+            cursor_ = (cursor_ - 1) & (RING - 1);
+    }
+
+    /** Queue the edges of one output for the block started by BeginBlock(). */
+    void Schedule(int pin, const KaliGateEdge *edges, int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            uint32_t slot = static_cast<uint32_t>(edges[i].pos * OVERSAMPLE + 0.5f);
+            if (slot >= block_slots_)
+                slot = block_slots_ - 1;
+            const uint32_t bit = edges[i].high ? masks_[pin] : static_cast<uint32_t>(masks_[pin]) << 16;
+            ring_[(cursor_ + slot) & (RING - 1)] |= bit;
+        }
+    }
+
+    uint32_t resyncs = 0;
+
+private:
+    static const int MAX_PINS = 4;
+
+    uint32_t ReadPos() const
+    {
+        return (RING - __HAL_DMA_GET_COUNTER(&hdma_)) & (RING - 1);
+    }
+
+    uint32_t *ring_ = nullptr;
+    DMA_HandleTypeDef hdma_;
+    GPIO_TypeDef *port_ = nullptr;
+    uint16_t masks_[MAX_PINS] = {0};
+    int num_pins_ = 0;
+    uint32_t block_slots_ = 0;
+    uint32_t lead_ = 0;
+    uint32_t cursor_ = 0;
+    uint32_t clear_pos_ = 0;
+    bool running_ = false;
+};
+
+#endif
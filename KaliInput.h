@@ -9,6 +9,7 @@
 #include "daisysp.h"
 #include "KaliOptions.h"
 #include "KaliWavetable.h"
+#include "KaliControlFilter.h"
 
 using namespace daisy;
 using namespace daisysp;
@@ -192,5 +193,10 @@ public:
 
     KaliKnob Knobs[10];
 
+    // One per knob, ahead of the hysteresis (see InitFilters for the settings)
+    KaliControlFilter Filters[10];
+
+    /** @param rate control rate, the audio callback rate */
+    void InitFilters(float rate);
     void ProcessControls(DPT *patch);
 };
\ No newline at end of file
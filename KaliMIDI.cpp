@@ -15,7 +15,15 @@ KaliMIDI::KaliMIDI()
     // Initialize CC lookup to -1 (no mapping)
     for(int ch = 0; ch < 16; ++ch)
         for(int cc = 0; cc < 128; ++cc)
+        {
             cc_lookup[ch][cc] = -1;
+            pending_[ch][cc] = false;
+            pending_value_[ch][cc] = 0;
+        }
+    num_pending_ = 0;
+    num_held_ = 0;
+    for (int i = 0; i < 128; i++)
+        note_period_[i] = 0.f;
     
     // Initialize CC mappings
     num_mappings = 0;
@@ -66,30 +74,96 @@ bool KaliMIDI::receiveControlChange(ControlChangeEvent e, Kali* kali)
     return updated;
 }
 
+void KaliMIDI::queueControlChange(int channel, int cc, int value, Kali* kali)
+{
+    if(channel < 0 || channel >= 16 || cc < 0 || cc >= 128)
+        return;
+    pending_value_[channel][cc] = (uint8_t)value;
+    if(pending_[channel][cc])
+        return;
+
+    if(num_pending_ >= MAX_PENDING_CC)
+    {
+        // List full: no coalescing for this one, apply it straight away
+        ControlChangeEvent e;
+        e.channel = channel;
+        e.control_number = (uint8_t)cc;
+        e.value = (uint8_t)value;
+        receiveControlChange(e, kali);
+        return;
+    }
+    pending_[channel][cc] = true;
+    pending_list_[num_pending_++] = (uint16_t)((channel << 7) | cc);
+}
+
+void KaliMIDI::applyPendingControlChanges(Kali* kali)
+{
+    for(int i = 0; i < num_pending_; i++)
+    {
+        const int channel = pending_list_[i] >> 7;
+        const int cc = pending_list_[i] & 0x7F;
+        pending_[channel][cc] = false;
+
+        ControlChangeEvent e;
+        e.channel = channel;
+        e.control_number = (uint8_t)cc;
+        e.value = pending_value_[channel][cc];
+        receiveControlChange(e, kali);
+    }
+    num_pending_ = 0;
+}
+
 void KaliMIDI::receiveNoteOn(NoteOnEvent e)
 {
-    if(e.note >= 0 && e.note < 128)
-        NoteOnBuffer[e.note] = e;
+    if(e.note < 0 || e.note > 127)
+        return;
+    NoteOnBuffer[e.note] = e;
+    releaseHeld(e.note);
+    if(e.velocity == 0) // running status note off
+        return;
     LastNote = e;
+
+    if(num_held_ == MAX_HELD)
+        releaseHeld(held_[0]); // forget the oldest
+    held_[num_held_++] = static_cast<uint8_t>(e.note);
 }
 
 void KaliMIDI::receiveNoteOff(NoteOffEvent e)
 {
     if(e.note >= 0 && e.note < 128)
+    {
         NoteOnBuffer[e.note].velocity = 0;
+        releaseHeld(e.note);
+    }
 }
 
-std::vector<NoteOnEvent> KaliMIDI::getActiveNotes() const
+void KaliMIDI::releaseHeld(int note)
 {
-    std::vector<NoteOnEvent> activeNotes;
+    int n = 0;
+    for(int i = 0; i < num_held_; i++)
+        if(held_[i] != note)
+            held_[n++] = held_[i];
+    num_held_ = n;
+}
+
+void KaliMIDI::initNotePeriods(float samplerate)
+{
+    // One powf per note here so the audio callback never needs mtof
+    for(int i = 0; i < 128; i++)
+        note_period_[i] = samplerate / (440.f * powf(2.f, (i - 69) / 12.f));
+}
+
+int KaliMIDI::getActiveNotes(NoteOnEvent* out, int max) const
+{
+    int count = 0;
     for (const auto &note : NoteOnBuffer)
     {
-        if (note.velocity > 0)
+        if (note.velocity > 0 && count < max)
         {
-            activeNotes.push_back(note);
+            out[count++] = note;
         }
     }
-    return activeNotes;
+    return count;
 }
 
 void KaliMIDI::clearNoteBuffer()
@@ -98,6 +172,7 @@ void KaliMIDI::clearNoteBuffer()
     {
         note.velocity = 0;
     }
+    num_held_ = 0;
 }
 
 void KaliMIDI::resetCCOverrides()
@@ -186,15 +261,17 @@ void KaliMIDI::initializeCCMappings(Kali* kali)
     addCCMapping(7, 15, BankType::Global, 14); // InputWidth
     addCCMapping(7, 16, BankType::Global, 15); // InvertEncoders
     addCCMapping(7, 17, BankType::Global, 16); // EnableDebugInfo
+    addCCMapping(7, 18, BankType::Global, OptionsPages::MorphPosition);
 }
 
 void KaliMIDI::addCCMapping(int channel, int cc, int bank_type, int option_index, int lfo_index, CCCallback callback)
 {
     if (num_mappings < MAX_CC_MAPPINGS)
     {
-        cc_mappings[num_mappings] = {channel, cc, bank_type, option_index, lfo_index, callback};
+        cc_mappings[num_mappings] = {(uint8_t)channel, (uint8_t)cc, (uint8_t)bank_type,
+                                     (uint8_t)option_index, (int8_t)lfo_index, callback};
         if(channel >= 0 && channel < 16 && cc >= 0 && cc < 128)
-            cc_lookup[channel][cc] = num_mappings;
+            cc_lookup[channel][cc] = (int16_t)num_mappings;
         num_mappings++;
     }
 }
@@ -206,23 +283,19 @@ void KaliMIDI::processMappedCC(Kali* kali, int channel, int cc, int value)
     int idx = cc_lookup[channel][cc];
     if(idx < 0 || idx >= num_mappings)
         return;
-    CCMapping& mapping = cc_mappings[idx];
-    if (mapping.callback)
-    {
-        mapping.callback(kali, channel, cc, value);
-    }
-    else
-    {
-        defaultCCHandler(kali, channel, cc, value, mapping.bank_type, mapping.option_index, mapping.lfo_index);
-    }
+    const CCMapping& mapping = cc_mappings[idx];
+    CCCallback handler = mapping.callback ? mapping.callback : &KaliMIDI::defaultCCHandler;
+    handler(kali, mapping, value);
 }
 
-void KaliMIDI::defaultCCHandler(Kali* kali, int channel, int cc, int value, int bank_type, int option_index, int lfo_index)
+void KaliMIDI::defaultCCHandler(Kali* kali, const CCMapping& mapping, int value)
 {
     // Convert MIDI value (0-127) to option range
     float normalized_value = value / 127.0f;
+    const int option_index = mapping.option_index;
+    const int lfo_index = mapping.lfo_index;
     
-    switch (bank_type)
+    switch (mapping.bank_type)
     {
     case BankType::Global:
         {
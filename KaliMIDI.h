@@ -4,25 +4,24 @@
 
 #include <daisy.h>
 #include <array>
-#include <vector>
-#include <functional>
 
 using namespace daisy;
 
 // Forward declarations
 class Kali;
+struct CCMapping;
 
-// MIDI CC callback function type
-using CCCallback = std::function<void(Kali*, int channel, int cc, int value)>;
+// MIDI CC handler, plain function pointer so the table needs no heap
+typedef void (*CCCallback)(Kali* kali, const CCMapping& mapping, int value);
 
 // MIDI CC mapping structure
 struct CCMapping {
-    int channel;
-    int cc;
-    int bank_type;     // BankType::Global, DSP, or LFO
-    int option_index;  // Index into the options array
-    int lfo_index;     // For LFO bank, which LFO (0-5), -1 for others
-    CCCallback callback; // Optional custom callback, nullptr for default
+    uint8_t channel;
+    uint8_t cc;
+    uint8_t bank_type;    // BankType::Global, DSP, or LFO
+    uint8_t option_index; // Index into the options array
+    int8_t lfo_index;     // For LFO bank, which LFO (0-5), -1 for others
+    CCCallback callback;  // Optional custom handler, nullptr for default
 };
 
 class KaliMIDI
@@ -45,7 +44,10 @@ public:
     CCMapping cc_mappings[MAX_CC_MAPPINGS];
     int num_mappings;
     // Fast lookup: [channel 0-15][cc 0-127] -> mapping index or -1
-    int cc_lookup[16][128];
+    int16_t cc_lookup[16][128];
+
+    // CCs received since the last applyPendingControlChanges(), latest value wins
+    static const int MAX_PENDING_CC = 128;
 
     void initialize();
     void sendNoteOn(int channel, int note, int velocity);
@@ -57,8 +59,20 @@ public:
     bool receiveControlChange(ControlChangeEvent e);
     // Overload with kali instance; processes mapped CCs only when updated
     bool receiveControlChange(ControlChangeEvent e, Kali* kali);
+    // Coalescing path: remember the value now, apply it with applyPendingControlChanges()
+    void queueControlChange(int channel, int cc, int value, Kali* kali);
+    // Cost is proportional to the number of distinct CCs queued, not the CC space
+    void applyPendingControlChanges(Kali* kali);
+
+    // Copies up to max held notes into out, returns how many were written
+    int getActiveNotes(NoteOnEvent* out, int max) const;
+    // Most recently pressed note that is still held, -1 if none (last note priority)
+    int heldNote() const { return num_held_ > 0 ? held_[num_held_ - 1] : -1; }
 
-    std::vector<NoteOnEvent> getActiveNotes() const;
+    // Fills the note period table, call once before notePeriod()
+    void initNotePeriods(float samplerate);
+    // Period of a MIDI note in samples (A4 = 440Hz)
+    float notePeriod(int note) const { return note_period_[note & 0x7F]; }
     void clearNoteBuffer();
     void resetCCOverrides(); // Reset CC_Received flags to return to front panel control
     void resetCCOverride(int cc_number); // Reset specific CC override
@@ -69,6 +83,19 @@ public:
     void addCCMapping(int channel, int cc, int bank_type, int option_index, int lfo_index = -1, CCCallback callback = nullptr);
     
 private:
-    void defaultCCHandler(Kali* kali, int channel, int cc, int value, int bank_type, int option_index, int lfo_index);
+    static void defaultCCHandler(Kali* kali, const CCMapping& mapping, int value);
+
+    uint8_t pending_value_[16][128];
+    bool pending_[16][128];
+    uint16_t pending_list_[MAX_PENDING_CC]; // channel << 7 | cc
+    int num_pending_;
+
+    // Held notes in press order, newest last
+    static const int MAX_HELD = 16;
+    uint8_t held_[MAX_HELD];
+    int num_held_;
+    void releaseHeld(int note);
+
+    float note_period_[128];
 };
 #endif
@@ -0,0 +1,294 @@
+#pragma once
+#ifndef KALI_MIDI_BUS_H
+#define KALI_MIDI_BUS_H
+
+#include "daisy.h"
+#include "KaliSpscQueue.h"
+#include <cstdint>
+#include <cstring>
+
+using namespace daisy;
+
+/**
+ * @brief One complete MIDI message with the System::GetTick() it was received at
+ *
+ * Kept small on purpose so the queue can be filled from an interrupt without
+ * copying the 128 byte SysEx buffer that daisy::MidiEvent carries.
+ */
+struct KaliMidiMessage
+{
+    uint32_t tick;
+    uint8_t status; // full status byte, channel in the low nibble for voice messages
+    uint8_t data[2];
+    uint8_t source; // KaliMIDIBus::Source
+
+    bool IsRealtime() const { return status >= 0xF8; }
+    uint8_t Channel() const { return status & 0x0F; }
+    uint8_t Kind() const { return status & 0xF0; }
+
+    /** Expand into the libDaisy event type used by the monitor and KaliMIDI. */
+    MidiEvent ToMidiEvent() const
+    {
+        MidiEvent e;
+        e.channel = Channel();
+        e.data[0] = data[0];
+        e.data[1] = data[1];
+        e.sysex_message_len = 0;
+
+        if (status >= 0xF8)
+        {
+            e.type = SystemRealTime;
+            e.srt_type = static_cast<SystemRealTimeType>(status - 0xF8);
+            return e;
+        }
+        if (status >= 0xF0)
+        {
+            e.type = SystemCommon;
+            e.sc_type = static_cast<SystemCommonType>(status - 0xF0);
+            return e;
+        }
+
+        e.type = static_cast<MidiMessageType>((status >> 4) - 8);
+        if (e.type == NoteOn && data[1] == 0)
+            e.type = NoteOff;
+        if (e.type == ControlChange && data[0] >= 120)
+        {
+            e.type = ChannelMode;
+            e.cm_type = static_cast<ChannelModeType>(data[0] - 120);
+        }
+        return e;
+    }
+};
+
+/**
+ * @brief Byte-at-a-time MIDI parser producing KaliMidiMessage
+ *
+ * Handles running status and interleaved realtime bytes. SysEx bodies up
+ * to MAX_SYSEX bytes are collected; a completed one is reported as a
+ * message with status 0xF0 and its bytes (without F0 / F7) are available
+ * from Sysex() until the next byte is parsed. Longer ones are dropped.
+ */
+class KaliMidiParser
+{
+public:
+    static const size_t MAX_SYSEX = 96;
+
+    void Reset()
+    {
+        running_status_ = 0;
+        expected_ = 0;
+        count_ = 0;
+        in_sysex_ = false;
+        sysex_len_ = 0;
+        sysex_overflow_ = false;
+    }
+
+    const uint8_t *Sysex() const { return sysex_; }
+    size_t SysexLength() const { return sysex_len_; }
+
+    /**
+     * @brief Feed one byte
+     * @param byte incoming byte
+     * @param out filled in when a message completes
+     * @return true when out holds a complete message
+     */
+    bool Parse(uint8_t byte, KaliMidiMessage &out)
+    {
+        if (byte >= 0xF8)
+        {
+            // Realtime can appear anywhere, even inside other messages
+            out.status = byte;
+            out.data[0] = out.data[1] = 0;
+            return true;
+        }
+
+        if (byte & 0x80)
+        {
+            const bool sysex_done = in_sysex_ && byte == 0xF7 && !sysex_overflow_;
+            in_sysex_ = (byte == 0xF0);
+            count_ = 0;
+            if (in_sysex_ || byte == 0xF7)
+            {
+                running_status_ = 0;
+                sysex_overflow_ = false;
+                if (in_sysex_)
+                    sysex_len_ = 0;
+                if (!sysex_done)
+                    return false;
+                out.status = 0xF0;
+                out.data[0] = out.data[1] = 0;
+                return true;
+            }
+
+            running_status_ = byte;
+            expected_ = DataLength(byte);
+            if (expected_ == 0)
+            {
+                // Tune request and friends: complete on their own, no running status
+                out.status = byte;
+                out.data[0] = out.data[1] = 0;
+                running_status_ = 0;
+                return true;
+            }
+            return false;
+        }
+
+        if (in_sysex_)
+        {
+            if (sysex_len_ < MAX_SYSEX)
+                sysex_[sysex_len_++] = byte;
+            else
+                sysex_overflow_ = true;
+            return false;
+        }
+        if (running_status_ == 0)
+            return false;
+
+        data_[count_++] = byte;
+        if (count_ < expected_)
+            return false;
+
+        out.status = running_status_;
+        out.data[0] = data_[0];
+        out.data[1] = expected_ > 1 ? data_[1] : 0;
+        count_ = 0;
+        if (running_status_ >= 0xF0)
+            running_status_ = 0; // system common messages do not run
+        return true;
+    }
+
+private:
+    static uint8_t DataLength(uint8_t status)
+    {
+        switch (status & 0xF0)
+        {
+        case 0xC0:
+        case 0xD0:
+            return 1;
+        case 0xF0:
+            switch (status)
+            {
+            case 0xF1:
+            case 0xF3:
+                return 1;
+            case 0xF2:
+                return 2;
+            default:
+                return 0;
+            }
+        default:
+            return 2;
+        }
+    }
+
+    uint8_t running_status_ = 0;
+    uint8_t expected_ = 0;
+    uint8_t count_ = 0;
+    uint8_t data_[2] = {0, 0};
+    bool in_sysex_ = false;
+    uint8_t sysex_[MAX_SYSEX];
+    size_t sysex_len_ = 0;
+    bool sysex_overflow_ = false;
+};
+
+/** A complete SysEx message body (between F0 and F7) and where it came from. */
+struct KaliSysexPacket
+{
+    uint8_t source;
+    uint8_t length;
+    uint8_t data[KaliMidiParser::MAX_SYSEX];
+};
+
+/**
+ * @brief Timestamped MIDI input shared by the timer interrupt and the audio callback
+ *
+ * The timer ISR polls the transports, stamps every completed message with
+ * System::GetTick() and pushes it into a lock-free queue. The audio callback
+ * is the only consumer and uses KaliTimebase to turn the stamps into sample
+ * offsets. TRS and USB each get their own parser, so running status and
+ * half-received messages on one never corrupt the other, but share the
+ * queue, so clock and CC handling downstream don't care where a message
+ * came from.
+ */
+class KaliMIDIBus
+{
+public:
+    enum Source
+    {
+        SOURCE_UART,
+        SOURCE_USB,
+        SOURCE_LAST
+    };
+
+    static const size_t QUEUE_SIZE = 128;
+
+    void Init()
+    {
+        queue.Clear();
+        sysex_queue.Clear();
+        for (int i = 0; i < SOURCE_LAST; i++)
+        {
+            parsers_[i].Reset();
+            bytes_received[i] = 0;
+        }
+    }
+
+    /** ISR side: drain whatever the UART DMA FIFO has collected. */
+    void PollUart(UartHandler &uart)
+    {
+        if (!uart.Readable())
+            return;
+
+        const uint32_t now = System::GetTick();
+        while (uart.Readable())
+            Feed(SOURCE_UART, uart.PopRx(), now);
+    }
+
+    /**
+     * ISR side: drain the USB MIDI ring. The USB stack has already unpacked the
+     * event packets into plain MIDI bytes; the stamp is only as fine as the
+     * poll rate, which is about the 1 ms USB frame anyway.
+     */
+    void PollUsb(MidiUsbTransport &usb)
+    {
+        if (!usb.Readable())
+            return;
+
+        const uint32_t now = System::GetTick();
+        while (usb.Readable())
+            Feed(SOURCE_USB, usb.Rx(), now);
+    }
+
+    /** Push one byte from a transport through its parser. Also handy for replaying captures. */
+    void Feed(Source source, uint8_t byte, uint32_t tick)
+    {
+        KaliMidiMessage msg;
+        bytes_received[source]++;
+        if (!parsers_[source].Parse(byte, msg))
+            return;
+
+        if (msg.status == 0xF0)
+        {
+            // SysEx goes to the main loop, not the audio callback
+            KaliSysexPacket packet;
+            packet.source = source;
+            packet.length = static_cast<uint8_t>(parsers_[source].SysexLength());
+            memcpy(packet.data, parsers_[source].Sysex(), packet.length);
+            sysex_queue.Push(packet);
+            return;
+        }
+
+        msg.tick = tick;
+        msg.source = source;
+        queue.Push(msg);
+    }
+
+    KaliSpscQueue<KaliMidiMessage, QUEUE_SIZE> queue;
+    KaliSpscQueue<KaliSysexPacket, 8> sysex_queue; // consumed by the main loop
+    uint32_t bytes_received[SOURCE_LAST] = {0};
+
+private:
+    KaliMidiParser parsers_[SOURCE_LAST];
+};
+
+#endif
@@ -2,14 +2,10 @@
 #include <algorithm>
 
 KaliMIDIClock::KaliMIDIClock()
-    : state(STOPPED), pulse_count(0), total_pulse_count(0), phase(0.0f), samplerate(0.0f), last_pulse_time(0), current_bpm(120.0f), pulse_time_ms(0.0f), tempo_index(0), gate_active(false), gate_length_ms(2.0f) // Default 2ms gate length
+    : state(STOPPED), pulse_count(0), total_pulse_count(0), phase(0.0f), samplerate(0.0f), last_pulse_time(0), current_bpm(120.0f), pulse_time_ms(0.0f), gate_active(false), gate_length_ms(2.0f) // Default 2ms gate length
       ,
       gate_time_remaining(0.0f), pulse_callback(nullptr), callback_data(nullptr)
 {
-    for (int i = 0; i < TEMPO_AVG_SIZE; i++)
-    {
-        tempo_buffer[i] = 120.0f; // Default 120 BPM
-    }
 }
 
 void KaliMIDIClock::Init(float samplerate_)
@@ -91,36 +87,19 @@ void KaliMIDIClock::Reset()
     gate_time_remaining = 0.0f;
     last_pulse_time = 0;
 
-    // Reset tempo buffer
-    tempo_index = 0;
-    float initial_tempo = (state == RUNNING) ? current_bpm : 120.0f;
-    for (int i = 0; i < TEMPO_AVG_SIZE; i++)
-    {
-        tempo_buffer[i] = initial_tempo;
-    }
+    tracker.Reset();
 }
 
 void KaliMIDIClock::UpdateTempo(uint32_t current_time)
 {
     if (last_pulse_time > 0)
     {
-        // Calculate time between pulses
-        pulse_time_ms = static_cast<float>(current_time - last_pulse_time);
-
-        // Convert to BPM
-        float instantaneous_bpm = 60000.0f / (pulse_time_ms * PPQN);
-
-        // Update running average
-        tempo_buffer[tempo_index] = instantaneous_bpm;
-        tempo_index = (tempo_index + 1) % TEMPO_AVG_SIZE;
-
-        // Calculate average BPM
-        float sum = 0.0f;
-        for (int i = 0; i < TEMPO_AVG_SIZE; i++)
+        // Same DLL tracker KaliClock uses, fed with the time between pulses
+        if (tracker.Process(static_cast<float>(current_time - last_pulse_time)))
         {
-            sum += tempo_buffer[i];
+            pulse_time_ms = tracker.GetPeriod();
+            current_bpm = 60000.0f / (pulse_time_ms * PPQN);
         }
-        current_bpm = sum / TEMPO_AVG_SIZE;
     }
 
     last_pulse_time = current_time;
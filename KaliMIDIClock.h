@@ -3,6 +3,7 @@
 #define KALI_MIDI_CLOCK_H
 
 #include <stdint.h>
+#include "KaliTempoTracker.h"
 
 class KaliMIDIClock
 {
@@ -59,9 +60,7 @@ private:
     float pulse_time_ms; // Time between pulses in ms
 
     // Tempo calculation
-    static const uint8_t TEMPO_AVG_SIZE = 8;
-    float tempo_buffer[TEMPO_AVG_SIZE];
-    uint8_t tempo_index;
+    KaliTempoTracker tracker;
     void UpdateTempo(uint32_t current_time);
 
     // Gate handling
@@ -0,0 +1,140 @@
+#pragma once
+#ifndef KALI_MIDI_OUT_H
+#define KALI_MIDI_OUT_H
+
+#include "daisy.h"
+#include "KaliSpscQueue.h"
+#include <cstdint>
+
+/**
+ * @brief Scheduled MIDI realtime output
+ *
+ * The audio callback works out when each outgoing byte should leave (clock
+ * ticks from the master clock timeline, echoed realtime bytes straight away)
+ * and queues it with a System::GetTick() due time. A dedicated TIM4
+ * interrupt at SERVICE_HZ writes due bytes straight into the USART data
+ * register whenever the transmitter has room, so neither side ever waits on
+ * the UART. Lateness of every byte is measured against its due time.
+ *
+ * TIM4 runs at the top NVIC priority and the audio DMA interrupts one level
+ * below it (set up in main), so the service preempts the audio callback.
+ * A byte is written at most one service period plus the other top priority
+ * interrupts after it is due (tests/test_midi_out_jitter.cpp).
+ *
+ * Bulk data (SysEx dumps) comes from the main loop through a second queue
+ * and fills whatever time the realtime bytes leave free; realtime bytes
+ * are allowed in the middle of SysEx. No bulk byte is started within
+ * BULK_GUARD_US of a queued realtime byte, so the line is clear when it is due.
+ */
+class KaliMIDIOut
+{
+public:
+    static const uint32_t SERVICE_HZ = 8000;
+    static const size_t QUEUE_SIZE = 64;
+    static const uint32_t BULK_GUARD_US = 640; // two bytes at 31250 baud: the shift register and TDR
+
+    struct Item
+    {
+        uint32_t due;
+        uint8_t status;
+    };
+
+    void Init(USART_TypeDef *usart)
+    {
+        usart_ = usart;
+        queue_.Clear();
+        bulk_.Clear();
+        ResetStats();
+
+        daisy::TimerHandle::Config cfg;
+        cfg.periph = daisy::TimerHandle::Config::Peripheral::TIM_4;
+        cfg.dir = daisy::TimerHandle::Config::CounterDir::UP;
+        cfg.enable_irq = true;
+        tim_.Init(cfg);
+        // libDaisy leaves TIM4 at the lowest priority, where it waits out the audio callback
+        HAL_NVIC_SetPriority(TIM4_IRQn, 0, 0);
+        tim_.SetPeriod(tim_.GetFreq() / SERVICE_HZ - 1);
+        tim_.SetCallback(&KaliMIDIOut::ServiceCallback, this);
+        tim_.Start();
+
+        us_per_tick_ = 1000000.f / daisy::System::GetTickFreq();
+        guard_ticks_ = daisy::System::GetTickFreq() / 1000000 * BULK_GUARD_US;
+    }
+
+    /** Producer side (audio callback): transmit status at System tick due. */
+    bool Schedule(uint32_t due, uint8_t status)
+    {
+        Item item = {due, status};
+        return queue_.Push(item);
+    }
+
+    /** Producer side: transmit as soon as the line is free. */
+    bool SendNow(uint8_t status) { return Schedule(daisy::System::GetTick(), status); }
+
+    /** Main loop side: queue a whole message or nothing. */
+    bool SendBulk(const uint8_t *data, size_t len)
+    {
+        if (bulk_.Capacity() - bulk_.Size() < len)
+            return false;
+        for (size_t i = 0; i < len; i++)
+            bulk_.Push(data[i]);
+        return true;
+    }
+
+    bool BulkIdle() const { return bulk_.Empty(); }
+
+    void ResetStats()
+    {
+        sent = 0;
+        late_max_us = 0.f;
+        late_avg_us = 0.f;
+    }
+
+    uint32_t Dropped() const { return queue_.Dropped(); }
+
+    uint32_t sent = 0;
+    float late_max_us = 0.f; // worst lateness since ResetStats()
+    float late_avg_us = 0.f; // smoothed lateness
+
+private:
+    static void ServiceCallback(void *data) { static_cast<KaliMIDIOut *>(data)->Service(); }
+
+    void Service()
+    {
+        // One byte per pass at most: at 31250 baud a byte takes 320us,
+        // longer than the service period, so the data register is the queue.
+        if (!(usart_->ISR & USART_ISR_TXE_TXFNF))
+            return;
+
+        const Item *item = queue_.Peek();
+        const uint32_t now = daisy::System::GetTick();
+        const int32_t late = item ? static_cast<int32_t>(now - item->due) : -1;
+        if (late < 0)
+        {
+            if (item && static_cast<uint32_t>(-late) < guard_ticks_)
+                return;
+            uint8_t byte;
+            if (bulk_.Pop(byte))
+                usart_->TDR = byte;
+            return;
+        }
+
+        usart_->TDR = item->status;
+        queue_.Drop();
+
+        const float late_us = late * us_per_tick_;
+        if (late_us > late_max_us)
+            late_max_us = late_us;
+        late_avg_us += (late_us - late_avg_us) * 0.05f;
+        sent++;
+    }
+
+    KaliSpscQueue<Item, QUEUE_SIZE> queue_;
+    KaliSpscQueue<uint8_t, 256> bulk_;
+    USART_TypeDef *usart_ = nullptr;
+    daisy::TimerHandle tim_;
+    float us_per_tick_ = 0.f;
+    uint32_t guard_ticks_ = 0;
+};
+
+#endif
@@ -0,0 +1,144 @@
+#pragma once
+#ifndef KALI_MEM_CLEAR_H
+#define KALI_MEM_CLEAR_H
+
+#include "daisy.h"
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief Zeroes big SDRAM buffers with the MDMA while the CPU carries on
+ *
+ * Each Start() takes one MDMA channel and fills the buffer from a single
+ * zero word in 64KB blocks (one software request runs the whole repeated
+ * block transfer); the odd tail is cleared by the CPU. The data cache is
+ * cleaned and invalidated before and after, so the buffers must not be
+ * touched until Wait() returns. OnInterrupt() notes when the last
+ * transfer completes, so elapsed_us is the clear and not the time until
+ * somebody waited for it.
+ */
+class KaliMemClear
+{
+public:
+    static const int MAX_JOBS = 4;
+    static const uint32_t BLOCK = 65536; // MDMA block size limit
+
+    /**
+     * @param dst word aligned
+     * @return false if no channel is free or the MDMA refuses; nothing was cleared
+     */
+    bool Start(void *dst, size_t bytes)
+    {
+        if (jobs_ >= MAX_JOBS)
+            return false;
+        if (jobs_ == 0)
+        {
+            __HAL_RCC_MDMA_CLK_ENABLE();
+            HAL_NVIC_SetPriority(MDMA_IRQn, 15, 0);
+            HAL_NVIC_EnableIRQ(MDMA_IRQn);
+            start_us_ = daisy::System::GetUs();
+            done_ = 0;
+        }
+
+        uint8_t *p = static_cast<uint8_t *>(dst);
+        const uint32_t blocks = bytes / BLOCK;
+        const size_t tail = bytes - blocks * BLOCK;
+
+        // Dirty lines over the buffer would land on top of the zeros later
+        SCB_CleanInvalidateDCache();
+
+        if (blocks > 0)
+        {
+            static MDMA_Channel_TypeDef *const channels[MAX_JOBS] = {MDMA_Channel0, MDMA_Channel1,
+                                                                     MDMA_Channel2, MDMA_Channel3};
+            MDMA_HandleTypeDef &h = hmdma_[jobs_];
+            h.Instance = channels[jobs_];
+            h.Init.Request = MDMA_REQUEST_SW;
+            h.Init.TransferTriggerMode = MDMA_REPEAT_BLOCK_TRANSFER;
+            h.Init.Priority = MDMA_PRIORITY_LOW;
+            h.Init.Endianness = MDMA_LITTLE_ENDIANNESS_PRESERVE;
+            h.Init.SourceInc = MDMA_SRC_INC_DISABLE;
+            h.Init.DestinationInc = MDMA_DEST_INC_WORD;
+            h.Init.SourceDataSize = MDMA_SRC_DATASIZE_WORD;
+            h.Init.DestDataSize = MDMA_DEST_DATASIZE_WORD;
+            h.Init.DataAlignment = MDMA_DATAALIGN_PACKENABLE;
+            h.Init.BufferTransferLength = 128;
+            h.Init.SourceBurst = MDMA_SOURCE_BURST_SINGLE;
+            h.Init.DestBurst = MDMA_DEST_BURST_32BEATS;
+            h.Init.SourceBlockAddressOffset = 0;
+            h.Init.DestBlockAddressOffset = 0; // blocks follow on from each other
+            if (HAL_MDMA_Init(&h) != HAL_OK)
+                return false;
+            // Counted before it starts, so OnInterrupt() always sees it
+            __HAL_MDMA_ENABLE_IT(&h, MDMA_IT_CTC);
+            jobs_++;
+            if (HAL_MDMA_Start(&h, reinterpret_cast<uint32_t>(&zero_), reinterpret_cast<uint32_t>(p), BLOCK,
+                               blocks) != HAL_OK)
+            {
+                __HAL_MDMA_DISABLE_IT(&h, MDMA_IT_CTC);
+                jobs_--;
+                return false;
+            }
+        }
+        memset(p + blocks * BLOCK, 0, tail);
+        return true;
+    }
+
+    bool Busy()
+    {
+        for (int i = 0; i < jobs_; i++)
+            if (!__HAL_MDMA_GET_FLAG(&hmdma_[i], MDMA_FLAG_CTC))
+                return true;
+        return false;
+    }
+
+    /**
+     * Call from MDMA_IRQHandler. Completed channels stop interrupting but
+     * keep their CTC flag for Busy(); the last one stamps elapsed_us.
+     */
+    void OnInterrupt()
+    {
+        for (int i = 0; i < jobs_; i++)
+        {
+            MDMA_HandleTypeDef &h = hmdma_[i];
+            if (__HAL_MDMA_GET_IT_SOURCE(&h, MDMA_IT_CTC) && __HAL_MDMA_GET_FLAG(&h, MDMA_FLAG_CTC))
+            {
+                __HAL_MDMA_DISABLE_IT(&h, MDMA_IT_CTC);
+                if (++done_ == jobs_)
+                    elapsed_us = daisy::System::GetUs() - start_us_;
+            }
+        }
+    }
+
+    /** Block until every buffer is clear; returns the microseconds spent waiting. */
+    uint32_t Wait()
+    {
+        const uint32_t wait_start = daisy::System::GetUs();
+        while (Busy())
+        {
+        }
+        const uint32_t now = daisy::System::GetUs();
+        if (jobs_ > 0)
+        {
+            HAL_NVIC_DisableIRQ(MDMA_IRQn);
+            if (done_ < jobs_)
+                elapsed_us = now - start_us_; // interrupt never ran, best we know
+            for (int i = 0; i < jobs_; i++)
+                HAL_MDMA_DeInit(&hmdma_[i]);
+            SCB_CleanInvalidateDCache();
+            jobs_ = 0;
+        }
+        return now - wait_start;
+    }
+
+    volatile uint32_t elapsed_us = 0; // first Start() to the end of the last transfer
+
+private:
+    MDMA_HandleTypeDef hmdma_[MAX_JOBS];
+    volatile int jobs_ = 0;
+    volatile int done_ = 0; // transfers seen complete by OnInterrupt()
+    uint32_t start_us_ = 0;
+    uint32_t zero_ = 0;
+};
+
+#endif
@@ -0,0 +1,258 @@
+#pragma once
+#ifndef KALI_OLED_DRIVER_H
+#define KALI_OLED_DRIVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief SSD1306 128x32 over I2C that only sends the pages that changed
+ *
+ * A drop-in for libDaisy's SSD130xDriver inside OledDisplay. Update()
+ * compares each 128 byte page against what was last sent, copies the ones
+ * that differ into the DMA buffer with their page address in front and
+ * starts the first transfer; the rest are chained from the DMA completion
+ * callback. The main loop is back before the first byte is on the wire,
+ * and an unchanged screen costs nothing. Each page goes out as one
+ * transaction: three commands with the continuation bit set, then the
+ * data stream.
+ *
+ * If Update() comes round while the last frame is still going out, the
+ * new frame is skipped; its pages stay dirty and go out next time.
+ * Contrast changes are queued the same way rather than sent blocking in
+ * the middle of a transfer.
+ *
+ * I2C is daisy::I2CHandle on the hardware. Only Init/TransmitBlocking/
+ * TransmitDma are used; the host tests run it on a modelled bus next to
+ * libDaisy's SSD130x driver and count bytes per frame.
+ */
+template <typename I2C, size_t width = 128, size_t height = 32>
+class KaliOledDriver
+{
+public:
+    static const size_t PAGES = height / 8;
+    static const size_t PAGE_HEADER = 7; // 3 x (0x80, command), then 0x40
+    static const size_t PAGE_BYTES = PAGE_HEADER + width;
+    static const size_t CONTRAST_BYTES = 3;
+    static const size_t DMA_BUFFER_SIZE = CONTRAST_BYTES + PAGES * PAGE_BYTES;
+
+    struct Config
+    {
+        struct TransportConfig
+        {
+            typename I2C::Config i2c_config;
+            uint8_t i2c_address = 0x3C;
+            uint8_t *dma_buffer = nullptr; // DMA_BUFFER_SIZE bytes the I2C DMA can reach
+        } transport_config;
+    };
+
+    void Init(Config config)
+    {
+        address_ = config.transport_config.i2c_address;
+        dma_ = config.transport_config.dma_buffer;
+        i2c_.Init(config.transport_config.i2c_config);
+
+        static const uint8_t init_seq[] = {
+            0xAE,       // display off
+            0xD5, 0x80, // clock divide
+            0xA8, 0x1F, // multiplex, 32 rows
+            0xDA, 0x02, // COM pins
+            0xD3, 0x00, // display offset
+            0x40,       // start line
+            0xA6,       // normal display
+            0xA4,       // resume from RAM
+            0x8D, 0x14, // charge pump
+            0xA1,       // segment remap
+            0xC8,       // COM scan direction
+            0x81, 0x8F, // contrast
+            0xD9, 0x25, // pre charge
+            0xDB, 0x34, // VCOM detect
+            0xAF,       // display on
+        };
+        for (size_t i = 0; i < sizeof(init_seq); i++)
+        {
+            uint8_t buf[2] = {0x00, init_seq[i]};
+            i2c_.TransmitBlocking(address_, buf, 2, 1000);
+        }
+
+        busy_ = false;
+        resend_ = true;
+        contrast_pending_ = false;
+    }
+
+    size_t Width() const { return width; }
+    size_t Height() const { return height; }
+
+    void DrawPixel(uint_fast8_t x, uint_fast8_t y, bool on)
+    {
+        if (x >= width || y >= height)
+            return;
+        if (on)
+            buffer_[x + (y / 8) * width] |= (1 << (y % 8));
+        else
+            buffer_[x + (y / 8) * width] &= ~(1 << (y % 8));
+    }
+
+    void Fill(bool on) { memset(buffer_, on ? 0xFF : 0x00, sizeof(buffer_)); }
+
+    /**
+     * @brief Write a column-mask bitmap, e.g. a KaliTextCache entry
+     *
+     * Each cols[] entry is the rows of one column, bit 0 at y. Like the
+     * font code, the whole w x h cell is written: ink gets on, the rest
+     * gets !on. Columns past the right edge and rows past the bottom are
+     * dropped.
+     */
+    void Blit(int x, int y, const uint32_t *cols, int w, int h, bool on)
+    {
+        static_assert(height <= 32, "cell masks are shifted within 64 bits");
+        if (x < 0 || y < 0 || y >= static_cast<int>(height) || h <= 0)
+            return;
+        const uint64_t cell = (h >= 32 ? 0xFFFFFFFFull : ((1ull << h) - 1)) << y;
+        const int first = y / 8;
+        int last = (y + h - 1) / 8;
+        if (last >= static_cast<int>(PAGES))
+            last = PAGES - 1;
+        if (x + w > static_cast<int>(width))
+            w = width - x;
+        for (int c = 0; c < w; c++)
+        {
+            const uint64_t ink = static_cast<uint64_t>(cols[c]) << y;
+            const uint64_t bits = on ? ink : (cell & ~ink);
+            uint8_t *column = buffer_ + x + c;
+            for (int page = first; page <= last; page++)
+            {
+                const uint8_t mask = static_cast<uint8_t>(cell >> (page * 8));
+                column[page * width] = (column[page * width] & ~mask) | (static_cast<uint8_t>(bits >> (page * 8)) & mask);
+            }
+        }
+    }
+
+    /** Sent ahead of the next frame's pages. */
+    void SetContrast(uint8_t contrast)
+    {
+        contrast_ = contrast;
+        contrast_pending_ = true;
+    }
+
+    /** Queue the changed pages and return; false if the last frame was still going out. */
+    bool Update()
+    {
+        if (busy_)
+        {
+            skipped++;
+            return false;
+        }
+
+        num_jobs_ = 0;
+        size_t used = 0;
+        if (contrast_pending_)
+        {
+            uint8_t *p = dma_;
+            p[0] = 0x00;
+            p[1] = 0x81;
+            p[2] = contrast_;
+            AddJob(p, CONTRAST_BYTES);
+            used += CONTRAST_BYTES;
+            contrast_pending_ = false;
+        }
+
+        // 128x32 modules sit at column 32 of the controller's RAM
+        const uint8_t high_column_addr = height == 32 ? 0x12 : 0x10;
+        for (size_t page = 0; page < PAGES; page++)
+        {
+            const uint8_t *src = buffer_ + page * width;
+            uint8_t *last = sent_ + page * width;
+            if (!resend_ && memcmp(src, last, width) == 0)
+                continue;
+            uint8_t *p = dma_ + used;
+            p[0] = 0x80;
+            p[1] = static_cast<uint8_t>(0xB0 + page);
+            p[2] = 0x80;
+            p[3] = 0x00;
+            p[4] = 0x80;
+            p[5] = high_column_addr;
+            p[6] = 0x40;
+            memcpy(p + PAGE_HEADER, src, width);
+            memcpy(last, src, width);
+            AddJob(p, PAGE_BYTES);
+            used += PAGE_BYTES;
+        }
+        resend_ = false;
+
+        if (num_jobs_ == 0)
+            return true;
+        frames++;
+        bytes += used;
+        next_ = 0;
+        busy_ = true;
+        Kick();
+        return true;
+    }
+
+    bool Busy() const { return busy_; }
+
+    uint32_t frames = 0;  // frames that sent anything
+    uint32_t bytes = 0;   // bytes handed to the DMA, page headers included
+    uint32_t skipped = 0; // Update() calls that found the last frame still going out
+    uint32_t errors = 0;  // failed transfers; the whole screen is resent after one
+
+private:
+    void AddJob(uint8_t *data, size_t size)
+    {
+        jobs_[num_jobs_].data = data;
+        jobs_[num_jobs_].size = static_cast<uint16_t>(size);
+        num_jobs_++;
+    }
+
+    void Kick()
+    {
+        const Job &job = jobs_[next_];
+        if (i2c_.TransmitDma(address_, job.data, job.size, &KaliOledDriver::Done, this) != I2C::Result::OK)
+            Fail();
+    }
+
+    void Fail()
+    {
+        errors++;
+        resend_ = true; // sent_ no longer says what is on the glass
+        busy_ = false;
+    }
+
+    /** DMA completion, in interrupt context. */
+    static void Done(void *context, typename I2C::Result result)
+    {
+        KaliOledDriver *self = static_cast<KaliOledDriver *>(context);
+        if (result != I2C::Result::OK)
+        {
+            self->Fail();
+            return;
+        }
+        if (++self->next_ < self->num_jobs_)
+            self->Kick();
+        else
+            self->busy_ = false;
+    }
+
+    struct Job
+    {
+        uint8_t *data;
+        uint16_t size;
+    };
+
+    I2C i2c_;
+    uint8_t address_ = 0x3C;
+    uint8_t *dma_ = nullptr;
+    uint8_t buffer_[width * PAGES];
+    uint8_t sent_[width * PAGES];
+    Job jobs_[PAGES + 1];
+    size_t num_jobs_ = 0;
+    volatile size_t next_ = 0;
+    volatile bool busy_ = false;
+    bool resend_ = true;
+    uint8_t contrast_ = 0x8F;
+    bool contrast_pending_ = false;
+};
+
+#endif
@@ -39,6 +39,21 @@ KaliOption *OptionRules[3][32] = {
         new KaliOption("Enable Debug Info", "Debug", 0, 1, 1, 1, StringTableType::None, false, ' '),   // show or don't show debug stuff
         new KaliOption("Load Preset", "LoadPset", 0, 32, 1, 0, StringTableType::None, false, ' '),
         new KaliOption("Save Preset", "SavePset", 0, 32, 1, 0, StringTableType::None, false, ' '),
+        new KaliOption("LFO Phase Lock BW", "PLL BW", 0, 100, 5, 10, StringTableType::None, false, '%'), // 0 = free running
+        new KaliOption("Clock Tracking BW", "ClkTrkBW", 1, 100, 1, 20, StringTableType::None, false, ' '), // per mille of the pulse rate
+        new KaliOption("MIDI Clock Out", "ClkOut", 0, 1, 1, 0, StringTableType::None, false, ' '), // 24 PPQN from the master clock
+        new KaliOption("Key Tracking", "KeyTrk", 0, KEYTRACK_MODES_LAST - 1, 1, KEYTRACK_OFF, StringTableType::STKeyTrackModes, false, ' '),
+        new KaliOption("Key Glide", "Glide", 0, 2000, 10, 50, StringTableType::None, false, ' '), // ms
+        new KaliOption("Morph Source", "Morph", 0, MORPH_SOURCES_LAST - 1, 1, MORPH_OFF, StringTableType::STMorphSources, false, ' '),
+        new KaliOption("Morph From Preset", "MorphA", 1, 32, 1, 1, StringTableType::None, false, ' '),
+        new KaliOption("Morph To Preset", "MorphB", 1, 32, 1, 2, StringTableType::None, false, ' '),
+        new KaliOption("Morph Position", "MorphPos", 0, 100, 1, 0, StringTableType::None, false, '%'),
+        new KaliOption("Morph Time (s)", "MorphT", 0.1f, 30.f, 0.1f, 2.f, StringTableType::None, true, ' '),
+        new KaliOption("Frozen Snapshot", "Snapshot", 0, SNAPSHOT_ACTIONS_LAST - 1, 1, SNAPSHOT_MANUAL, StringTableType::STSnapshotActions, false, ' '),
+#if ENABLE_SD_CARD
+        new KaliOption("Record to SD", "Record", 0, RECORD_MODES_LAST - 1, 1, RECORD_OFF, StringTableType::STRecordModes, false, ' '),
+        new KaliOption("Load SAMPLEnn.WAV", "LoadWav", 0, 99, 1, 0, StringTableType::None, false, ' '), // 0 = nothing
+#endif
     },
     {
         // Expose full DSP mode range so we can select Granular/Shimmer, names from STDSPModeNames
@@ -87,4 +102,7 @@ KaliOption *OptionRules[3][32] = {
         // preset related
         new KaliOption("Load Preset", "Load", -1, 32, 1, 0, StringTableType::None, false, 'p'),
         new KaliOption("Save Preset", "Save", 0, 32, 1, 0, StringTableType::None, false, 'p'),
+        // follower modes
+        new KaliOption("Follower Band", "FolBand", 0, 3, 1, 0, StringTableType::STFollowBands, false, ' '),
+        new KaliOption("Follower Detector", "FolDet", 0, 1, 1, 0, StringTableType::STFollowDetectors, false, ' '),
     }};
@@ -7,6 +7,12 @@
 #define ENABLE_FFT_BLUR 0 // Disables SpectralBlur DSP mode
 // Temporary compliance hold: disable reverb return path until a licensing-safe replacement is in place.
 #define ENABLE_REVERB_RETURN 0
+// SD card recording and sample loading (KaliRecorder.h, KaliSampleLoader.h).
+// The DPT routes the SDMMC pins to the encoders, so this is only for boards
+// that wire the card slot instead. Set from the Makefile, which also builds FatFs.
+#ifndef ENABLE_SD_CARD
+#define ENABLE_SD_CARD 0
+#endif
 
 #include "dpt/daisy_dpt.h"
 #include "daisy.h"
@@ -61,9 +67,62 @@ enum OptionsPages
     EnableDebugInfo,
     GlobalPresetLoad,
     GlobalPresetSave,
+    // Added since: append only, stored options are indexed by position
+    LfoPllBandwidth,
+    ClockTrackBandwidth,
+    MidiClockOut,
+    KeyTrack,
+    KeyGlide,
+    MorphSource,
+    MorphFrom,
+    MorphTo,
+    MorphPosition,
+    MorphTime,
+    Snapshot,
+#if ENABLE_SD_CARD
+    SdRecord, // last, so the other indices don't move with the build flag
+    SdLoadSample,
+#endif
     KALI_OPTIONS_LAST
 };
 
+// How held MIDI notes set the delay time
+enum KeyTrackModes
+{
+    KEYTRACK_OFF,
+    KEYTRACK_PITCH, // delay = note period, folded up into the working range
+    KEYTRACK_CLOCK, // delay = whole number of periods nearest the Time knob setting
+    KEYTRACK_MODES_LAST
+};
+
+// What moves the preset morph position
+enum MorphSources
+{
+    MORPH_OFF,
+    MORPH_MANUAL, // Morph Position option (also MIDI CC)
+    MORPH_CV,     // delay adjust CV input
+    MORPH_TIME,   // preset loads glide from the current settings over Morph Time
+    MORPH_SOURCES_LAST
+};
+
+// Snapshot option: Manual / At Boot stick, Save / Load are actions that fall back to them
+enum SnapshotActions
+{
+    SNAPSHOT_MANUAL,
+    SNAPSHOT_AT_BOOT, // restore the stored snapshot on power up
+    SNAPSHOT_SAVE,    // while frozen
+    SNAPSHOT_LOAD,
+    SNAPSHOT_ACTIONS_LAST
+};
+
+enum RecordModes
+{
+    RECORD_OFF,
+    RECORD_OUT,    // stereo output
+    RECORD_OUT_IN, // stereo output, then the dry input
+    RECORD_MODES_LAST
+};
+
 // Delay range presets for different use cases
 enum DelayRangePresets
 {
@@ -102,6 +161,8 @@ enum LFOOptionsPages
     AMAmount,
     LFOPresetLoad,
     LFOPresetSave,
+    FollowBand, // after the preset actions, so stored options keep their index
+    FollowDetector,
     KALI_LFO_OPTIONS_LAST
 };
 
@@ -15,15 +15,6 @@ void KaliOscillator::Init(float sample_rate)
     adsr.SetReleaseTime(1.0f);
     cn.Init(sample_rate);
 
-    // Initialize visualization buffer
-    for (int i = 0; i < 64; i++)
-    {
-        last32[i] = 0.0f;
-    }
-    last32pos = 0;
-    last32posstepped = 0;
-    last32possteppedmax = 24; // Set default decimation rate for visualization
-
     // Initialize wavetable with defaults
     for (int i = 0; i < 16; i++)
     {
@@ -138,12 +129,32 @@ void KaliOscillator::SetParent(std::shared_ptr<Kali> parent)
     kali_ = parent;
 }
 
+static bool UsesFollower(unsigned int mode)
+{
+    return mode == Kali::LFOModes::FeedbackFollower ||
+           mode == Kali::LFOModes::Sidechain ||
+           mode == Kali::LFOModes::Envelope;
+}
+
+uint32_t KaliOscillator::FollowMask() const
+{
+    unsigned int m = (unsigned int)preset.Options[LFOOptionsPages::LFOMode];
+    if (index >= 6 || !UsesFollower(m))
+        return 0;
+
+    int band = DSY_CLAMP((int)preset.Options[LFOOptionsPages::FollowBand], 0, EnvelopeFollower<2>::NUM_BANDS - 1);
+    int det = DSY_CLAMP((int)preset.Options[LFOOptionsPages::FollowDetector], 0, EnvelopeFollower<2>::NUM_DETECTORS - 1);
+    return EnvelopeFollower<2>::Bit(band, det);
+}
+
 void KaliOscillator::UpdateFollow()
 {
     int channel_idx[6] = {0, 0, 0, 1, 1, 1};
     if (Follower && index >= 0 && index < 6)
     {
-        follow_level = Follower->m_env[channel_idx[index]] * (lfo_adjust * 16.f);
+        int band = DSY_CLAMP((int)preset.Options[LFOOptionsPages::FollowBand], 0, EnvelopeFollower<2>::NUM_BANDS - 1);
+        int det = DSY_CLAMP((int)preset.Options[LFOOptionsPages::FollowDetector], 0, EnvelopeFollower<2>::NUM_DETECTORS - 1);
+        follow_level = Follower->Get(channel_idx[index], band, det) * (lfo_adjust * 16.f);
     }
     else
     {
@@ -151,6 +162,71 @@ void KaliOscillator::UpdateFollow()
     }
 }
 
+bool KaliOscillator::IsPhaseLockable() const
+{
+    if (index >= 6 || is_clock || waveform == Oscillator::WAVE_NOISE)
+        return false;
+
+    switch ((int)preset.Options[LFOOptionsPages::LFOMode])
+    {
+    case Kali::LFOModes::SyncStraight:
+    case Kali::LFOModes::SyncSH:
+    case Kali::LFOModes::SyncTH:
+    case Kali::LFOModes::Wavetable:
+    case Kali::LFOModes::Glacier:
+    case Kali::LFOModes::Polythene:
+    case Kali::LFOModes::Sidechain:
+    case Kali::LFOModes::Envelope:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static inline float WrapCycles(float x)
+{
+    return x - floorf(x);
+}
+
+void KaliOscillator::PhaseLock(int beat_offset, size_t block_size, float samples_per_beat, float bandwidth)
+{
+    if (bandwidth <= 0.f || samples_per_beat <= 0.f || sample_rate_ <= 0.f || !IsPhaseLockable())
+    {
+        pll_armed_ = false;
+        pll_trim_ = 1.f;
+        return;
+    }
+
+    if (beat_offset < 0)
+        return;
+
+    // Process() runs once per block, so the phase advances this much per block
+    const float cycles_per_block = nominal_freq_ / sample_rate_;
+    const float phase = PhaseGet() * (1.f / TWOPI_F);
+    const float at_beat = phase + cycles_per_block * (static_cast<float>(beat_offset) / block_size);
+
+    if (!pll_armed_)
+    {
+        // Lock to whatever phase relationship we have now rather than jumping
+        pll_ref_ = WrapCycles(at_beat);
+        pll_trim_ = 1.f;
+        pll_armed_ = true;
+        return;
+    }
+
+    const float cycles_per_beat = cycles_per_block * samples_per_beat / block_size;
+    pll_ref_ = WrapCycles(pll_ref_ + cycles_per_beat);
+
+    const float err = WrapCycles(pll_ref_ - at_beat + 0.5f) - 0.5f;
+    const float kp = DSY_CLAMP(bandwidth, 0.f, 1.f);
+    const float ki = 0.25f * kp * kp; // roughly critically damped
+
+    PhaseAdd(WrapCycles(phase + kp * err) - phase);
+
+    if (cycles_per_beat > 0.f)
+        pll_trim_ = DSY_CLAMP(pll_trim_ + ki * err / cycles_per_beat, 0.9f, 1.1f);
+}
+
 void KaliOscillator::UpdateLocalParams()
 {
     if (!is_clock)
@@ -251,7 +327,8 @@ float KaliOscillator::Process(KaliOscillator *myfriends)
     frequency += oneover4096 * fm * preset.GetOption(LFOOptionsPages::FMSourceAmount);
 
     // Set the final oscillator frequency
-    Oscillator::SetFreq(frequency * metadonk * global_lfo_rate);
+    nominal_freq_ = frequency * metadonk * global_lfo_rate;
+    Oscillator::SetFreq(nominal_freq_ * pll_trim_);
 
     // Get the base oscillator output
     float parentsays;
@@ -313,6 +390,9 @@ float KaliOscillator::Process(KaliOscillator *myfriends)
     case Kali::LFOModes::FeedbackFollower:
         last = follow_level * 4096.f;
         break;
+    case Kali::LFOModes::Envelope:
+        last *= DSY_CLAMP(follow_level, 0.f, 1.f);
+        break;
     case Kali::LFOModes::SyncTH:
         last = th.Process(flipTrack, parentsays, SampleHold::Mode::MODE_TRACK_HOLD);
         break;
@@ -392,28 +472,6 @@ float KaliOscillator::Process(KaliOscillator *myfriends)
     // Apply final scaling
     last = DSY_CLAMP(((last + offset) * (attenuate * 0.01f)), 0, 4095);
 
-    // Store value for visualization with anti-aliasing decimation
-    if (last32possteppedmax <= 0)
-        last32possteppedmax = 1; // Prevent division by zero
-
-    if (++last32posstepped >= last32possteppedmax)
-    {
-        // Convert from 0-4095 range to centered bipolar range for visualization
-        float visualValue = (last - 2048.f) * -1.f;
-
-        // Apply some smoothing for better visualization (optional)
-        // if (last32pos > 0)
-        // {
-        //     visualValue = 0.7f * visualValue + 0.3f * last32[(last32pos - 1) % 64];
-        // }
-
-        last32[last32pos] = visualValue;
-
-        // Wrap around buffer position
-        last32pos = (last32pos + 1) % 64;
-        last32posstepped = 0;
-    }
-
     displayfrequency = frequency * metadonk;
     return last;
 }
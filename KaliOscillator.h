@@ -21,7 +21,6 @@ class Kali;
  * - Multiple LFO modes (sync, random, envelope following, etc)
  * - Wavetable capabilities with interpolation
  * - Extensive modulation options
- * - Visual feedback for UI display
  * - Clock sync and division features
  */
 class KaliOscillator : public Oscillator
@@ -39,7 +38,7 @@ public:
     // LFO and modulation control
     float lfo_adjust; // Adjusts LFO behavior based on mode
     bool flip;        // Signal inversion flag
-    EnvelopeFollower<2, float> *Follower;
+    EnvelopeFollower<2> *Follower;
 
     // Randomization/timing components
     Maytrig mt;      // Probabilistic trigger
@@ -55,12 +54,6 @@ public:
     // Wavetable functionality
     uint8_t wavetable[16];
 
-    // Visualization data (for UI)
-    float last32[64]; // Buffer for visualization
-    int last32pos;    // Current position in visualization buffer
-    int last32posstepped;
-    int last32possteppedmax;
-
     // Output formatting
     float attenuate;     // Output attenuator (0-100%)
     float offset;        // Offset added to output
@@ -159,6 +152,33 @@ public:
      */
     void UpdateFollow();
 
+    /**
+     * @brief Phase-lock the oscillator to the master clock
+     *
+     * Call once per block before Process(). On blocks containing a beat the
+     * phase at that sample is compared with a reference that advances by the
+     * nominal cycles-per-beat, and a proportional phase nudge plus an integral
+     * frequency trim pull the error back to zero.
+     *
+     * @param beat_offset Sample offset of the beat in this block, -1 for none
+     * @param block_size Audio block size
+     * @param samples_per_beat Clock period the LFO frequency was derived from
+     * @param bandwidth Fraction of the phase error removed per beat, 0 disables
+     */
+    void PhaseLock(int beat_offset, size_t block_size, float samples_per_beat, float bandwidth);
+
+    /**
+     * @brief Whether the current mode has a clock-derived phase worth locking
+     */
+    bool IsPhaseLockable() const;
+
+    /**
+     * @brief Follower outputs this LFO needs for the next block
+     * @return EnvelopeFollower::Bit() for the selected band and detector, or 0
+     * when the current mode does not follow anything
+     */
+    uint32_t FollowMask() const;
+
     /**
      * @brief Process one sample
      * @return Processed output value
@@ -196,6 +216,12 @@ private:
     float noise_phase = 0.0f;
     float noise_filter = 0.0f;
     float sample_rate_ = 0.0f;
+
+    // Phase lock state, all phases in cycles
+    float nominal_freq_ = 0.0f; // Frequency before the PLL trim
+    float pll_ref_ = 0.0f;
+    float pll_trim_ = 1.0f;
+    bool pll_armed_ = false;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+#ifndef KALI_PRESET_LAYOUT_H
+#define KALI_PRESET_LAYOUT_H
+
+#include <cstdint>
+#include "KaliConfig.h"
+#include "KaliOptions.h"
+#include "KaliRecordStore.h"
+
+// Main preset (6 LFOs + 1 DSP) and persistent config formats, and where
+// they live in QSPI. Shared by the preset code in Kali.cpp and the SysEx
+// dump/restore.
+
+constexpr uint32_t MAIN_PRESET_MAGIC = 0x4B414C50; // 'KALP'
+constexpr uint32_t MAIN_PRESET_VERSION = 2; // 1: KaliVersionManager::upgradeMainPreset()
+// Legacy fixed layout: config at 0, one erased-and-rewritten sector per
+// slot. Only read now, to import into the record store on first boot.
+constexpr uint32_t MAIN_PRESET_BASE = 0x0010000; // 64KB into QSPI
+constexpr uint32_t MAIN_PRESET_SECTOR = 0x1000;  // 4KB per slot
+
+struct MainPresetEntry
+{
+    uint32_t magic;
+    uint32_t version;
+    char name[16];
+    float lfo[6][LFOOptionsPages::KALI_LFO_OPTIONS_LAST];
+    float dsp[DSPOptionsPages::KALI_DSP_OPTIONS_LAST];
+    float knob_snapshot[8];     // Knob positions at save time (for soft takeover)
+    uint8_t last_selected_slot; // Remember last selection
+    uint8_t reserved[3];        // Padding for alignment
+};
+
+// Persistent config location (separate from presets), legacy layout
+const uint32_t PERSISTENT_CONFIG_ADDR = MAIN_PRESET_BASE + (MAX_PRESETS * MAIN_PRESET_SECTOR);
+
+struct PersistentConfig
+{
+    uint32_t magic;
+    uint8_t last_preset_slot;
+    uint8_t reserved[251]; // Pad to 256 bytes
+};
+const uint32_t PERSISTENT_CONFIG_MAGIC = 0xCA11C0FF; // CALLCOFF (Kali Config)
+
+static inline uint32_t preset_slot_addr(int slot)
+{
+    if (slot < 0)
+        slot = 0;
+    if (slot >= MAX_PRESETS)
+        slot = MAX_PRESETS - 1;
+    return MAIN_PRESET_BASE + static_cast<uint32_t>(slot) * MAIN_PRESET_SECTOR;
+}
+
+// Record store (KaliRecordStore.h) that holds all of the above now
+constexpr uint32_t STORE_BASE = 0x0040000; // 256KB into QSPI
+constexpr uint32_t STORE_SECTORS = 64;
+constexpr uint32_t STORE_STAGING = 32 * 1024;
+
+// The config is stored as independent sections (see KaliVersion.cpp), one
+// record each, so a save only writes the sections that changed
+constexpr uint16_t CONFIG_SECTIONS = 17;
+
+constexpr uint16_t KEY_CONFIG_FIRST = 0;  // one per config section
+constexpr uint16_t KEY_PRESET_FIRST = 24; // spare keys for more sections
+constexpr uint16_t KEY_LAST_SLOT = KEY_PRESET_FIRST + MAX_PRESETS; // uint8_t
+static_assert(KEY_CONFIG_FIRST + CONFIG_SECTIONS <= KEY_PRESET_FIRST, "config sections overlap presets");
+static_assert(KEY_LAST_SLOT < KaliRecordStore::MAX_KEYS, "store keys exhausted");
+
+// Frozen delay line snapshot (KaliSnapshot.h), after everything above
+constexpr uint32_t SNAPSHOT_BASE = 0x0100000;    // 1MB into QSPI
+constexpr uint32_t SNAPSHOT_SIZE = 0x0700000;    // rest of the 8MB chip
+constexpr uint32_t SNAPSHOT_STAGING = 0x0300000; // four lines of 30s ADPCM, ~2.9MB
+static_assert(STORE_BASE + STORE_SECTORS * 4096 <= SNAPSHOT_BASE, "snapshot overlaps the record store");
+
+static inline uint16_t preset_slot_key(int slot)
+{
+    if (slot < 0)
+        slot = 0;
+    if (slot >= MAX_PRESETS)
+        slot = MAX_PRESETS - 1;
+    return KEY_PRESET_FIRST + static_cast<uint16_t>(slot);
+}
+
+#endif
@@ -0,0 +1,180 @@
+#pragma once
+#ifndef KALI_PRESET_MORPH_H
+#define KALI_PRESET_MORPH_H
+
+#include "KaliOptions.h"
+#include "KaliPresetLayout.h"
+#include <atomic>
+#include <cmath>
+
+/**
+ * @brief Per-block interpolation between two main presets
+ *
+ * The main loop decodes both presets once into flat arrays (start value and
+ * distance for every LFO and DSP option); the audio callback then writes
+ * start + distance * position straight into the live option values. Options
+ * that name something (string tables, on/off) jump at the midpoint, integer
+ * ones are rounded to their step, and the preset load/save actions are left
+ * alone.
+ *
+ * Pairs are double buffered: the main loop fills the idle set and flips,
+ * so a block never sees half a preset.
+ */
+class KaliPresetMorph
+{
+public:
+    static const int LFOS = 6;
+    static const int LFO_OPTIONS = LFOOptionsPages::KALI_LFO_OPTIONS_LAST;
+    static const int DSP_OPTIONS = DSPOptionsPages::KALI_DSP_OPTIONS_LAST;
+    static const int COUNT = LFOS * LFO_OPTIONS + DSP_OPTIONS;
+
+    /**
+     * @param lfo_options Options array of each of the six LFO presets
+     * @param dsp_values Value of each DSP option rule
+     */
+    void Init(float *const *lfo_options, float *const *dsp_values)
+    {
+        for (int i = 0; i < LFOS; i++)
+            for (int j = 0; j < LFO_OPTIONS; j++)
+                Classify(i * LFO_OPTIONS + j, &lfo_options[i][j], BankType::LFO, j);
+        for (int j = 0; j < DSP_OPTIONS; j++)
+            Classify(LFOS * LFO_OPTIONS + j, dsp_values[j], BankType::DSP, j);
+        active_ = -1;
+    }
+
+    /**
+     * @brief Main loop: decode a pair into the set the audio callback isn't reading
+     *
+     * Nothing changes until Start(), which either side may call.
+     */
+    void Prepare(const MainPresetEntry &a, const MainPresetEntry &b)
+    {
+        const int w = active_.load() == 0 ? 1 : 0;
+        Set &s = sets_[w];
+        for (int i = 0; i < LFOS; i++)
+        {
+            for (int j = 0; j < LFO_OPTIONS; j++)
+            {
+                s.start[i * LFO_OPTIONS + j] = a.lfo[i][j];
+                s.end[i * LFO_OPTIONS + j] = b.lfo[i][j];
+            }
+        }
+        for (int j = 0; j < DSP_OPTIONS; j++)
+        {
+            s.start[LFOS * LFO_OPTIONS + j] = a.dsp[j];
+            s.end[LFOS * LFO_OPTIONS + j] = b.dsp[j];
+        }
+        for (int k = 0; k < COUNT; k++)
+            s.span[k] = s.end[k] - s.start[k];
+        prepared_ = w;
+    }
+
+    /** Switch to the prepared pair; the next Process() writes every option. */
+    void Start()
+    {
+        fresh_ = true;
+        active_ = prepared_;
+    }
+
+    /** Main loop: morph from a to b from the next block on. */
+    void Load(const MainPresetEntry &a, const MainPresetEntry &b)
+    {
+        Prepare(a, b);
+        Start();
+    }
+
+    /** Main loop: leave the options where they are. */
+    void Stop() { active_ = -1; }
+
+    bool Active() const { return active_.load() >= 0; }
+
+    /** Audio callback: set every option for position 0 (a) .. 1 (b). */
+    void Process(float position)
+    {
+        const int a = active_.load();
+        if (a < 0)
+            return;
+        position = position < 0.f ? 0.f : (position > 1.f ? 1.f : position);
+        if (!fresh_ && fabsf(position - position_) < 0.0005f)
+            return; // nothing moved, the options still hold the last result
+        fresh_ = false;
+        position_ = position;
+
+        const Set &s = sets_[a];
+        const bool second_half = position >= 0.5f;
+        for (int k = 0; k < COUNT; k++)
+        {
+            switch (kind_[k])
+            {
+            case CONTINUOUS:
+                *target_[k] = s.start[k] + s.span[k] * position;
+                break;
+            case STEPPED:
+            {
+                const float v = s.start[k] + s.span[k] * position - min_[k];
+                *target_[k] = min_[k] + floorf(v * step_recip_[k] + 0.5f) * step_[k];
+                break;
+            }
+            case DISCRETE:
+                *target_[k] = second_half ? s.end[k] : s.start[k];
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    float Position() const { return position_; }
+
+private:
+    enum Kind : uint8_t
+    {
+        CONTINUOUS,
+        STEPPED,
+        DISCRETE,
+        SKIP,
+    };
+
+    struct Set
+    {
+        float start[COUNT];
+        float end[COUNT];
+        float span[COUNT];
+    };
+
+    void Classify(int k, float *target, int bank, int index)
+    {
+        const KaliOption *rule = OptionRules[bank][index];
+        target_[k] = target;
+        min_[k] = rule->Min;
+        step_[k] = rule->Step;
+        step_recip_[k] = rule->Step > 0.f ? 1.f / rule->Step : 0.f;
+
+        const bool action = (bank == BankType::LFO && (index == LFOOptionsPages::LFOPresetLoad ||
+                                                        index == LFOOptionsPages::LFOPresetSave)) ||
+                            (bank == BankType::DSP && (index == DSPOptionsPages::DSPPresetLoad ||
+                                                        index == DSPOptionsPages::DSPPresetSave));
+        if (action)
+            kind_[k] = SKIP;
+        else if (rule->STType != StringTableType::None || rule->Max - rule->Min <= rule->Step)
+            kind_[k] = DISCRETE;
+        else if (!rule->IsFloat && rule->Step > 0.f)
+            kind_[k] = STEPPED;
+        else
+            kind_[k] = CONTINUOUS;
+    }
+
+    Set sets_[2];
+    std::atomic<int> active_{-1};
+    volatile int prepared_ = 0;
+    volatile bool fresh_ = false;
+    float position_ = 0.f;
+
+    float *target_[COUNT];
+    float min_[COUNT];
+    float step_[COUNT];
+    float step_recip_[COUNT];
+    uint8_t kind_[COUNT];
+};
+
+#endif
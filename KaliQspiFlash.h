@@ -0,0 +1,64 @@
+#pragma once
+#ifndef KALI_QSPI_FLASH_H
+#define KALI_QSPI_FLASH_H
+
+#include "daisy.h"
+#include "KaliRecordStore.h"
+
+/**
+ * @brief KaliFlash on the Daisy QSPI chip
+ *
+ * libDaisy drops out of memory mapped mode for every program or erase and
+ * returns to it afterwards, so Data() pointers are only valid between calls
+ * and nothing that runs in an interrupt may read the QSPI meanwhile. An
+ * erase started with StartErase() keeps it out of memory mapped mode until
+ * EraseBusy() has seen the chip finish. The record store and the snapshot
+ * share one of these, and it is the one place that knows about an erase in
+ * flight: whoever started it, the other client's programs and erases are
+ * refused and its reads wait.
+ */
+class KaliQspiFlash : public KaliFlash
+{
+public:
+    void Init(daisy::QSPIHandle *qspi) { qspi_ = qspi; }
+
+    const uint8_t *Data(uint32_t addr) override
+    {
+        WaitErase();
+        return static_cast<const uint8_t *>(qspi_->GetData(addr));
+    }
+
+    bool Program(uint32_t addr, const uint8_t *data, uint32_t len) override
+    {
+        if (EraseBusy())
+            return false;
+        return qspi_->Write(addr, len, const_cast<uint8_t *>(data)) == daisy::QSPIHandle::Result::OK;
+    }
+
+    bool EraseSector(uint32_t addr) override
+    {
+        WaitErase();
+        return qspi_->EraseSector(addr) == daisy::QSPIHandle::Result::OK;
+    }
+
+    bool StartErase(uint32_t addr) override
+    {
+        if (EraseBusy())
+            return false;
+        return qspi_->StartEraseSector(addr) == daisy::QSPIHandle::Result::OK;
+    }
+
+    bool EraseBusy() override { return qspi_->EraseBusy(); }
+
+private:
+    void WaitErase()
+    {
+        while (qspi_->EraseBusy())
+        {
+        }
+    }
+
+    daisy::QSPIHandle *qspi_ = nullptr;
+};
+
+#endif
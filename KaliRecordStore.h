@@ -0,0 +1,679 @@
+#pragma once
+#ifndef KALI_RECORD_STORE_H
+#define KALI_RECORD_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief NOR flash as seen by KaliRecordStore
+ *
+ * Program() may only clear bits and Data() is the memory mapped view.
+ * StartErase() may return before the sector is blank. The flash is shared
+ * (record store, snapshot), so until EraseBusy() has returned false every
+ * client sees it busy: Program() and StartErase() refuse, Data() and
+ * EraseSector() wait. Clients poll EraseBusy() before touching the flash
+ * so they never wait. Implementations that can only erase synchronously
+ * keep the defaults.
+ * KaliQspiFlash is the QSPI implementation; anything with the same NOR
+ * semantics (a RAM model on the host, for one) can stand in for it.
+ */
+class KaliFlash
+{
+public:
+    static const uint32_t SECTOR_SIZE = 4096;
+    static const uint32_t PAGE_SIZE = 256;
+
+    virtual ~KaliFlash() {}
+    virtual const uint8_t *Data(uint32_t addr) = 0;
+    virtual bool Program(uint32_t addr, const uint8_t *data, uint32_t len) = 0;
+    virtual bool EraseSector(uint32_t addr) = 0;
+    virtual bool StartErase(uint32_t addr) { return EraseSector(addr); }
+    virtual bool EraseBusy() { return false; }
+};
+
+/**
+ * @brief Append-only key / record store over a ring of flash sectors
+ *
+ * Put() only copies the record into a RAM staging FIFO and returns. Step(),
+ * called from the main loop, programs at most a few pages per call;
+ * a record becomes visible on flash once its commit word is programmed,
+ * after the payload, so a power cut leaves either the old or the new copy.
+ * Get() sees staged records straight away.
+ *
+ * Sectors are written in ring order and always reclaimed from the oldest
+ * end: live records still in that sector are copied to the head, then it
+ * is erased. Every sector is therefore erased equally often (the erase
+ * count is kept in each sector header) and nothing is erased on the save
+ * path. Step() only starts an erase and later calls poll it, so a sector
+ * erase (tens of ms) never stalls the main loop; Get() waits for one in
+ * flight only if it has to read the flash. Mount() rebuilds the key index
+ * by scanning the ring in sequence order, newest copy of a key wins, empty
+ * records are deletions.
+ */
+class KaliRecordStore
+{
+public:
+    static const uint16_t MAX_KEYS = 64;
+    static const uint32_t MAX_SECTORS = 64;
+    static const uint32_t SECTOR = KaliFlash::SECTOR_SIZE;
+    static const uint32_t PAGE = KaliFlash::PAGE_SIZE;
+
+    struct SectorHeader
+    {
+        uint32_t magic;
+        uint32_t seq;
+        uint32_t erase_count;
+        uint32_t check; // ~(magic ^ seq ^ erase_count)
+    };
+
+    struct RecordHeader
+    {
+        uint16_t key;
+        uint16_t len; // 0 deletes the key
+        uint32_t seq;
+        uint32_t crc; // over key, len, seq and payload
+        uint32_t commit;
+    };
+
+    static const uint32_t MAX_RECORD = SECTOR - sizeof(SectorHeader) - sizeof(RecordHeader);
+
+    /**
+     * @param base first byte of the region, sector aligned
+     * @param sectors region size in sectors, 4..MAX_SECTORS
+     * @param staging RAM for records waiting to be programmed (can be SDRAM)
+     */
+    void Init(KaliFlash *flash, uint32_t base, uint32_t sectors, uint8_t *staging, uint32_t staging_size)
+    {
+        flash_ = flash;
+        base_ = base;
+        sectors_ = sectors > MAX_SECTORS ? MAX_SECTORS : sectors;
+        staging_ = staging;
+        staging_size_ = staging_size;
+        stage_read_ = stage_write_ = 0;
+        job_.active = false;
+        gc_active_ = false;
+        erasing_ = NONE;
+    }
+
+    /**
+     * @brief Rebuild the index from flash; blocking, call once at boot
+     * @return true if the region held no records (new or wiped)
+     */
+    bool Mount()
+    {
+        for (int k = 0; k < MAX_KEYS; k++)
+            index_[k] = NONE;
+        live_bytes_ = 0;
+        staged_bytes_ = 0;
+        record_seq_ = 1;
+        stage_read_ = stage_write_ = 0;
+        job_.active = false;
+        gc_active_ = false;
+        while (flash_->EraseBusy())
+        {
+        }
+        erasing_ = NONE;
+
+        // Newest valid sector is the head; the tail is as far back as the
+        // sequence numbers keep counting down without a gap
+        uint32_t head = NONE, head_seq = 0, max_erase = 0;
+        for (uint32_t s = 0; s < sectors_; s++)
+        {
+            const SectorHeader *h = SectorAt(s);
+            erase_counts_[s] = ValidSector(h) ? h->erase_count : 0;
+            if (erase_counts_[s] > max_erase)
+                max_erase = erase_counts_[s];
+            if (ValidSector(h) && (head == NONE || h->seq > head_seq))
+            {
+                head = s;
+                head_seq = h->seq;
+            }
+        }
+
+        uint32_t tail = head, used = 0;
+        if (head != NONE)
+        {
+            used = 1;
+            while (used < sectors_)
+            {
+                const uint32_t prev = (tail + sectors_ - 1) % sectors_;
+                const SectorHeader *h = SectorAt(prev);
+                if (!ValidSector(h) || h->seq + used != head_seq)
+                    break;
+                tail = prev;
+                used++;
+            }
+        }
+
+        // Everything outside the ring must be blank before it can be reused
+        for (uint32_t s = 0; s < sectors_; s++)
+        {
+            if (head != NONE && RingDistance(tail, s) < used)
+                continue;
+            if (!ValidSector(SectorAt(s)))
+                erase_counts_[s] = max_erase; // unknown, assume the worst
+            if (!Blank(SectorAddr(s), SECTOR))
+                EraseNow(s);
+        }
+
+        if (head == NONE)
+        {
+            tail_ = head_ = 0;
+            sector_seq_ = 0;
+            OpenSector(0);
+            return true;
+        }
+
+        tail_ = tail;
+        head_ = head;
+        sector_seq_ = head_seq;
+        free_ = sectors_ - used;
+
+        for (uint32_t n = 0; n < used; n++)
+            head_off_ = ScanSector((tail_ + n) % sectors_, true);
+        return live_bytes_ == 0;
+    }
+
+    /**
+     * @brief Queue a record; the caller's buffer is free on return
+     * @return false if the staging FIFO or the region is too full right now
+     */
+    bool Put(uint16_t key, const void *data, uint32_t len)
+    {
+        if (key >= MAX_KEYS || len > MAX_RECORD)
+            return false;
+
+        // Nothing to do if that is already the newest copy
+        uint32_t cur_len;
+        const uint8_t *cur = Get(key, cur_len);
+        if (cur ? (cur_len == len && memcmp(cur, data, len) == 0) : len == 0)
+            return true;
+
+        if (!Reserve(RecordSize(len)))
+            return false;
+        if (!StageRoom(StageSize(len)))
+            return false;
+
+        StageEntry e = {key, static_cast<uint16_t>(len)};
+        memcpy(staging_ + stage_write_, &e, sizeof(e));
+        if (len)
+            memcpy(staging_ + stage_write_ + sizeof(e), data, len);
+        stage_write_ += StageSize(len);
+        staged_bytes_ += RecordSize(len);
+        return true;
+    }
+
+    bool Remove(uint16_t key) { return Put(key, nullptr, 0); }
+
+    /** Whether records totalling bytes would all be accepted by Put() now. */
+    bool HasRoom(uint32_t bytes, uint32_t records) const
+    {
+        const uint32_t padded = bytes + records * (sizeof(StageEntry) + 3);
+        const uint32_t stage_free =
+            stage_read_ == stage_write_ ? staging_size_ : staging_size_ - stage_write_;
+        return padded <= stage_free && Reserve(bytes + records * (sizeof(RecordHeader) + 3));
+    }
+
+    /** Newest copy of key, staged or on flash; nullptr if there is none. */
+    const uint8_t *Get(uint16_t key, uint32_t &len)
+    {
+        len = 0;
+        if (key >= MAX_KEYS)
+            return nullptr;
+
+        const uint8_t *found = nullptr;
+        bool staged = false;
+        for (uint32_t pos = stage_read_; pos < stage_write_;)
+        {
+            StageEntry e;
+            memcpy(&e, staging_ + pos, sizeof(e));
+            if (e.key == key)
+            {
+                staged = true;
+                len = e.len;
+                found = e.len ? staging_ + pos + sizeof(e) : nullptr;
+            }
+            pos += StageSize(e.len);
+        }
+        if (staged)
+            return found;
+
+        if (index_[key] == NONE)
+            return nullptr;
+        while (erasing_ != NONE && !FinishErase())
+        {
+        }
+        while (flash_->EraseBusy())
+        {
+        }
+        const RecordHeader *r = RecordAt(index_[key]);
+        len = r->len;
+        return reinterpret_cast<const uint8_t *>(r + 1);
+    }
+
+    /**
+     * @brief One bounded piece of background work
+     * @return true while records are waiting or a sector is being reclaimed
+     */
+    bool Step()
+    {
+        if (erasing_ != NONE && !FinishErase())
+            return true;
+        if (flash_->EraseBusy())
+            return true; // another client's erase
+        for (int op = 0; op < OPS_PER_STEP; op++)
+        {
+            if (!job_.active)
+            {
+                if (!StartJob())
+                    return false;
+                if (!job_.active)
+                    return true; // an erase was started, polled from the next step
+            }
+            if (!RunJob())
+                return true; // flash error, try again next time
+        }
+        return Busy();
+    }
+
+    /** Finish everything queued; blocking, for boot and shutdown paths. */
+    void Flush()
+    {
+        for (int guard = 0; guard < 100000 && Step(); guard++)
+        {
+        }
+    }
+
+    bool Busy() const { return job_.active || gc_active_ || stage_read_ != stage_write_; }
+
+    uint32_t FreeSectors() const { return free_; }
+    uint32_t LiveBytes() const { return live_bytes_; }
+
+    /** Difference between the most and least erased sector. */
+    uint32_t EraseSpread() const
+    {
+        uint32_t lo = erase_counts_[0], hi = erase_counts_[0];
+        for (uint32_t s = 1; s < sectors_; s++)
+        {
+            lo = erase_counts_[s] < lo ? erase_counts_[s] : lo;
+            hi = erase_counts_[s] > hi ? erase_counts_[s] : hi;
+        }
+        return hi - lo;
+    }
+
+    uint32_t records_written = 0;
+    uint32_t records_moved = 0; // copied out of a sector before its erase
+    uint32_t sectors_erased = 0;
+    uint32_t errors = 0;
+
+private:
+    static const uint32_t SECTOR_MAGIC = 0x4B4C4F47; // 'KLOG'
+    static const uint32_t COMMITTED = 0;
+    static const uint32_t NONE = 0xFFFFFFFF;
+    static const uint32_t RESERVE = 2;  // sectors kept free for reclaiming
+    static const int OPS_PER_STEP = 4; // program ops, about 1ms of flash time
+
+    struct StageEntry
+    {
+        uint16_t key;
+        uint16_t len;
+    };
+
+    struct Job
+    {
+        bool active;
+        bool moving;       // copying a live record out of the tail sector
+        uint16_t key;
+        uint16_t len;
+        uint32_t src;      // staging offset, or flash address of the old record
+        uint32_t addr;     // new record header
+        uint32_t done;     // payload bytes programmed
+        uint8_t stage;     // 0 header, 1 payload, 2 commit word
+        RecordHeader header;
+    };
+
+    static uint32_t Align4(uint32_t n) { return (n + 3) & ~3u; }
+    static uint32_t RecordSize(uint32_t len) { return sizeof(RecordHeader) + Align4(len); }
+    static uint32_t StageSize(uint32_t len) { return sizeof(StageEntry) + Align4(len); }
+
+    static uint32_t Crc(const RecordHeader &h, const uint8_t *data)
+    {
+        // FNV-1a, cheap and good enough to catch torn writes
+        uint32_t c = 2166136261u;
+        const uint8_t meta[8] = {static_cast<uint8_t>(h.key), static_cast<uint8_t>(h.key >> 8),
+                                 static_cast<uint8_t>(h.len), static_cast<uint8_t>(h.len >> 8),
+                                 static_cast<uint8_t>(h.seq), static_cast<uint8_t>(h.seq >> 8),
+                                 static_cast<uint8_t>(h.seq >> 16), static_cast<uint8_t>(h.seq >> 24)};
+        for (int i = 0; i < 8; i++)
+            c = (c ^ meta[i]) * 16777619u;
+        for (uint32_t i = 0; i < h.len; i++)
+            c = (c ^ data[i]) * 16777619u;
+        return c;
+    }
+
+    static bool ValidSector(const SectorHeader *h)
+    {
+        return h->magic == SECTOR_MAGIC && h->check == ~(h->magic ^ h->seq ^ h->erase_count);
+    }
+
+    uint32_t SectorAddr(uint32_t s) const { return base_ + s * SECTOR; }
+    const SectorHeader *SectorAt(uint32_t s) const
+    {
+        return reinterpret_cast<const SectorHeader *>(flash_->Data(SectorAddr(s)));
+    }
+    const RecordHeader *RecordAt(uint32_t addr) const
+    {
+        return reinterpret_cast<const RecordHeader *>(flash_->Data(addr));
+    }
+    uint32_t RingDistance(uint32_t from, uint32_t to) const { return (to + sectors_ - from) % sectors_; }
+
+    bool Blank(uint32_t addr, uint32_t len) const
+    {
+        const uint8_t *p = flash_->Data(addr);
+        for (uint32_t i = 0; i < len; i++)
+            if (p[i] != 0xFF)
+                return false;
+        return true;
+    }
+
+    bool EraseNow(uint32_t s)
+    {
+        if (!flash_->EraseSector(SectorAddr(s)))
+        {
+            errors++;
+            return false;
+        }
+        erase_counts_[s]++;
+        sectors_erased++;
+        return true;
+    }
+
+    /** Stamp a blank sector as the new head. */
+    bool OpenSector(uint32_t s)
+    {
+        SectorHeader h;
+        h.magic = SECTOR_MAGIC;
+        h.seq = ++sector_seq_;
+        h.erase_count = erase_counts_[s];
+        h.check = ~(h.magic ^ h.seq ^ h.erase_count);
+        if (!flash_->Program(SectorAddr(s), reinterpret_cast<const uint8_t *>(&h), sizeof(h)))
+        {
+            errors++;
+            return false;
+        }
+        head_ = s;
+        head_off_ = sizeof(SectorHeader);
+        free_ = sectors_ - 1 - RingDistance(tail_, head_);
+        return true;
+    }
+
+    /**
+     * Walk the records of one sector. With build set, committed records
+     * update the index; otherwise the first live record at or after
+     * gc_off_ is returned through gc_off_ (SECTOR when there are none).
+     * @return offset just past the last record header that was written
+     */
+    uint32_t ScanSector(uint32_t s, bool build)
+    {
+        uint32_t off = build ? sizeof(SectorHeader) : gc_off_;
+        while (off + sizeof(RecordHeader) <= SECTOR)
+        {
+            const uint32_t addr = SectorAddr(s) + off;
+            const RecordHeader *r = RecordAt(addr);
+            if (r->key == 0xFFFF && r->len == 0xFFFF)
+                break; // blank: end of the written part
+            if (r->key >= MAX_KEYS || r->len > MAX_RECORD)
+            {
+                off = SECTOR; // torn header, give up on the rest
+                break;
+            }
+
+            const bool committed =
+                r->commit == COMMITTED && r->crc == Crc(*r, reinterpret_cast<const uint8_t *>(r + 1));
+            if (build && committed)
+            {
+                if (r->seq >= record_seq_)
+                    record_seq_ = r->seq + 1;
+                SetIndex(r->key, r->len ? addr : NONE, r->len);
+            }
+            else if (!build && committed && index_[r->key] == addr)
+            {
+                gc_off_ = off;
+                return off;
+            }
+            off += RecordSize(r->len);
+        }
+        if (!build)
+            gc_off_ = SECTOR;
+        return off < SECTOR ? off : SECTOR;
+    }
+
+    void SetIndex(uint16_t key, uint32_t addr, uint32_t len)
+    {
+        if (index_[key] != NONE)
+            live_bytes_ -= RecordSize(RecordAt(index_[key])->len);
+        index_[key] = addr;
+        if (addr != NONE)
+            live_bytes_ += RecordSize(len);
+    }
+
+    /**
+     * Keep enough room that reclaiming the tail always makes progress. Half
+     * the space covers the worst case of records that only fit one per sector.
+     */
+    bool Reserve(uint32_t size) const
+    {
+        const uint32_t usable = (sectors_ - RESERVE - 1) * (SECTOR - sizeof(SectorHeader)) / 2;
+        return live_bytes_ + staged_bytes_ + size <= usable;
+    }
+
+    bool StageRoom(uint32_t size)
+    {
+        if (stage_read_ == stage_write_)
+            stage_read_ = stage_write_ = 0;
+        return stage_write_ + size <= staging_size_;
+    }
+
+    bool StartJob()
+    {
+        // Reclaim first when the free sectors run low, a staged record could need them
+        if (gc_active_ || free_ < RESERVE)
+            return StartMove();
+        if (stage_read_ == stage_write_)
+            return false;
+
+        StageEntry e;
+        memcpy(&e, staging_ + stage_read_, sizeof(e));
+        return BeginRecord(false, e.key, e.len, stage_read_ + sizeof(StageEntry));
+    }
+
+    /** Next live record of the tail sector, or erase it once there are none. */
+    bool StartMove()
+    {
+        if (!gc_active_)
+        {
+            if (tail_ == head_)
+                return false;
+            gc_active_ = true;
+            gc_off_ = sizeof(SectorHeader);
+        }
+
+        ScanSector(tail_, false);
+        if (gc_off_ < SECTOR)
+        {
+            const uint32_t addr = SectorAddr(tail_) + gc_off_;
+            const RecordHeader *r = RecordAt(addr);
+            gc_off_ += RecordSize(r->len);
+            return BeginRecord(true, r->key, r->len, addr);
+        }
+
+        // Tail holds nothing live any more
+        if (!flash_->StartErase(SectorAddr(tail_)))
+        {
+            errors++;
+            return false;
+        }
+        erasing_ = tail_;
+        return true;
+    }
+
+    /**
+     * Poll the erase of the tail sector started by StartMove().
+     * @return false while the flash is still busy
+     */
+    bool FinishErase()
+    {
+        if (flash_->EraseBusy())
+            return false;
+
+        const uint32_t s = erasing_;
+        erasing_ = NONE;
+        if (!Blank(SectorAddr(s), SECTOR))
+        {
+            // Rescanned and erased again by the next StartMove()
+            errors++;
+            gc_off_ = sizeof(SectorHeader);
+            return true;
+        }
+        erase_counts_[s]++;
+        sectors_erased++;
+        tail_ = (tail_ + 1) % sectors_;
+        free_ = sectors_ - 1 - RingDistance(tail_, head_);
+        gc_active_ = false;
+        return true;
+    }
+
+    bool BeginRecord(bool moving, uint16_t key, uint16_t len, uint32_t src)
+    {
+        const uint32_t size = RecordSize(len);
+        if (head_off_ + size > SECTOR)
+        {
+            if (free_ == 0 || !OpenSector((head_ + 1) % sectors_))
+                return false;
+        }
+
+        job_.active = true;
+        job_.moving = moving;
+        job_.key = key;
+        job_.len = len;
+        job_.src = src;
+        job_.addr = SectorAddr(head_) + head_off_;
+        job_.done = 0;
+        job_.stage = 0;
+        head_off_ += size;
+
+        const uint8_t *payload = moving ? reinterpret_cast<const uint8_t *>(RecordAt(src) + 1)
+                                        : staging_ + src;
+        job_.header.key = key;
+        job_.header.len = len;
+        job_.header.seq = record_seq_++;
+        job_.header.crc = Crc(job_.header, payload);
+        job_.header.commit = 0xFFFFFFFF;
+        return true;
+    }
+
+    /** Program the next piece of the current job. */
+    bool RunJob()
+    {
+        Job &j = job_;
+        bool ok = true;
+
+        if (j.stage == 0)
+        {
+            ok = flash_->Program(j.addr, reinterpret_cast<const uint8_t *>(&j.header), sizeof(RecordHeader));
+            if (ok)
+                j.stage = j.len ? 1 : 2;
+        }
+        else if (j.stage == 1)
+        {
+            // Up to the next page boundary; moved records go through RAM because
+            // the flash is not memory mapped while it is being programmed
+            const uint32_t dst = j.addr + sizeof(RecordHeader) + j.done;
+            uint32_t n = PAGE - (dst % PAGE);
+            if (n > j.len - j.done)
+                n = j.len - j.done;
+            if (j.moving)
+            {
+                memcpy(bounce_, reinterpret_cast<const uint8_t *>(RecordAt(j.src) + 1) + j.done, n);
+                ok = flash_->Program(dst, bounce_, n);
+            }
+            else
+            {
+                ok = flash_->Program(dst, staging_ + j.src + j.done, n);
+            }
+            if (ok)
+            {
+                j.done += n;
+                if (j.done == j.len)
+                    j.stage = 2;
+            }
+        }
+        else
+        {
+            const uint32_t commit = COMMITTED;
+            ok = flash_->Program(j.addr + offsetof(RecordHeader, commit),
+                                 reinterpret_cast<const uint8_t *>(&commit), sizeof(commit));
+            if (ok)
+                Complete();
+        }
+
+        if (!ok)
+        {
+            // The torn record is skipped on mount; the next attempt goes after it
+            errors++;
+            if (j.moving)
+                gc_off_ = j.src - SectorAddr(tail_);
+            j.active = false;
+            return false;
+        }
+        return true;
+    }
+
+    void Complete()
+    {
+        Job &j = job_;
+        j.active = false;
+        records_written++;
+        if (j.moving)
+        {
+            records_moved++;
+            if (index_[j.key] == j.src)
+                SetIndex(j.key, j.addr, j.len);
+            return;
+        }
+        SetIndex(j.key, j.len ? j.addr : NONE, j.len);
+        stage_read_ += StageSize(j.len);
+        staged_bytes_ -= RecordSize(j.len);
+    }
+
+    KaliFlash *flash_ = nullptr;
+    uint32_t base_ = 0;
+    uint32_t sectors_ = 0;
+
+    uint32_t index_[MAX_KEYS];
+    uint32_t erase_counts_[MAX_SECTORS];
+    uint32_t live_bytes_ = 0;
+    uint32_t staged_bytes_ = 0;
+    uint32_t record_seq_ = 1;
+    uint32_t sector_seq_ = 0;
+
+    uint32_t head_ = 0;
+    uint32_t head_off_ = 0;
+    uint32_t tail_ = 0;
+    uint32_t free_ = 0;
+
+    uint8_t *staging_ = nullptr;
+    uint32_t staging_size_ = 0;
+    uint32_t stage_read_ = 0;
+    uint32_t stage_write_ = 0;
+
+    Job job_;
+    bool gc_active_ = false;
+    uint32_t gc_off_ = 0;
+    uint32_t erasing_ = NONE; // sector with an erase in flight
+    uint8_t bounce_[PAGE];
+};
+
+#endif
@@ -0,0 +1,194 @@
+#pragma once
+#ifndef KALI_RECORDER_H
+#define KALI_RECORDER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Streams the output (and optionally the dry input) to a WAV file
+ *
+ * The audio callback Push()es every block, interleaved, into a float FIFO
+ * in SDRAM and returns. Service() in the main loop moves the FIFO into the
+ * writer's transfer buffer and lets it write one full transfer at a time,
+ * so the card only ever sees large writes (the 44 byte WAV header leaves
+ * each transfer a sector off alignment, so FatFs issues it as one long
+ * write plus one single sector). If the card falls behind far enough to
+ * fill the FIFO, whole blocks are dropped and counted in overruns; the
+ * audio callback never waits on the card.
+ *
+ * Writer is daisy::WavWriter on the hardware. Nothing here touches FatFs
+ * directly, so any class with the same Init/OpenFile/Sample/Write/SaveFile/
+ * IsRecording calls runs the same FIFO and chunking. The host tests run
+ * WavWriter itself on FatFs over a disk image.
+ */
+template <typename Writer>
+class KaliRecorder
+{
+public:
+    static const int MAX_CHANNELS = 4;
+
+    enum State
+    {
+        IDLE,
+        RECORDING,
+        STOPPING,
+    };
+
+    /**
+     * @param fifo storage for the FIFO, fifo_size floats, a power of two
+     * @param transfer_bytes the Writer's transfer size
+     */
+    void Init(float *fifo, size_t fifo_size, float samplerate, size_t transfer_bytes)
+    {
+        fifo_ = fifo;
+        mask_ = fifo_size - 1;
+        samplerate_ = samplerate;
+        transfer_bytes_ = transfer_bytes;
+        state_ = IDLE;
+        armed_ = false;
+    }
+
+    /**
+     * @brief Main loop: open a file and start taking blocks
+     * @param with_input record the dry input as channels 3 and 4
+     * @return false if already recording or the file could not be created
+     */
+    bool Start(const char *name, bool with_input)
+    {
+        if (state_ != IDLE)
+            return false;
+        channels_ = with_input ? 4 : 2;
+        typename Writer::Config cfg;
+        cfg.samplerate = samplerate_;
+        cfg.channels = channels_;
+        cfg.bitspersample = 16;
+        writer_.Init(cfg);
+        writer_.OpenFile(name);
+        if (!writer_.IsRecording())
+            return false;
+
+        // 16 bit samples: the writer flushes every transfer_bytes of them
+        flush_frames_ = transfer_bytes_ / (2 * channels_);
+        pending_ = 0;
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+        overruns = 0;
+        frames_written = 0;
+        fifo_peak = 0;
+        state_ = RECORDING;
+        armed_ = true;
+        return true;
+    }
+
+    /** Main loop: stop taking blocks; Service() finishes the file. */
+    void Stop()
+    {
+        armed_ = false;
+        if (state_ == RECORDING)
+            state_ = STOPPING;
+    }
+
+    /** Audio callback: queue one block, or drop it whole if there is no room. */
+    void Push(const float *const *in, const float *const *out, size_t size)
+    {
+        if (!armed_)
+            return;
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        const uint32_t used = head - tail_.load(std::memory_order_acquire);
+        const uint32_t need = static_cast<uint32_t>(size * channels_);
+        if (used + need > mask_ + 1)
+        {
+            overruns++;
+            return;
+        }
+        uint32_t w = head;
+        for (size_t i = 0; i < size; i++)
+        {
+            fifo_[w++ & mask_] = out[0][i];
+            fifo_[w++ & mask_] = out[1][i];
+            if (channels_ == 4)
+            {
+                fifo_[w++ & mask_] = in[0][i];
+                fifo_[w++ & mask_] = in[1][i];
+            }
+        }
+        if (used + need > fifo_peak)
+            fifo_peak = used + need;
+        head_.store(w, std::memory_order_release);
+    }
+
+    /**
+     * @brief Main loop: feed the writer, at most one card write per call
+     *
+     * Once stopped, the last transfer is padded with silence so the header
+     * WavWriter writes matches what is on the card.
+     */
+    void Service()
+    {
+        if (state_ == IDLE)
+            return;
+
+        const uint32_t head = head_.load(std::memory_order_acquire);
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        float frame[MAX_CHANNELS];
+        while (head - tail >= static_cast<uint32_t>(channels_) && pending_ < flush_frames_)
+        {
+            for (int c = 0; c < channels_; c++)
+                frame[c] = fifo_[tail++ & mask_];
+            writer_.Sample(frame);
+            pending_++;
+            frames_written++;
+        }
+        tail_.store(tail, std::memory_order_release);
+
+        if (state_ == STOPPING && head == tail)
+        {
+            for (int c = 0; c < channels_; c++)
+                frame[c] = 0.f;
+            while (pending_ > 0 && pending_ < flush_frames_)
+            {
+                writer_.Sample(frame);
+                pending_++;
+            }
+        }
+
+        if (pending_ >= flush_frames_)
+        {
+            writer_.Write();
+            pending_ = 0;
+            return;
+        }
+
+        if (state_ == STOPPING && head == tail)
+        {
+            writer_.SaveFile();
+            state_ = IDLE;
+        }
+    }
+
+    State GetState() const { return state_; }
+    bool Recording() const { return state_ != IDLE; }
+    float Seconds() const { return frames_written / samplerate_; }
+
+    uint32_t overruns = 0;       // blocks dropped because the FIFO was full
+    uint32_t frames_written = 0; // frames handed to the writer
+    uint32_t fifo_peak = 0;      // most floats ever waiting in the FIFO
+
+private:
+    Writer writer_;
+    float *fifo_ = nullptr;
+    uint32_t mask_ = 0;
+    std::atomic<uint32_t> head_{0};
+    std::atomic<uint32_t> tail_{0};
+    volatile bool armed_ = false;
+    volatile State state_ = IDLE;
+    int channels_ = 2;
+    float samplerate_ = 48000.f;
+    size_t transfer_bytes_ = 0;
+    size_t flush_frames_ = 0;
+    size_t pending_ = 0; // frames in the writer's half buffer
+};
+
+#endif
@@ -0,0 +1,245 @@
+#pragma once
+#ifndef KALI_SAMPLE_LOADER_H
+#define KALI_SAMPLE_LOADER_H
+
+#include "KaliFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief Streams a WAV file into the delay lines, one chunk per Step()
+ *
+ * The file is laid out behind each line's write head as if it had just
+ * been played in: the end of the file is the most recent past, its start
+ * lies max_frames (or the file length) back. With the delay frozen the
+ * material then loops like anything recorded live.
+ *
+ * Step() reads CHUNK bytes at most, so the main loop keeps servicing the
+ * OLED and MIDI between chunks. The audio callback keeps running and may
+ * read the part already loaded. 16, 24 and 32 bit PCM and 32 bit float
+ * are understood; mono feeds every line, otherwise the first two channels
+ * go to the even and odd lines. Files at another rate are converted with
+ * linear interpolation on the way in.
+ */
+class KaliSampleLoader
+{
+public:
+    static const size_t CHUNK = 8192;
+    static const int MAX_LINES = 4;
+
+    enum Status
+    {
+        IDLE,
+        LOADING,
+        DONE,
+        FAILED,
+    };
+
+    /**
+     * @brief Open a file and start loading it
+     * @param lines delay line storage, line_size floats each
+     * @param bases each line's write position now (KaliDelayLine::GetWritePtr())
+     * @param max_frames most frames to place behind the write heads
+     * @param samplerate rate of the delay lines
+     * @return false if the file is missing or not a WAV this understands
+     */
+    bool Start(KaliFile *file, const char *path, float *const *lines, const size_t *bases, int num_lines,
+               size_t line_size, size_t max_frames, float samplerate)
+    {
+        file_ = file;
+        status_ = FAILED;
+        if (num_lines < 1 || num_lines > MAX_LINES || !file_->Open(path, false))
+            return false;
+        if (!ParseHeader())
+        {
+            file_->Close();
+            return false;
+        }
+
+        num_lines_ = num_lines;
+        line_size_ = line_size;
+        for (int c = 0; c < num_lines; c++)
+        {
+            lines_[c] = lines[c];
+            bases_[c] = bases[c];
+        }
+
+        step_ = static_cast<float>(rate_) / samplerate;
+        const size_t in_frames = data_bytes_ / frame_bytes_;
+        length_ = static_cast<size_t>(in_frames / step_);
+        if (length_ > max_frames)
+            length_ = max_frames;
+        if (length_ >= line_size)
+            length_ = line_size - 1;
+        written_ = 0;
+        phase_ = 0.f;
+        prev_[0] = prev_[1] = 0.f;
+        first_ = true;
+        status_ = length_ > 0 ? LOADING : DONE;
+        if (status_ != LOADING)
+            file_->Close();
+        return true;
+    }
+
+    /** Main loop: load one chunk. Returns true while there is more to do. */
+    bool Step()
+    {
+        if (status_ != LOADING)
+            return false;
+
+        size_t want = (CHUNK / frame_bytes_) * frame_bytes_;
+        if (want > data_bytes_)
+            want = data_bytes_;
+        const size_t got = want ? file_->Read(buf_, want) : 0;
+        data_bytes_ -= got;
+
+        for (size_t off = 0; off + frame_bytes_ <= got && written_ < length_; off += frame_bytes_)
+        {
+            float frame[2];
+            frame[0] = Decode(buf_ + off);
+            frame[1] = channels_ > 1 ? Decode(buf_ + off + sample_bytes_) : frame[0];
+            Input(frame);
+        }
+
+        if (written_ >= length_ || got < want || data_bytes_ == 0)
+        {
+            file_->Close();
+            status_ = written_ > 0 ? DONE : FAILED;
+            return false;
+        }
+        return true;
+    }
+
+    void Cancel()
+    {
+        if (status_ == LOADING)
+            file_->Close();
+        status_ = IDLE;
+    }
+
+    Status GetStatus() const { return status_; }
+    float Progress() const { return length_ ? static_cast<float>(written_) / length_ : 0.f; }
+    size_t Frames() const { return written_; }
+
+private:
+    static uint16_t U16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+    static uint32_t U32(const uint8_t *p) { return U16(p) | (static_cast<uint32_t>(U16(p + 2)) << 16); }
+
+    bool ParseHeader()
+    {
+        const uint32_t size = file_->Size();
+        uint8_t h[12];
+        if (file_->Read(h, 12) != 12 || memcmp(h, "RIFF", 4) != 0 || memcmp(h + 8, "WAVE", 4) != 0)
+            return false;
+
+        bool have_fmt = false;
+        uint32_t pos = 12;
+        while (pos + 8 <= size)
+        {
+            if (!file_->Seek(pos) || file_->Read(h, 8) != 8)
+                return false;
+            const uint32_t len = U32(h + 4);
+            if (memcmp(h, "fmt ", 4) == 0)
+            {
+                uint8_t f[40];
+                const size_t n = len < sizeof(f) ? len : sizeof(f);
+                if (n < 16 || file_->Read(f, n) != n)
+                    return false;
+                format_ = U16(f);
+                if (format_ == 0xFFFE && n >= 26)
+                    format_ = U16(f + 24); // WAVE_FORMAT_EXTENSIBLE: sub format GUID starts with the tag
+                channels_ = U16(f + 2);
+                rate_ = U32(f + 4);
+                bits_ = U16(f + 14);
+                have_fmt = true;
+            }
+            else if (memcmp(h, "data", 4) == 0)
+            {
+                if (!have_fmt || channels_ == 0 || rate_ == 0)
+                    return false;
+                const bool pcm = format_ == 1 && (bits_ == 16 || bits_ == 24 || bits_ == 32);
+                const bool flt = format_ == 3 && bits_ == 32;
+                if (!pcm && !flt)
+                    return false;
+                sample_bytes_ = bits_ / 8;
+                frame_bytes_ = sample_bytes_ * channels_;
+                data_bytes_ = len;
+                if (data_bytes_ > size - (pos + 8))
+                    data_bytes_ = size - (pos + 8); // writer never patched the header
+                return frame_bytes_ <= CHUNK;
+            }
+            pos += 8 + len + (len & 1);
+        }
+        return false;
+    }
+
+    float Decode(const uint8_t *p) const
+    {
+        switch (bits_)
+        {
+        case 16:
+            return static_cast<int16_t>(U16(p)) * (1.f / 32768.f);
+        case 24:
+            return static_cast<int32_t>((p[0] << 8) | (p[1] << 16) | (static_cast<uint32_t>(p[2]) << 24)) *
+                   (1.f / 2147483648.f);
+        default:
+            if (format_ == 3)
+            {
+                float f;
+                memcpy(&f, p, sizeof(f));
+                return f;
+            }
+            return static_cast<int32_t>(U32(p)) * (1.f / 2147483648.f);
+        }
+    }
+
+    /** One file frame in, as many line frames out as the rate ratio gives. */
+    void Input(const float *frame)
+    {
+        if (first_)
+        {
+            prev_[0] = frame[0];
+            prev_[1] = frame[1];
+            first_ = false;
+        }
+        while (phase_ < 1.f && written_ < length_)
+        {
+            const float l = prev_[0] + (frame[0] - prev_[0]) * phase_;
+            const float r = prev_[1] + (frame[1] - prev_[1]) * phase_;
+            const size_t behind = length_ - written_;
+            for (int c = 0; c < num_lines_; c++)
+                lines_[c][(bases_[c] + behind) % line_size_] = (c & 1) ? r : l;
+            written_++;
+            phase_ += step_;
+        }
+        phase_ -= 1.f;
+        prev_[0] = frame[0];
+        prev_[1] = frame[1];
+    }
+
+    alignas(32) uint8_t buf_[CHUNK]; // SDMMC DMA and cache maintenance want it aligned
+    KaliFile *file_ = nullptr;
+    float *lines_[MAX_LINES] = {nullptr};
+    size_t bases_[MAX_LINES] = {0};
+    int num_lines_ = 0;
+    size_t line_size_ = 0;
+
+    uint16_t format_ = 0;
+    uint16_t channels_ = 0;
+    uint32_t rate_ = 0;
+    uint16_t bits_ = 0;
+    size_t sample_bytes_ = 0;
+    size_t frame_bytes_ = 0;
+    uint32_t data_bytes_ = 0; // still to read
+
+    float step_ = 1.f;  // file frames per line frame
+    float phase_ = 0.f; // position between prev_ and the next file frame
+    float prev_[2];
+    bool first_ = true;
+    size_t length_ = 0;
+    size_t written_ = 0;
+    Status status_ = IDLE;
+};
+
+#endif
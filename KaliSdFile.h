@@ -0,0 +1,57 @@
+#pragma once
+#ifndef KALI_SD_FILE_H
+#define KALI_SD_FILE_H
+
+#include "daisy.h"
+#include "KaliFile.h"
+
+/**
+ * @brief KaliFile on a FatFs volume (the SD card)
+ *
+ * Main loop only. Buffers handed to Read() / Write() must be reachable by
+ * the SDMMC DMA, so not in DTCM.
+ */
+class KaliSdFile : public KaliFile
+{
+public:
+    bool Open(const char *path, bool write) override
+    {
+        Close();
+        const BYTE mode = write ? (FA_WRITE | FA_CREATE_ALWAYS) : FA_READ;
+        open_ = f_open(&fil_, path, mode) == FR_OK;
+        return open_;
+    }
+
+    void Close() override
+    {
+        if (open_)
+            f_close(&fil_);
+        open_ = false;
+    }
+
+    size_t Read(void *dst, size_t len) override
+    {
+        UINT got = 0;
+        if (!open_ || f_read(&fil_, dst, len, &got) != FR_OK)
+            return 0;
+        return got;
+    }
+
+    size_t Write(const void *src, size_t len) override
+    {
+        UINT put = 0;
+        if (!open_ || f_write(&fil_, src, len, &put) != FR_OK)
+            return 0;
+        return put;
+    }
+
+    bool Seek(uint32_t pos) override { return open_ && f_lseek(&fil_, pos) == FR_OK; }
+
+    uint32_t Size() override { return open_ ? f_size(&fil_) : 0; }
+
+private:
+    FIL fil_;
+    bool open_ = false;
+};
+
+#endif
@@ -0,0 +1,469 @@
+#pragma once
+#ifndef KALI_SNAPSHOT_H
+#define KALI_SNAPSHOT_H
+
+#include "KaliRecordStore.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief Saves the frozen delay lines to flash and plays them back in
+ *
+ * Only the reachable part of each line (the working delay range behind the
+ * write head) is kept, as 4 bit IMA ADPCM in independent 256 sample
+ * blocks, a quarter of 16 bit PCM. A line holding exactly the same samples
+ * as the line two below it (the ping-pong modes write the same thing to
+ * both pairs) is stored once and marked as a mirror.
+ *
+ * Saving runs in two passes, both from the main loop a little per Step():
+ * encoding into a RAM staging area, which needs the lines to stay frozen
+ * and gives up if they thaw, then erasing and programming the flash a
+ * sector at a time. Erases are started and polled, never waited for.
+ * The header goes last, so an interrupted save leaves no snapshot rather
+ * than a broken one. Restoring decodes straight from the memory mapped
+ * flash, a few thousand samples per Step().
+ *
+ * The flash is shared with the record store, so Step() does nothing while
+ * an erase is in flight, and the header is read once at Init() and kept
+ * in RAM so Valid() never touches the flash.
+ */
+class KaliSnapshot
+{
+public:
+    static const uint32_t MAGIC = 0x504E534B; // "KSNP"
+    static const uint32_t VERSION = 1;
+    static const uint32_t COMMITTED = 0;
+    static const int MAX_LINES = 4;
+    static const uint32_t BLOCK_SAMPLES = 256;
+    static const uint32_t BLOCK_BYTES = 4 + BLOCK_SAMPLES / 2; // first sample, step index, 255 nibbles
+    static const uint32_t BLOCKS_PER_STEP = 128;
+    static const uint32_t PAGES_PER_STEP = 16;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t frames; // per line
+        uint32_t lines;
+        uint32_t mirrors; // bit per line copied from the line two below
+        uint32_t samplerate;
+        uint32_t commit; // programmed to COMMITTED last
+    };
+
+    enum State
+    {
+        IDLE,
+        ENCODING,
+        WRITING,
+        RESTORING,
+    };
+
+    /**
+     * @param base flash offset, sector aligned
+     * @param size bytes of flash reserved for the snapshot
+     * @param staging RAM for one encoded snapshot, the same size is plenty
+     */
+    void Init(KaliFlash *flash, uint32_t base, uint32_t size, uint8_t *staging, uint32_t staging_size)
+    {
+        flash_ = flash;
+        base_ = base;
+        size_ = size;
+        staging_ = staging;
+        staging_size_ = staging_size;
+        state_ = IDLE;
+        stored_ = *reinterpret_cast<const Header *>(flash_->Data(base_));
+    }
+
+    /** True if a complete snapshot is on flash. */
+    bool Valid() const
+    {
+        return stored_.magic == MAGIC && stored_.version == VERSION && stored_.commit == COMMITTED &&
+               stored_.lines > 0 && stored_.lines <= MAX_LINES;
+    }
+
+    /**
+     * @brief Start saving frames samples behind each write head
+     * @return false if busy or the snapshot would not fit; the latter (a long
+     * external sync range can outgrow the staging area) counts as a failure
+     */
+    bool StartSave(float *const *lines, const size_t *bases, int num_lines, size_t line_size, size_t frames,
+                   uint32_t samplerate)
+    {
+        if (state_ != IDLE || num_lines < 1 || num_lines > MAX_LINES)
+            return false;
+        const uint32_t blocks = (frames + BLOCK_SAMPLES - 1) / BLOCK_SAMPLES;
+        line_bytes_ = blocks * BLOCK_BYTES;
+        if (blocks * BLOCK_SAMPLES >= line_size || line_bytes_ * num_lines > staging_size_ ||
+            PAGE + line_bytes_ * num_lines > size_)
+        {
+            failures++;
+            return false;
+        }
+
+        SetLines(lines, bases, num_lines, line_size);
+        header_.magic = MAGIC;
+        header_.version = VERSION;
+        header_.frames = blocks * BLOCK_SAMPLES;
+        header_.lines = num_lines;
+        header_.mirrors = 0;
+        header_.samplerate = samplerate;
+        header_.commit = COMMITTED;
+        line_ = 0;
+        block_ = 0;
+        used_ = 0;
+        index_ = 0; // the same lines always encode the same way
+        mirror_ = num_lines > 2;
+        state_ = ENCODING;
+        return true;
+    }
+
+    /**
+     * @brief Start playing the stored snapshot into the lines
+     *
+     * Lines beyond the ones stored are left alone.
+     */
+    bool StartRestore(float *const *lines, const size_t *bases, int num_lines, size_t line_size)
+    {
+        if (state_ != IDLE || !Valid())
+            return false;
+        header_ = stored_;
+        if (header_.frames >= line_size)
+            return false;
+        SetLines(lines, bases, num_lines < static_cast<int>(stored_.lines) ? num_lines : stored_.lines, line_size);
+        line_bytes_ = header_.frames / BLOCK_SAMPLES * BLOCK_BYTES;
+        line_ = 0;
+        block_ = 0;
+        state_ = RESTORING;
+        return true;
+    }
+
+    /**
+     * @brief Main loop: a slice of whatever is in progress
+     * @param frozen whether the lines are still frozen; encoding stops if not
+     */
+    void Step(bool frozen)
+    {
+        switch (state_)
+        {
+        case ENCODING:
+            if (!frozen)
+            {
+                failures++;
+                state_ = IDLE;
+                return;
+            }
+            EncodeStep();
+            break;
+        case WRITING:
+            WriteStep();
+            break;
+        case RESTORING:
+            RestoreStep();
+            break;
+        default:
+            break;
+        }
+    }
+
+    void Cancel() { state_ = IDLE; }
+
+    State GetState() const { return state_; }
+
+    float Progress() const
+    {
+        switch (state_)
+        {
+        case ENCODING:
+        case RESTORING:
+            return static_cast<float>(line_ * Blocks() + block_) / (num_lines_ * Blocks());
+        case WRITING:
+            return static_cast<float>(write_pos_) / write_end_;
+        default:
+            return 0.f;
+        }
+    }
+
+    uint32_t saves = 0;    // snapshots completed
+    uint32_t failures = 0; // saves abandoned: too long, thawed, or the flash refused
+
+private:
+    static const uint32_t SECTOR = KaliFlash::SECTOR_SIZE;
+    static const uint32_t PAGE = KaliFlash::PAGE_SIZE;
+
+    uint32_t Blocks() const { return header_.frames / BLOCK_SAMPLES; }
+
+    void SetLines(float *const *lines, const size_t *bases, int num_lines, size_t line_size)
+    {
+        num_lines_ = num_lines;
+        line_size_ = line_size;
+        for (int i = 0; i < num_lines; i++)
+        {
+            lines_[i] = lines[i];
+            bases_[i] = bases[i];
+        }
+    }
+
+    // Sample d behind the write head (d = 1 is the newest)
+    float &At(int line, uint32_t d) { return lines_[line][(bases_[line] + d) % line_size_]; }
+
+    void EncodeStep()
+    {
+        for (uint32_t n = 0; n < BLOCKS_PER_STEP; n++)
+        {
+            const uint32_t first = block_ * BLOCK_SAMPLES + 1;
+            if (mirror_ && line_ >= 2)
+            {
+                for (uint32_t i = 0; i < BLOCK_SAMPLES && mirror_; i++)
+                    mirror_ = At(line_, first + i) == At(line_ - 2, first + i);
+            }
+            EncodeBlock(line_, first, staging_ + used_ + block_ * BLOCK_BYTES);
+
+            if (++block_ < Blocks())
+                continue;
+
+            // End of a line: keep it, or drop it again as a mirror
+            if (line_ >= 2 && mirror_)
+                header_.mirrors |= 1u << line_;
+            else
+                used_ += line_bytes_;
+            block_ = 0;
+            mirror_ = true;
+            if (++line_ == static_cast<uint32_t>(num_lines_))
+            {
+                write_pos_ = 0;
+                write_end_ = PAGE + used_;
+                erased_ = 0;
+                erasing_ = false;
+                state_ = WRITING;
+                return;
+            }
+        }
+    }
+
+    void WriteStep()
+    {
+        if (flash_->EraseBusy())
+            return;
+
+        // Erase ahead of the programming, one sector at a time, started
+        // here and checked once the flash reports it done
+        if (erasing_)
+        {
+            erasing_ = false;
+            if (!Blank(base_ + erased_))
+            {
+                failures++;
+                state_ = IDLE;
+                return;
+            }
+            erased_ += SECTOR;
+            return;
+        }
+        if (write_pos_ >= erased_)
+        {
+            if (erased_ == 0)
+                stored_.magic = 0; // the header sector goes first
+            if (!flash_->StartErase(base_ + erased_))
+            {
+                failures++;
+                state_ = IDLE;
+                return;
+            }
+            erasing_ = true;
+            return;
+        }
+
+        if (write_pos_ == 0)
+            write_pos_ = PAGE; // header page is programmed last
+
+        for (uint32_t n = 0; n < PAGES_PER_STEP && write_pos_ < write_end_ && write_pos_ < erased_; n++)
+        {
+            const uint32_t len = write_end_ - write_pos_ < PAGE ? write_end_ - write_pos_ : PAGE;
+            if (!flash_->Program(base_ + write_pos_, staging_ + write_pos_ - PAGE, len))
+            {
+                failures++;
+                state_ = IDLE;
+                return;
+            }
+            write_pos_ += len;
+        }
+
+        if (write_pos_ >= write_end_)
+        {
+            if (flash_->Program(base_, reinterpret_cast<const uint8_t *>(&header_), sizeof(header_)))
+            {
+                stored_ = header_;
+                saves++;
+            }
+            else
+                failures++;
+            state_ = IDLE;
+        }
+    }
+
+    bool Blank(uint32_t addr)
+    {
+        const uint8_t *p = flash_->Data(addr);
+        for (uint32_t i = 0; i < SECTOR; i++)
+            if (p[i] != 0xFF)
+                return false;
+        return true;
+    }
+
+    void RestoreStep()
+    {
+        if (flash_->EraseBusy())
+            return;
+
+        // Where each line's blocks live: mirrors read their partner's
+        int source = line_;
+        while (source >= 2 && (header_.mirrors & (1u << source)))
+            source -= 2;
+        uint32_t stored = 0;
+        for (int i = 0; i < source; i++)
+            if (!(header_.mirrors & (1u << i)))
+                stored++;
+        const uint8_t *data = flash_->Data(base_ + PAGE + stored * line_bytes_);
+
+        for (uint32_t n = 0; n < BLOCKS_PER_STEP && block_ < Blocks(); n++, block_++)
+            DecodeBlock(line_, block_ * BLOCK_SAMPLES + 1, data + block_ * BLOCK_BYTES);
+
+        if (block_ >= Blocks())
+        {
+            block_ = 0;
+            if (++line_ == static_cast<uint32_t>(num_lines_))
+                state_ = IDLE;
+        }
+    }
+
+    static int16_t ToPcm(float x)
+    {
+        x *= 32767.f;
+        x = x > 32767.f ? 32767.f : (x < -32768.f ? -32768.f : x);
+        return static_cast<int16_t>(x);
+    }
+
+    void EncodeBlock(int line, uint32_t first, uint8_t *out)
+    {
+        int predictor = ToPcm(At(line, first));
+        int index = index_;
+        out[0] = static_cast<uint8_t>(predictor);
+        out[1] = static_cast<uint8_t>(predictor >> 8);
+        out[2] = static_cast<uint8_t>(index);
+        out[3] = 0;
+        uint8_t *nibbles = out + 4;
+        for (uint32_t i = 1; i < BLOCK_SAMPLES; i++)
+        {
+            const int step = StepSize(index);
+            int diff = ToPcm(At(line, first + i)) - predictor;
+            int code = 0;
+            if (diff < 0)
+            {
+                code = 8;
+                diff = -diff;
+            }
+            int delta = step >> 3;
+            if (diff >= step)
+            {
+                code |= 4;
+                diff -= step;
+                delta += step;
+            }
+            if (diff >= step >> 1)
+            {
+                code |= 2;
+                diff -= step >> 1;
+                delta += step >> 1;
+            }
+            if (diff >= step >> 2)
+            {
+                code |= 1;
+                delta += step >> 2;
+            }
+            predictor += (code & 8) ? -delta : delta;
+            predictor = predictor > 32767 ? 32767 : (predictor < -32768 ? -32768 : predictor);
+            index += IndexStep(code);
+            index = index < 0 ? 0 : (index > 88 ? 88 : index);
+
+            const uint32_t k = i - 1;
+            if (k & 1)
+                nibbles[k >> 1] |= code << 4;
+            else
+                nibbles[k >> 1] = code;
+        }
+        nibbles[(BLOCK_SAMPLES - 1) >> 1] &= 0x0F;
+        index_ = index; // the next block starts from a step size that suits the material
+    }
+
+    void DecodeBlock(int line, uint32_t first, const uint8_t *in)
+    {
+        int predictor = static_cast<int16_t>(in[0] | (in[1] << 8));
+        int index = in[2] > 88 ? 88 : in[2];
+        const uint8_t *nibbles = in + 4;
+        const float scale = 1.f / 32767.f;
+        At(line, first) = predictor * scale;
+        for (uint32_t i = 1; i < BLOCK_SAMPLES; i++)
+        {
+            const uint32_t k = i - 1;
+            const int code = (k & 1) ? nibbles[k >> 1] >> 4 : nibbles[k >> 1] & 0x0F;
+            const int step = StepSize(index);
+            int delta = step >> 3;
+            if (code & 4)
+                delta += step;
+            if (code & 2)
+                delta += step >> 1;
+            if (code & 1)
+                delta += step >> 2;
+            predictor += (code & 8) ? -delta : delta;
+            predictor = predictor > 32767 ? 32767 : (predictor < -32768 ? -32768 : predictor);
+            index += IndexStep(code);
+            index = index < 0 ? 0 : (index > 88 ? 88 : index);
+            At(line, first + i) = predictor * scale;
+        }
+    }
+
+    static int IndexStep(int code)
+    {
+        static const int8_t table[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+        return table[code & 7];
+    }
+
+    static int StepSize(int index)
+    {
+        static const int16_t table[89] = {
+            7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88,
+            97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658,
+            724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660,
+            4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818,
+            18500, 20350, 22385, 24623, 27086, 29794, 32767};
+        return table[index];
+    }
+
+    KaliFlash *flash_ = nullptr;
+    uint32_t base_ = 0;
+    uint32_t size_ = 0;
+    uint8_t *staging_ = nullptr;
+    uint32_t staging_size_ = 0;
+
+    float *lines_[MAX_LINES] = {nullptr};
+    size_t bases_[MAX_LINES] = {0};
+    int num_lines_ = 0;
+    size_t line_size_ = 0;
+
+    Header header_;
+    Header stored_; // the one on flash, as of Init() or the last save
+    State state_ = IDLE;
+    uint32_t line_bytes_ = 0; // encoded size of one line
+    uint32_t line_ = 0;
+    uint32_t block_ = 0;
+    uint32_t used_ = 0; // staging bytes kept
+    bool mirror_ = false;
+    int index_ = 0; // ADPCM step index carried between blocks
+    uint32_t write_pos_ = 0;
+    uint32_t write_end_ = 0;
+    uint32_t erased_ = 0;
+    bool erasing_ = false; // the sector at erased_ is being erased
+};
+
+#endif
@@ -0,0 +1,262 @@
+#pragma once
+#ifndef KALI_SPECTRUM_H
+#define KALI_SPECTRUM_H
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Spectrum and peak/RMS meters of the output, for the OLED
+ *
+ * The audio callback Push()es each block: the stereo output is summed,
+ * decimated by two into a small ring, and folded into per-channel peak and
+ * sum of squares. It never waits and allocates nothing.
+ *
+ * The main loop calls Analyze() once per display frame: Hann window over
+ * the newest SIZE samples, a real FFT (done as a SIZE/2 point complex one),
+ * then the bins are grouped into BANDS log spaced bands in dB with a slow
+ * fall and a peak hold. At 24 kHz a frame of 800 new samples arrives every
+ * 33 ms, so the window is always fresh. The whole thing is a few hundred
+ * microseconds, well inside a frame.
+ *
+ * Meter readings are handed over by a flag: the main loop raises it once it
+ * has read the last set, and the next block publishes the levels since
+ * then and restarts the sums.
+ */
+class KaliSpectrum
+{
+public:
+    static const int SIZE = 512;
+    static const int HALF = SIZE / 2;
+    static const int DECIMATE = 2;
+    static const int RING = 1024; // a power of two, at least SIZE plus a few blocks
+    static const int BANDS = 26;
+    static const int NUM_CHANNELS = 2;
+    static const int PEAK_HOLD = 20; // display frames
+
+    void Init(float samplerate, float floor_db = -66.f)
+    {
+        rate_ = samplerate / DECIMATE;
+        floor_db_ = floor_db;
+        const float pi = 3.14159265358979f;
+        for (int n = 0; n < SIZE; n++)
+            window_[n] = 0.5f - 0.5f * cosf(2.f * pi * n / SIZE);
+        for (int k = 0; k < HALF; k++)
+        {
+            cos_[k] = cosf(2.f * pi * k / SIZE);
+            sin_[k] = sinf(2.f * pi * k / SIZE);
+            int r = 0;
+            for (int b = 1, v = k; b < HALF; b <<= 1, v >>= 1)
+                r = (r << 1) | (v & 1);
+            rev_[k] = static_cast<uint16_t>(r);
+        }
+
+        // Log spaced from the first bin up, at least one bin per band
+        int edge = 1;
+        for (int b = 0; b <= BANDS; b++)
+        {
+            int target = static_cast<int>(powf(static_cast<float>(HALF), static_cast<float>(b) / BANDS) + 0.5f);
+            if (b > 0 && target <= edge)
+                target = edge + 1;
+            edge = target < HALF ? target : HALF;
+            edges_[b] = static_cast<uint16_t>(edge);
+        }
+
+        for (int b = 0; b < BANDS; b++)
+        {
+            level_[b] = peak_[b] = 0.f;
+            hold_[b] = 0;
+        }
+        for (int c = 0; c < NUM_CHANNELS; c++)
+        {
+            acc_peak_[c] = acc_sq_[c] = 0.f;
+            meter_peak_[c] = meter_rms_[c] = 0.f;
+        }
+        acc_count_ = 0;
+        half_ = 0.f;
+        odd_ = false;
+        head_.store(0, std::memory_order_relaxed);
+        take_.store(true, std::memory_order_relaxed);
+    }
+
+    /** Audio callback: queue one block of the output. */
+    void Push(const float *const *out, size_t size)
+    {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < size; i++)
+        {
+            const float l = out[0][i], r = out[1][i];
+            const float al = fabsf(l), ar = fabsf(r);
+            acc_peak_[0] = al > acc_peak_[0] ? al : acc_peak_[0];
+            acc_peak_[1] = ar > acc_peak_[1] ? ar : acc_peak_[1];
+            acc_sq_[0] += l * l;
+            acc_sq_[1] += r * r;
+
+            // Pairwise average: a cheap lowpass ahead of dropping every other sample
+            const float m = 0.25f * (l + r);
+            if (odd_)
+                ring_[head++ & (RING - 1)] = half_ + m;
+            else
+                half_ = m;
+            odd_ = !odd_;
+        }
+        acc_count_ += static_cast<uint32_t>(size);
+        head_.store(head, std::memory_order_release);
+
+        if (take_.load(std::memory_order_acquire))
+        {
+            for (int c = 0; c < NUM_CHANNELS; c++)
+            {
+                meter_peak_[c] = acc_peak_[c];
+                meter_rms_[c] = sqrtf(acc_sq_[c] / acc_count_);
+                acc_peak_[c] = acc_sq_[c] = 0.f;
+            }
+            acc_count_ = 0;
+            take_.store(false, std::memory_order_release);
+        }
+    }
+
+    /**
+     * @brief Main loop: FFT the newest window and update bands and meters
+     * @return false until the ring holds a full window
+     */
+    bool Analyze()
+    {
+        if (!take_.load(std::memory_order_acquire))
+        {
+            for (int c = 0; c < NUM_CHANNELS; c++)
+            {
+                peak_db[c] = Db(meter_peak_[c]);
+                rms_db[c] = Db(meter_rms_[c]);
+            }
+            take_.store(true, std::memory_order_release);
+        }
+
+        const uint32_t head = head_.load(std::memory_order_acquire);
+        if (head < static_cast<uint32_t>(SIZE))
+            return false;
+
+        // Even samples to re_, odd to im_, in bit reversed order
+        const uint32_t start = head - SIZE;
+        for (int n = 0; n < HALF; n++)
+        {
+            const int i = 2 * n;
+            re_[rev_[n]] = ring_[(start + i) & (RING - 1)] * window_[i];
+            im_[rev_[n]] = ring_[(start + i + 1) & (RING - 1)] * window_[i + 1];
+        }
+        Fft();
+
+        // Split into the real signal's spectrum and fold bins into bands
+        int band = 0;
+        float best = 0.f;
+        for (int k = 1; k < HALF; k++)
+        {
+            const int j = HALF - k;
+            const float er = 0.5f * (re_[k] + re_[j]), ei = 0.5f * (im_[k] - im_[j]);
+            const float orr = 0.5f * (im_[k] + im_[j]), oi = -0.5f * (re_[k] - re_[j]);
+            const float c = cos_[k], s = sin_[k];
+            const float xr = er + c * orr + s * oi;
+            const float xi = ei + c * oi - s * orr;
+            const float p = xr * xr + xi * xi;
+            best = p > best ? p : best;
+            if (k + 1 >= edges_[band + 1])
+            {
+                Band(band, best);
+                best = 0.f;
+                if (++band >= BANDS)
+                    break;
+            }
+        }
+        for (; band < BANDS; band++)
+            Band(band, 0.f);
+        return true;
+    }
+
+    /** Band height 0..1 after the fall, and its held peak. */
+    float Level(int band) const { return level_[band]; }
+    float Peak(int band) const { return peak_[band]; }
+    /** Lower edge of a band in Hz. */
+    float BandHz(int band) const { return edges_[band] * rate_ / SIZE; }
+
+    // Since the last Analyze(), in dBFS
+    float peak_db[NUM_CHANNELS] = {-120.f, -120.f};
+    float rms_db[NUM_CHANNELS] = {-120.f, -120.f};
+
+private:
+    static float Db(float a) { return a > 1e-6f ? 20.f * log10f(a) : -120.f; }
+
+    /** In place radix-2 on re_/im_, input already bit reversed. */
+    void Fft()
+    {
+        for (int size = 2; size <= HALF; size <<= 1)
+        {
+            const int half = size / 2;
+            const int step = SIZE / size;
+            for (int base = 0; base < HALF; base += size)
+            {
+                for (int j = 0; j < half; j++)
+                {
+                    const float wr = cos_[j * step], wi = -sin_[j * step];
+                    const int a = base + j, b = a + half;
+                    const float tr = re_[b] * wr - im_[b] * wi;
+                    const float ti = re_[b] * wi + im_[b] * wr;
+                    re_[b] = re_[a] - tr;
+                    im_[b] = im_[a] - ti;
+                    re_[a] += tr;
+                    im_[a] += ti;
+                }
+            }
+        }
+    }
+
+    void Band(int band, float power)
+    {
+        // Hann window: a full scale sine peaks at SIZE / 4
+        const float norm = 16.f / (static_cast<float>(SIZE) * SIZE);
+        const float db = power > 0.f ? 10.f * log10f(power * norm) : floor_db_;
+        float v = (db - floor_db_) / -floor_db_;
+        v = v < 0.f ? 0.f : (v > 1.f ? 1.f : v);
+
+        const float fall = 0.03f;
+        level_[band] = v > level_[band] - fall ? v : level_[band] - fall;
+        if (v >= peak_[band])
+        {
+            peak_[band] = v;
+            hold_[band] = PEAK_HOLD;
+        }
+        else if (hold_[band] > 0)
+            hold_[band]--;
+        else
+            peak_[band] -= fall;
+    }
+
+    // Audio side
+    float ring_[RING];
+    std::atomic<uint32_t> head_{0};
+    float half_ = 0.f;
+    bool odd_ = false;
+    float acc_peak_[NUM_CHANNELS];
+    float acc_sq_[NUM_CHANNELS];
+    uint32_t acc_count_ = 0;
+    float meter_peak_[NUM_CHANNELS];
+    float meter_rms_[NUM_CHANNELS];
+    std::atomic<bool> take_{true};
+
+    // Main loop side
+    float rate_ = 24000.f;
+    float floor_db_ = -66.f;
+    float window_[SIZE];
+    float cos_[HALF];
+    float sin_[HALF];
+    uint16_t rev_[HALF];
+    uint16_t edges_[BANDS + 1];
+    float re_[HALF];
+    float im_[HALF];
+    float level_[BANDS];
+    float peak_[BANDS];
+    int hold_[BANDS];
+};
+
+#endif
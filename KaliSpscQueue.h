@@ -0,0 +1,95 @@
+#pragma once
+#ifndef KALI_SPSC_QUEUE_H
+#define KALI_SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Fixed-size single-producer / single-consumer queue
+ *
+ * Safe between one interrupt and one other context (or two interrupts of
+ * different priority) on a single core without disabling interrupts: the
+ * producer only writes head_, the consumer only writes tail_.
+ *
+ * @tparam T element type, copied in and out
+ * @tparam N capacity, must be a power of two; N - 1 slots are usable
+ */
+template <typename T, size_t N>
+class KaliSpscQueue
+{
+    static_assert((N & (N - 1)) == 0, "KaliSpscQueue size must be a power of two");
+
+public:
+    void Clear()
+    {
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+    }
+
+    /** Producer side. Returns false (and drops the item) when full. */
+    bool Push(const T &item)
+    {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        const uint32_t next = (head + 1) & (N - 1);
+        if (next == tail_.load(std::memory_order_acquire))
+        {
+            dropped_++;
+            return false;
+        }
+        items_[head] = item;
+        head_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /** Consumer side. Returns nullptr when empty; valid until the next Pop(). */
+    const T *Peek() const
+    {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire))
+            return nullptr;
+        return &items_[tail];
+    }
+
+    /** Consumer side. Returns false when empty. */
+    bool Pop(T &out)
+    {
+        const T *front = Peek();
+        if (!front)
+            return false;
+        out = *front;
+        Drop();
+        return true;
+    }
+
+    /** Consumer side. Discards the front element after a successful Peek(). */
+    void Drop()
+    {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        tail_.store((tail + 1) & (N - 1), std::memory_order_release);
+    }
+
+    bool Empty() const
+    {
+        return tail_.load(std::memory_order_acquire) == head_.load(std::memory_order_acquire);
+    }
+
+    size_t Size() const
+    {
+        return (head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire)) & (N - 1);
+    }
+
+    static constexpr size_t Capacity() { return N - 1; }
+
+    /** Number of pushes rejected because the queue was full. */
+    uint32_t Dropped() const { return dropped_; }
+
+private:
+    T items_[N];
+    std::atomic<uint32_t> head_{0};
+    std::atomic<uint32_t> tail_{0};
+    uint32_t dropped_ = 0;
+};
+
+#endif
@@ -240,6 +240,20 @@ void KaliDSPConfigState::handle_event(Kali *kali, int event)
     }
 }
 
+KaliState &KaliSpectrumState::getInstance()
+{
+    static KaliSpectrumState singleton;
+    return singleton;
+}
+
+void KaliSpectrumState::handle_event(Kali *kali, int event)
+{
+    if (event == KaliEvent::LEFTTURN)
+    {
+        kali->SetStateByInt(kali->editstate.major_mode + kali->e2inc);
+    }
+}
+
 KaliState &KaliDebugState::getInstance()
 {
     static KaliDebugState singleton;
@@ -364,12 +378,12 @@ void KaliPresetsState::handle_event(Kali *kali, int event)
         int slot = kali->editstate.SelectedPresetIndex;
         if (kali->preset_save_mode)
         {
-            kali->SaveMainPreset(slot);
+            kali->RequestPresetSave(slot);
             kali->preset_save_mode = false; // Exit save mode after saving
         }
         else
         {
-            kali->LoadMainPreset(slot);
+            kali->RequestPresetLoad(slot);
         }
         break;
     }
@@ -389,6 +403,8 @@ KaliState &getStateInstance(KaliEditState::PageTypeMajor state)
         return KaliConfigState::getInstance();
     case KaliEditState::DSP_EDIT:
         return KaliDSPConfigState::getInstance();
+    case KaliEditState::SPECTRUM:
+        return KaliSpectrumState::getInstance();
     case KaliEditState::PRESETS:
         return KaliPresetsState::getInstance();
     case KaliEditState::MIDI_MODE:
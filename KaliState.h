@@ -13,6 +13,7 @@ public:
         LFO_EDIT,
         OPTIONS,
         DSP_EDIT,
+        SPECTRUM,
         PRESETS,
         MIDI_MODE,
         DEBUG_MODE,
@@ -163,6 +164,22 @@ private:
     KaliDSPConfigState &operator=(const KaliDSPConfigState &) = delete;
 };
 
+// Spectrum and level meters, display only
+class KaliSpectrumState : public KaliState
+{
+public:
+    void enter(Kali *kali) override {}
+    void handle_event(Kali *kali, int event) override;
+    void exit(Kali *kali) override {}
+
+    static KaliState &getInstance();
+
+private:
+    KaliSpectrumState() {}
+    KaliSpectrumState(const KaliSpectrumState &) = delete;
+    KaliSpectrumState &operator=(const KaliSpectrumState &) = delete;
+};
+
 // Debug state
 class KaliDebugState : public KaliState
 {
@@ -0,0 +1,222 @@
+#pragma once
+#ifndef KALI_SYSEX_H
+#define KALI_SYSEX_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief SysEx framing for preset and config dump / restore
+ *
+ * Every message looks like
+ *
+ *   F0 7D 4B cmd section seq_hi seq_lo payload... checksum F7
+ *
+ * 7D is the non-commercial manufacturer ID and 4B ('K') tags Kali. A
+ * section is one contiguous block of QSPI data: SECTION_CONFIG for the
+ * global config, 1..32 for a main preset slot. Payloads are 8-to-7 packed
+ * (a leading byte carries the top bits of the next seven) and the checksum
+ * is the 7-bit sum of everything from cmd to the last payload byte.
+ *
+ * A transfer is BEGIN (payload: 32-bit section size), DATA chunks of at
+ * most CHUNK raw bytes with seq counting from 0, then END (payload: 32-bit
+ * checksum of the raw section, see Checksum()). The receiver answers
+ * BEGIN once the section is erased, END, and any error with ACK carrying
+ * a Status; a sender must wait for the BEGIN ACK before sending DATA.
+ * Dumps are requested with REQUEST, where SECTION_ALL asks for the config
+ * and every non-empty slot.
+ *
+ * No dependencies, so the same code encodes and decodes on the host.
+ */
+class KaliSysex
+{
+public:
+    static const uint8_t MANUFACTURER = 0x7D;
+    static const uint8_t DEVICE = 0x4B;
+
+    static const size_t CHUNK = 64;
+    static const size_t HEADER = 7; // F0 .. seq_lo
+    static const size_t MAX_PAYLOAD = CHUNK + (CHUNK + 6) / 7; // PackedSize(CHUNK)
+    static const size_t MAX_MESSAGE = HEADER + MAX_PAYLOAD + 2;
+    static const size_t MAX_USB = (MAX_MESSAGE + 2) / 3 * 4; // ToUsbPackets(MAX_MESSAGE)
+
+    static const uint8_t SECTION_CONFIG = 0;
+    static const uint8_t SECTION_ALL = 0x7F;
+
+    enum Command : uint8_t
+    {
+        REQUEST = 0x01,
+        BEGIN = 0x02,
+        DATA = 0x03,
+        END = 0x04,
+        ACK = 0x05,
+    };
+
+    enum Status : uint8_t
+    {
+        OK = 0,
+        BAD_CHECKSUM,
+        BAD_SEQUENCE,
+        BAD_SECTION,
+        BAD_SIZE,
+        BAD_CONTENT,
+        BUSY,
+    };
+
+    struct Header
+    {
+        uint8_t command;
+        uint8_t section;
+        uint16_t seq;
+    };
+
+    /** Packed size of n raw bytes. */
+    static size_t PackedSize(size_t n) { return n + (n + 6) / 7; }
+
+    /**
+     * @brief Build one complete message, F0 to F7
+     * @param out at least MAX_MESSAGE bytes
+     * @return message length
+     */
+    static size_t Encode(uint8_t *out, uint8_t command, uint8_t section, uint16_t seq,
+                         const uint8_t *data, size_t len)
+    {
+        size_t n = 0;
+        out[n++] = 0xF0;
+        out[n++] = MANUFACTURER;
+        out[n++] = DEVICE;
+        out[n++] = command & 0x7F;
+        out[n++] = section & 0x7F;
+        out[n++] = (seq >> 7) & 0x7F;
+        out[n++] = seq & 0x7F;
+        n += Pack(data, len, out + n);
+
+        uint8_t sum = 0;
+        for (size_t i = 3; i < n; i++)
+            sum += out[i];
+        out[n++] = sum & 0x7F;
+        out[n++] = 0xF7;
+        return n;
+    }
+
+    /** Encode a command whose payload is one 32-bit value (BEGIN, END). */
+    static size_t EncodeWord(uint8_t *out, uint8_t command, uint8_t section, uint32_t value)
+    {
+        uint8_t raw[4] = {static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8),
+                          static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 24)};
+        return Encode(out, command, section, 0, raw, sizeof(raw));
+    }
+
+    /**
+     * @brief Check and unpack a message
+     * @param msg message bytes, with or without the F0 / F7 framing
+     * @param data receives the unpacked payload, at least CHUNK bytes
+     * @param header only valid when the result is not BAD_CONTENT
+     * @return Status; data_len is only valid on OK
+     */
+    static Status Decode(const uint8_t *msg, size_t len, Header &header, uint8_t *data, size_t &data_len)
+    {
+        if (len > 0 && msg[0] == 0xF0)
+        {
+            msg++;
+            len--;
+        }
+        if (len > 0 && msg[len - 1] == 0xF7)
+            len--;
+        // manufacturer, device, cmd, section, seq x2, checksum
+        if (len < 7 || msg[0] != MANUFACTURER || msg[1] != DEVICE)
+            return BAD_CONTENT;
+
+        uint8_t sum = 0;
+        for (size_t i = 2; i < len - 1; i++)
+            sum += msg[i];
+        if ((sum & 0x7F) != msg[len - 1])
+            return BAD_CHECKSUM;
+
+        header.command = msg[2];
+        header.section = msg[3];
+        header.seq = static_cast<uint16_t>((msg[4] << 7) | msg[5]);
+
+        const size_t packed = len - 7;
+        if (packed > MAX_PAYLOAD)
+            return BAD_SIZE;
+        data_len = Unpack(msg + 6, packed, data);
+        return OK;
+    }
+
+    /**
+     * @brief Wrap a complete message, F0 to F7, in USB-MIDI event packets
+     *
+     * Every packet but the last is CIN 0x4 with three bytes; the last is CIN
+     * 0x5, 0x6 or 0x7 with the one, two or three bytes that end in F7.
+     * libDaisy's MidiUsbTransport::Tx sends F7 in a packet of its own, which
+     * hosts take as a broken message, so dumps go out through this instead.
+     * @param out at least MAX_USB bytes
+     * @return bytes written, four per packet
+     */
+    static size_t ToUsbPackets(const uint8_t *msg, size_t len, uint8_t *out, uint8_t cable = 0)
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < len; i += 3)
+        {
+            const size_t left = len - i;
+            const size_t count = left < 3 ? left : 3;
+            const uint8_t cin = left > 3 ? 0x4 : static_cast<uint8_t>(0x4 + count);
+            out[n++] = static_cast<uint8_t>(cable << 4) | cin;
+            for (size_t j = 0; j < 3; j++)
+                out[n++] = j < count ? msg[i + j] : 0;
+        }
+        return n;
+    }
+
+    static uint32_t ReadWord(const uint8_t *data)
+    {
+        return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+    }
+
+    /** Running checksum over a section, Fletcher style so swapped chunks are caught. */
+    static void Checksum(uint32_t &state, const uint8_t *data, size_t len)
+    {
+        uint32_t a = state & 0xFFFF, b = state >> 16;
+        for (size_t i = 0; i < len; i++)
+        {
+            a = (a + data[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        state = (b << 16) | a;
+    }
+
+    static const uint32_t CHECKSUM_INIT = 1;
+
+private:
+    static size_t Pack(const uint8_t *in, size_t len, uint8_t *out)
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < len; i += 7)
+        {
+            const size_t group = len - i < 7 ? len - i : 7;
+            uint8_t msbs = 0;
+            for (size_t j = 0; j < group; j++)
+                msbs |= ((in[i + j] >> 7) & 1) << j;
+            out[n++] = msbs;
+            for (size_t j = 0; j < group; j++)
+                out[n++] = in[i + j] & 0x7F;
+        }
+        return n;
+    }
+
+    static size_t Unpack(const uint8_t *in, size_t len, uint8_t *out)
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < len; i += 8)
+        {
+            const uint8_t msbs = in[i];
+            const size_t group = len - i - 1 < 7 ? len - i - 1 : 7;
+            for (size_t j = 0; j < group; j++)
+                out[n++] = in[i + 1 + j] | (((msbs >> j) & 1) << 7);
+        }
+        return n;
+    }
+};
+
+#endif
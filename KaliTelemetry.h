@@ -0,0 +1,140 @@
+#pragma once
+#ifndef KALI_TELEMETRY_H
+#define KALI_TELEMETRY_H
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Decimated ring of per-block probe values for scopes and meters
+ *
+ * The audio callback is the only writer. Peaks are max-held across the
+ * decimation window every block; everything else is point-sampled, and only
+ * gathered and handed over on the block that publishes the frame. Frames are
+ * stored struct-of-arrays so a scope can walk a single probe linearly.
+ *
+ * Readers (the OLED, debug pages) never block the writer: they read
+ * Published() and walk backwards from there. A frame being overwritten while
+ * it is drawn only costs a pixel of tearing at the oldest end of the scope.
+ */
+class KaliTelemetry
+{
+public:
+    static const int FRAMES = 64;
+    static const int DECIMATION = 24; // blocks per frame, ~48ms at 96/48k
+    static const int NUM_LFOS = 9; // Kali::warble
+    static const int NUM_ENV = 2;
+    static const int NUM_AUDIO = 2;
+
+    // Probe rows, indexed [probe][frame]
+    float lfo[NUM_LFOS][FRAMES];      // raw LFO output, 0..4095
+    float env[NUM_ENV][FRAMES];       // feedback envelope follower
+    float in_peak[NUM_AUDIO][FRAMES]; // absolute input peak over the frame
+    float out_peak[NUM_AUDIO][FRAMES];
+    uint8_t grains[NUM_AUDIO][FRAMES]; // active grain count per channel
+
+    void Init()
+    {
+        for (int f = 0; f < FRAMES; f++)
+        {
+            for (int i = 0; i < NUM_LFOS; i++)
+                lfo[i][f] = 2048.f;
+            for (int i = 0; i < NUM_ENV; i++)
+                env[i][f] = 0.f;
+            for (int i = 0; i < NUM_AUDIO; i++)
+            {
+                in_peak[i][f] = out_peak[i][f] = 0.f;
+                grains[i][f] = 0;
+            }
+        }
+
+        for (int i = 0; i < NUM_AUDIO; i++)
+            acc_in_[i] = acc_out_[i] = 0.f;
+
+        block_count_ = 0;
+        write_pos_ = 0;
+        published_.store(0, std::memory_order_relaxed);
+    }
+
+    /** Fold a block of audio into the running peak for the current frame. */
+    void AccumulatePeaks(const float *const *in, const float *const *out, size_t size)
+    {
+        for (int ch = 0; ch < NUM_AUDIO; ch++)
+        {
+            float pi = acc_in_[ch], po = acc_out_[ch];
+            for (size_t i = 0; i < size; i++)
+            {
+                float a = fabsf(in[ch][i]);
+                float b = fabsf(out[ch][i]);
+                pi = a > pi ? a : pi;
+                po = b > po ? b : po;
+            }
+            acc_in_[ch] = pi;
+            acc_out_[ch] = po;
+        }
+    }
+
+    /**
+     * @brief Close out one block.
+     * @return true every DECIMATION calls, when the caller must gather the
+     * probes and Publish() them; the other blocks cost nothing more
+     */
+    bool EndBlock()
+    {
+        if (++block_count_ < DECIMATION)
+            return false;
+        block_count_ = 0;
+        return true;
+    }
+
+    /**
+     * @brief Write and publish a frame, after EndBlock() returned true
+     * @param lfo_values NUM_LFOS raw LFO outputs
+     * @param env_values NUM_ENV envelope follower levels
+     * @param grain_counts NUM_AUDIO active grain counts, may be nullptr
+     */
+    void Publish(const float *lfo_values, const float *env_values, const uint8_t *grain_counts)
+    {
+        const int f = write_pos_;
+        for (int i = 0; i < NUM_LFOS; i++)
+            lfo[i][f] = lfo_values[i];
+        for (int i = 0; i < NUM_ENV; i++)
+            env[i][f] = env_values[i];
+        for (int i = 0; i < NUM_AUDIO; i++)
+        {
+            in_peak[i][f] = acc_in_[i];
+            out_peak[i][f] = acc_out_[i];
+            grains[i][f] = grain_counts ? grain_counts[i] : 0;
+            acc_in_[i] = acc_out_[i] = 0.f;
+        }
+
+        write_pos_ = (f + 1) % FRAMES;
+        published_.store(published_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /** Monotonic count of published frames; changes when there is something new to draw. */
+    uint32_t Published() const { return published_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Ring index of a frame relative to the newest one.
+     * @param age 0 for the newest frame, FRAMES - 1 for the oldest
+     */
+    int FrameIndex(int age) const
+    {
+        uint32_t newest = Published() + FRAMES - 1;
+        return static_cast<int>((newest - static_cast<uint32_t>(age)) % FRAMES);
+    }
+
+    int Newest() const { return FrameIndex(0); }
+
+private:
+    float acc_in_[NUM_AUDIO];
+    float acc_out_[NUM_AUDIO];
+    int block_count_;
+    int write_pos_;
+    std::atomic<uint32_t> published_;
+};
+
+#endif
@@ -0,0 +1,192 @@
+#pragma once
+#ifndef KALI_TEMPO_TRACKER_H
+#define KALI_TEMPO_TRACKER_H
+
+#include <cmath>
+#include <cstdint>
+
+/**
+ * @brief Second-order delay-locked loop tempo estimator for incoming clock pulses
+ *
+ * Feed it the interval since the previous pulse (in samples, or any unit as
+ * long as it is consistent) and read back a filtered period. The loop state is
+ * kept relative to the last pulse so it never loses float precision on long
+ * runs:
+ *
+ *   e      = interval - predicted
+ *   next   = period + (b - 1) * e      (predicted time of the next pulse)
+ *   period = period + c * e
+ *
+ * with b = sqrt(2) * w and c = w^2, w = 2 * pi * bandwidth, where bandwidth
+ * is given as a fraction of the pulse rate. Right after (re)locking the loop
+ * runs wide open and narrows to the configured bandwidth over a few pulses so
+ * tempo changes settle quickly.
+ *
+ * Intervals that land far from the prediction are treated as outliers
+ * (double triggers, dropped pulses, USB bursts). Very short ones are merged
+ * into the next interval, the rest re-anchor the prediction without touching
+ * the period. Several outliers in a row are taken as a real tempo change and
+ * relock the loop on the new interval. The gate is disabled for the first few
+ * pulses after a lock, while the estimate is still settling.
+ *
+ * No hardware dependencies, so it can be built and fed recorded clock
+ * streams on the host.
+ */
+class KaliTempoTracker
+{
+public:
+    KaliTempoTracker() { Reset(); }
+
+    void Reset()
+    {
+        period_ = 0.f;
+        next_ = 0.f;
+        pending_ = 0.f;
+        anchored_ = false;
+        locked_ = false;
+        pulses_since_lock_ = 0;
+        consecutive_outliers_ = 0;
+        outlier_side_ = 0;
+        jitter_sq_ = 0.f;
+        drift_ = 0.f;
+        rejected_ = 0;
+        relocks_ = 0;
+    }
+
+    /** @param fraction loop bandwidth relative to the pulse rate, e.g. 0.02 */
+    void SetBandwidth(float fraction)
+    {
+        if (fraction < 0.0005f)
+            fraction = 0.0005f;
+        if (fraction > 0.25f)
+            fraction = 0.25f;
+        bandwidth_ = fraction;
+    }
+
+    /** @param threshold how far from the prediction, as a fraction of the period, counts as an outlier */
+    void SetOutlierThreshold(float threshold) { outlier_threshold_ = threshold; }
+
+    /**
+     * @brief Register a pulse
+     * @param interval time since the previous pulse
+     * @return true if the period estimate was updated
+     */
+    bool Process(float interval)
+    {
+        if (interval <= 0.f)
+            return false;
+
+        if (!anchored_)
+        {
+            // First pulse only gives us a reference point
+            anchored_ = true;
+            pending_ = 0.f;
+            return false;
+        }
+
+        interval += pending_;
+        pending_ = 0.f;
+
+        if (!locked_)
+        {
+            Lock(interval);
+            return true;
+        }
+
+        const float e = interval - next_;
+        const bool settling = pulses_since_lock_ < SETTLE_PULSES;
+        if (!settling && fabsf(e) > outlier_threshold_ * period_)
+        {
+            rejected_++;
+            if (interval < GLITCH_FRACTION * period_)
+            {
+                // Double trigger or contact bounce: fold into the next interval
+                pending_ = interval;
+                return false;
+            }
+
+            // A run of outliers on the same side of the prediction is a tempo change
+            const int side = e > 0.f ? 1 : -1;
+            if (side != outlier_side_)
+                consecutive_outliers_ = 0;
+            outlier_side_ = side;
+
+            if (++consecutive_outliers_ >= RELOCK_AFTER)
+            {
+                relocks_++;
+                Lock(interval);
+                return true;
+            }
+
+            // Dropped pulse or a one-off burst: restart the prediction from this pulse
+            next_ = period_;
+            return false;
+        }
+        consecutive_outliers_ = 0;
+
+        // Open the loop up right after locking, then settle to the configured bandwidth
+        float bw = bandwidth_;
+        const float settle = 0.8f / (8.f + pulses_since_lock_);
+        if (settle > bw)
+            bw = settle;
+        const float w = 6.2831853f * bw;
+        const float b = 1.4142135f * w;
+        const float c = w * w;
+
+        const float old_period = period_;
+        next_ = period_ + (b - 1.f) * e;
+        period_ += c * e;
+        if (period_ < 1.f)
+            period_ = 1.f;
+
+        pulses_since_lock_++;
+
+        // Stats: RMS timing error and slow tempo drift in parts per million per pulse
+        jitter_sq_ += (e * e - jitter_sq_) * 0.05f;
+        drift_ += ((period_ - old_period) / period_ * 1e6f - drift_) * 0.05f;
+        return true;
+    }
+
+    bool IsLocked() const { return locked_; }
+    float GetPeriod() const { return period_; }
+    float GetJitter() const { return sqrtf(jitter_sq_); }
+    float GetDriftPpm() const { return drift_; }
+    uint32_t GetRejected() const { return rejected_; }
+    uint32_t GetRelocks() const { return relocks_; }
+    uint32_t GetPulsesSinceLock() const { return pulses_since_lock_; }
+
+private:
+    static const int RELOCK_AFTER = 3;
+    static const uint32_t SETTLE_PULSES = 8; // no outlier gating while the loop is still wide
+    static constexpr float GLITCH_FRACTION = 0.3f;
+
+    void Lock(float interval)
+    {
+        period_ = interval;
+        next_ = interval;
+        locked_ = true;
+        pulses_since_lock_ = 0;
+        consecutive_outliers_ = 0;
+        jitter_sq_ = 0.f;
+        drift_ = 0.f;
+    }
+
+    float bandwidth_ = 0.02f;
+    float outlier_threshold_ = 0.15f;
+
+    float period_;
+    float next_; // predicted time of the next pulse, relative to the last one
+    float pending_;
+    bool anchored_;
+    bool locked_;
+    uint32_t pulses_since_lock_;
+    int consecutive_outliers_;
+    int outlier_side_;
+
+    float jitter_sq_;
+    float drift_;
+    uint32_t rejected_;
+    uint32_t relocks_;
+};
+
+#endif
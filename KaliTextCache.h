@@ -0,0 +1,149 @@
+#pragma once
+#ifndef KALI_TEXT_CACHE_H
+#define KALI_TEXT_CACHE_H
+
+#include "hid/disp/graphics_common.h"
+#include "util/oled_fonts.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Rasterized strings kept between frames, so a redraw is a blit
+ *
+ * The screens redraw every label every frame, and most of them (option
+ * names, string table entries, mode names) are the same as last frame.
+ * Get() looks the string up by font and contents; only a string not seen
+ * recently is rasterized, into one 32 bit row mask per column, and it
+ * replaces the least recently used entry. Numbers that change just miss
+ * once per new value.
+ *
+ * The masks are position independent: the same entry blits anywhere, and
+ * the caller clips to what fits on the screen.
+ */
+class KaliTextCache
+{
+public:
+    static const int ENTRIES = 24;
+    static const int MAX_COLUMNS = 128;
+    static const int MAX_TEXT = 32;
+
+    struct Entry
+    {
+        uint32_t cols[MAX_COLUMNS]; // bit r set: row r of that column is ink
+        uint16_t width;             // columns rasterized, all chars up to the first unprintable
+        uint8_t height;
+        uint8_t length; // strlen, which the alignment goes by
+        const uint16_t *font;
+        uint32_t hash;
+        uint32_t used;
+        char text[MAX_TEXT];
+    };
+
+    const Entry &Get(const char *text, const FontDef &font)
+    {
+        uint32_t hash = 2166136261u ^ reinterpret_cast<uintptr_t>(font.data);
+        size_t len = 0;
+        for (; text[len] && len < MAX_TEXT - 1; len++)
+            hash = (hash ^ static_cast<uint8_t>(text[len])) * 16777619u;
+
+        clock_++;
+        for (int i = 0; i < ENTRIES; i++)
+        {
+            Entry &e = entries_[i];
+            if (e.hash == hash && e.font == font.data && e.length == len && Same(e.text, text, len))
+            {
+                e.used = clock_;
+                hits++;
+                return e;
+            }
+        }
+
+        Entry *victim = &entries_[0];
+        for (int i = 1; i < ENTRIES; i++)
+            if (entries_[i].used < victim->used)
+                victim = &entries_[i];
+        misses++;
+        Rasterize(*victim, text, len, font);
+        victim->hash = hash;
+        victim->used = clock_;
+        return *victim;
+    }
+
+    /**
+     * @brief Draw text the way WriteStringAligned() would, as one blit
+     *
+     * Same placement and clipping (whole chars only, nothing if the font
+     * does not fit below y), but the glyphs come from the cache. Display is
+     * an OledDisplay over KaliOledDriver.
+     */
+    template <typename Display>
+    void Print(Display &display, const char *text, const FontDef &font, const daisy::Rectangle &screen,
+               daisy::Alignment alignment, bool on)
+    {
+        const Entry &e = Get(text, font);
+        const daisy::Rectangle rect =
+            daisy::Rectangle(e.length * font.FontWidth, font.FontHeight).AlignedWithin(screen, alignment);
+        const int width = display.Width();
+        const int height = display.Height();
+        const int x = std::min(static_cast<int>(static_cast<uint16_t>(rect.GetX())), width - 1);
+        const int y = std::min(static_cast<int>(static_cast<uint16_t>(rect.GetY())), height - 1);
+        if (y + font.FontHeight > height)
+            return;
+        const int fit = (width - x) / font.FontWidth;
+        display.GetDriver().Blit(x, y, e.cols, std::min<int>(e.width, fit * font.FontWidth), font.FontHeight, on);
+    }
+
+    /** Forget everything, e.g. after a font is regenerated. */
+    void Clear()
+    {
+        for (int i = 0; i < ENTRIES; i++)
+        {
+            entries_[i].font = nullptr;
+            entries_[i].used = 0;
+        }
+    }
+
+    uint32_t hits = 0;
+    uint32_t misses = 0; // strings rasterized
+
+private:
+    static bool Same(const char *a, const char *b, size_t len)
+    {
+        for (size_t i = 0; i < len; i++)
+            if (a[i] != b[i])
+                return false;
+        return true;
+    }
+
+    static void Rasterize(Entry &e, const char *text, size_t len, const FontDef &font)
+    {
+        e.font = font.data;
+        e.length = static_cast<uint8_t>(len);
+        e.height = font.FontHeight;
+        e.width = 0;
+        for (size_t n = 0; n < len; n++)
+            e.text[n] = text[n];
+        e.text[len] = '\0';
+        for (size_t n = 0; n < len; n++)
+        {
+            const char ch = text[n];
+            if (ch < 32 || ch > 126 || e.width + font.FontWidth > MAX_COLUMNS || font.FontHeight > 32)
+                break; // the display stops at the first char it can't write, so does this
+            for (int j = 0; j < font.FontWidth; j++)
+            {
+                uint32_t col = 0;
+                for (int i = 0; i < font.FontHeight; i++)
+                    if ((font.data[(ch - 32) * font.FontHeight + i] << j) & 0x8000)
+                        col |= 1u << i;
+                e.cols[e.width + j] = col;
+            }
+            e.width += font.FontWidth;
+        }
+    }
+
+    Entry entries_[ENTRIES] = {};
+    uint32_t clock_ = 0;
+};
+
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+#ifndef KALI_TIMEBASE_H
+#define KALI_TIMEBASE_H
+
+#include "daisy.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Maps System::GetTick() timestamps onto sample offsets in the audio block
+ *
+ * The audio callback stamps each block with BeginBlock(). Events stamped
+ * from interrupts (MIDI bytes, gate edges) that fell between the previous
+ * two stamps are placed proportionally inside the current block, so every
+ * event is delayed by exactly one block instead of being quantized to the
+ * block boundary. Using the measured tick span of the previous block keeps
+ * the mapping right without knowing the codec clock exactly.
+ */
+class KaliTimebase
+{
+public:
+    void Init(size_t block_size)
+    {
+        size_ = block_size;
+        block_start_ = prev_block_start_ = daisy::System::GetTick();
+        uint32_t ticks_per_sample = daisy::System::GetTickFreq() / 48000;
+        block_ticks_ = ticks_per_sample * static_cast<uint32_t>(block_size);
+    }
+
+    /** Call first thing in the audio callback. */
+    void BeginBlock(size_t block_size)
+    {
+        size_ = block_size;
+        prev_block_start_ = block_start_;
+        block_start_ = daisy::System::GetTick();
+        uint32_t span = block_start_ - prev_block_start_;
+        if (span > 0)
+            block_ticks_ = span;
+    }
+
+    /** Tick at which the window mapped onto this block closes. */
+    uint32_t WindowEnd() const { return block_start_; }
+
+    /** True if the event belongs to a later block and should stay queued. */
+    bool IsFuture(uint32_t tick) const
+    {
+        return static_cast<int32_t>(tick - block_start_) >= 0;
+    }
+
+    /**
+     * @brief Sample offset of a timestamp inside the current block
+     * @return 0..size-1; late events clamp to 0
+     */
+    size_t ToSampleOffset(uint32_t tick) const
+    {
+        int32_t since = static_cast<int32_t>(tick - prev_block_start_);
+        if (since <= 0 || block_ticks_ == 0)
+            return 0;
+        uint64_t offset = (static_cast<uint64_t>(since) * size_) / block_ticks_;
+        return offset < size_ ? static_cast<size_t>(offset) : size_ - 1;
+    }
+
+    uint32_t BlockTicks() const { return block_ticks_; }
+
+private:
+    size_t size_ = 96;
+    uint32_t block_start_ = 0;
+    uint32_t prev_block_start_ = 0;
+    uint32_t block_ticks_ = 1;
+};
+
+#endif
@@ -1,9 +1,12 @@
 /* This was written based on existing systems by Claude 2.5 Sonnet. */
 
 #include "KaliVersion.h"
+#include "KaliPresetLayout.h"
+#include <cstddef>
 
 // Provide ODR definition for C++14 builds (avoids undefined reference with LTO)
 constexpr FirmwareVersion KaliVersionManager::CURRENT_VERSION;
+uint32_t KaliVersionManager::lastSectionsWritten = 0;
 
 uint32_t KaliVersionManager::calculateChecksum(const void *data, size_t size)
 {
@@ -44,59 +47,187 @@ void KaliVersionManager::initializeConfig(OptimizedKaliConfig &config)
     }
 }
 
-void KaliVersionManager::writeConfig(DPT &patch, const OptimizedKaliConfig &config)
+namespace
 {
-    uint32_t address_offset_ = 0;
-    address_offset_ = 0x00 & (uint32_t)(~0xff);
+    // Byte range of one config section inside OptimizedKaliConfig
+    struct ConfigSpan
+    {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+#define KALI_CONFIG_SPAN(member, bytes) {offsetof(OptimizedKaliConfig, member), bytes}
+    const uint32_t OPTION_BYTES = MAX_OPTIONS * sizeof(float);
+    const uint32_t HALF_BANK_BYTES = (MAX_PRESETS / 2) * sizeof(CompactPreset);
+
+    // Options change all the time, the preset banks hardly ever, so they get
+    // sections of their own (banks in halves to stay under a record)
+    const ConfigSpan config_sections[CONFIG_SECTIONS] = {
+        KALI_CONFIG_SPAN(GlobalOptions, OPTION_BYTES),
+        KALI_CONFIG_SPAN(LFOOptions[0], OPTION_BYTES),
+        KALI_CONFIG_SPAN(LFOOptions[1], OPTION_BYTES),
+        KALI_CONFIG_SPAN(LFOOptions[2], OPTION_BYTES),
+        KALI_CONFIG_SPAN(LFOOptions[3], OPTION_BYTES),
+        KALI_CONFIG_SPAN(LFOOptions[4], OPTION_BYTES),
+        KALI_CONFIG_SPAN(LFOOptions[5], OPTION_BYTES),
+        KALI_CONFIG_SPAN(DSPOptions, OPTION_BYTES),
+        KALI_CONFIG_SPAN(ClockOptions, OPTION_BYTES),
+        KALI_CONFIG_SPAN(GlobalPresets[0], HALF_BANK_BYTES),
+        KALI_CONFIG_SPAN(GlobalPresets[MAX_PRESETS / 2], HALF_BANK_BYTES),
+        KALI_CONFIG_SPAN(LFOPresets[0], HALF_BANK_BYTES),
+        KALI_CONFIG_SPAN(LFOPresets[MAX_PRESETS / 2], HALF_BANK_BYTES),
+        KALI_CONFIG_SPAN(DSPPresets[0], HALF_BANK_BYTES),
+        KALI_CONFIG_SPAN(DSPPresets[MAX_PRESETS / 2], HALF_BANK_BYTES),
+        KALI_CONFIG_SPAN(ClockPresets[0], HALF_BANK_BYTES),
+        KALI_CONFIG_SPAN(ClockPresets[MAX_PRESETS / 2], HALF_BANK_BYTES),
+    };
+#undef KALI_CONFIG_SPAN
+    static_assert(MAX_LFOS == 6, "config_sections lists one section per LFO");
+
+    const uint32_t MAX_SECTION_RECORD = sizeof(ConfigSectionHeader) + HALF_BANK_BYTES;
+    static_assert(MAX_SECTION_RECORD <= KaliRecordStore::MAX_RECORD, "config section too large for a record");
+
+    // What the store holds (or has staged), so saves diff against RAM rather than QSPI
+    OptimizedKaliConfig DSY_SDRAM_BSS persisted;
+    uint32_t persisted_valid = 0; // bit per section
+}
+
+const OptimizedKaliConfig &KaliVersionManager::persistedConfig()
+{
+    // Nothing read yet (factory reset boot): defaults rather than SDRAM garbage
+    if (persisted_valid == 0)
+        initializeConfig(persisted);
+    return persisted;
+}
 
-    ConfigHeader header = {
-        KALI_CONFIG_MAGIC,
-        CURRENT_VERSION,
-        calculateChecksum(&config, sizeof(config)),
-        sizeof(config)};
+bool KaliVersionManager::writeConfig(KaliRecordStore &store, const OptimizedKaliConfig &config)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&config);
+    uint8_t *image = reinterpret_cast<uint8_t *>(&persisted);
 
-    // Erase the sector
-    patch.qspi.Erase(address_offset_, sizeof(header) + sizeof(config));
+    uint32_t changed = 0, changed_bytes = 0, count = 0;
+    for (uint16_t i = 0; i < CONFIG_SECTIONS; i++)
+    {
+        const ConfigSpan &span = config_sections[i];
+        if ((persisted_valid & (1u << i)) && memcmp(image + span.offset, bytes + span.offset, span.size) == 0)
+            continue;
+        changed |= 1u << i;
+        changed_bytes += sizeof(ConfigSectionHeader) + span.size;
+        count++;
+    }
+    lastSectionsWritten = count;
+    if (changed == 0)
+        return true;
 
-    // Write header
-    patch.qspi.Write(address_offset_, sizeof(header), (uint8_t *)&header);
+    // Sections stand alone, but keep a save together so it either all goes or is retried
+    if (!store.HasRoom(changed_bytes, count))
+        return false;
 
-    // Write config directly after header
-    patch.qspi.Write(address_offset_ + sizeof(header), sizeof(config), (uint8_t *)&config);
+    uint8_t record[MAX_SECTION_RECORD];
+    for (uint16_t i = 0; i < CONFIG_SECTIONS; i++)
+    {
+        if (!(changed & (1u << i)))
+            continue;
+        const ConfigSpan &span = config_sections[i];
+        ConfigSectionHeader header = {KALI_CONFIG_MAGIC, CURRENT_VERSION, i, static_cast<uint16_t>(span.size)};
+        memcpy(record, &header, sizeof(header));
+        memcpy(record + sizeof(header), bytes + span.offset, span.size);
+        store.Put(KEY_CONFIG_FIRST + i, record, sizeof(header) + span.size);
+
+        memcpy(image + span.offset, bytes + span.offset, span.size);
+        persisted_valid |= 1u << i;
+    }
+    return true;
 }
 
-bool KaliVersionManager::readConfig(DPT &patch, OptimizedKaliConfig &config)
+bool KaliVersionManager::readConfig(KaliRecordStore &store, OptimizedKaliConfig &config)
 {
-    uint32_t address_offset_ = 0;
-    address_offset_ = 0x00 & (uint32_t)(~0xff);
-
-    // Get the data directly from QSPI memory
-    const ConfigHeader *header = reinterpret_cast<const ConfigHeader *>(
-        patch.qspi.GetData(address_offset_));
+    // Defaults first, then every section that is present and current on top
+    initializeConfig(config);
+    uint8_t *bytes = reinterpret_cast<uint8_t *>(&config);
 
-    // Check if we need to initialize
-    if (needsInitialization(*header))
+    persisted_valid = 0;
+    for (uint16_t i = 0; i < CONFIG_SECTIONS; i++)
     {
-        initializeConfig(config);
-        writeConfig(patch, config);
-        return true;
+        const ConfigSpan &span = config_sections[i];
+        uint32_t len;
+        const uint8_t *data = store.Get(KEY_CONFIG_FIRST + i, len);
+        ConfigSectionHeader header;
+        if (!data || len != sizeof(header) + span.size)
+            continue;
+        memcpy(&header, data, sizeof(header));
+        if (header.magic != KALI_CONFIG_MAGIC || header.version.major != CURRENT_VERSION.major ||
+            header.section != i || header.size != span.size)
+            continue;
+        memcpy(bytes + span.offset, data + sizeof(header), span.size);
+        persisted_valid |= 1u << i;
     }
+    memcpy(&persisted, &config, sizeof(config));
+
+    // Missing or stale sections get their defaults written back
+    const bool initialized = persisted_valid != (1u << CONFIG_SECTIONS) - 1;
+    if (initialized)
+        writeConfig(store, config);
+    return initialized;
+}
 
-    // Read config data from memory after header
-    const OptimizedKaliConfig *stored_config = reinterpret_cast<const OptimizedKaliConfig *>(
-        patch.qspi.GetData(address_offset_ + sizeof(ConfigHeader)));
+bool KaliVersionManager::readLegacyConfig(DPT &patch, OptimizedKaliConfig &config)
+{
+    // Old fixed layout: header and config at the very start of QSPI
+    const ConfigHeader *header = reinterpret_cast<const ConfigHeader *>(patch.qspi.GetData(0));
+    if (needsInitialization(*header) || header->size != sizeof(config))
+        return false;
 
-    // Copy the config data
-    memcpy(&config, stored_config, sizeof(OptimizedKaliConfig));
+    memcpy(&config, patch.qspi.GetData(sizeof(ConfigHeader)), sizeof(config));
+    return calculateChecksum(&config, sizeof(config)) == header->checksum;
+}
 
-    // Verify checksum
-    uint32_t checksum = calculateChecksum(&config, sizeof(config));
-    if (checksum != header->checksum)
+bool KaliVersionManager::upgradeMainPreset(const uint8_t *data, uint32_t len, MainPresetEntry &out)
+{
+    // Version 1 predates the envelope follower options at the end of each LFO
+    struct MainPresetEntryV1
     {
-        initializeConfig(config);
-        writeConfig(patch, config);
+        uint32_t magic;
+        uint32_t version;
+        char name[16];
+        float lfo[6][LFOOptionsPages::FollowBand];
+        float dsp[DSPOptionsPages::KALI_DSP_OPTIONS_LAST];
+        float knob_snapshot[8];
+        uint8_t last_selected_slot;
+        uint8_t reserved[3];
+    };
+
+    uint32_t head[2];
+    if (len < sizeof(head))
+        return false;
+    memcpy(head, data, sizeof(head));
+    if (head[0] != MAIN_PRESET_MAGIC)
+        return false;
+
+    if (head[1] == MAIN_PRESET_VERSION)
+    {
+        if (len < sizeof(MainPresetEntry))
+            return false;
+        memcpy(&out, data, sizeof(out));
         return true;
     }
+    if (head[1] != 1 || len < sizeof(MainPresetEntryV1))
+        return false;
 
-    return false;
-}
\ No newline at end of file
+    MainPresetEntryV1 v1;
+    memcpy(&v1, data, sizeof(v1));
+    memcpy(out.name, v1.name, sizeof(out.name));
+    for (int i = 0; i < 6; i++)
+    {
+        for (int j = 0; j < LFOOptionsPages::KALI_LFO_OPTIONS_LAST; j++)
+            out.lfo[i][j] = OptionRules[BankType::LFO][j]->DefaultValue;
+        memcpy(out.lfo[i], v1.lfo[i], sizeof(v1.lfo[i]));
+    }
+    memcpy(out.dsp, v1.dsp, sizeof(out.dsp));
+    memcpy(out.knob_snapshot, v1.knob_snapshot, sizeof(out.knob_snapshot));
+    out.last_selected_slot = v1.last_selected_slot;
+    memset(out.reserved, 0, sizeof(out.reserved));
+    out.magic = MAIN_PRESET_MAGIC;
+    out.version = MAIN_PRESET_VERSION;
+    return true;
+}
@@ -7,6 +7,7 @@
 #include <cstdint>
 #include "KaliConfig.h"  // for OptimizedKaliConfig
 #include "KaliOptions.h" // for OptionRules and enums
+#include "KaliRecordStore.h"
 #include "dpt/daisy_dpt.h"
 
 using namespace daisy;
@@ -55,6 +56,8 @@ struct FirmwareVersion
 // Magic number to detect valid config
 static const uint32_t KALI_CONFIG_MAGIC = 0x4B414C49; // "KALI" in ASCII
 
+struct MainPresetEntry;
+
 // Header stored at the start of NVRAM
 struct ConfigHeader
 {
@@ -64,6 +67,15 @@ struct ConfigHeader
     uint32_t size;           // Size of config data
 };
 
+// Leads every config section record in the record store
+struct ConfigSectionHeader
+{
+    uint32_t magic;          // KALI_CONFIG_MAGIC
+    FirmwareVersion version; // only the major version has to match
+    uint16_t section;        // index, guards against a record under the wrong key
+    uint16_t size;           // payload bytes, changes whenever the section layout does
+};
+
 class KaliVersionManager
 {
 public:
@@ -88,8 +100,19 @@ public:
 
     static uint32_t calculateChecksum(const void *data, size_t size);
     static void initializeConfig(OptimizedKaliConfig &config);
-    static void writeConfig(DPT &patch, const OptimizedKaliConfig &config);
-    static bool readConfig(DPT &patch, OptimizedKaliConfig &config);
+    // Stages the sections that differ from the last read or written config,
+    // false if the store has no room for them right now
+    static bool writeConfig(KaliRecordStore &store, const OptimizedKaliConfig &config);
+    // Returns true if any section had to be initialized (and was staged)
+    static bool readConfig(KaliRecordStore &store, OptimizedKaliConfig &config);
+    // The config as last read or written, the base for the next save
+    static const OptimizedKaliConfig &persistedConfig();
+    static uint32_t lastSectionsWritten;
+    // Config from the fixed pre-store layout, false if there is none
+    static bool readLegacyConfig(DPT &patch, OptimizedKaliConfig &config);
+    // Main preset of the current version, or of version 1 from the fixed
+    // pre-store layout, as the current version; false if data is neither
+    static bool upgradeMainPreset(const uint8_t *data, uint32_t len, MainPresetEntry &out);
 };
 
 #endif // KALI_VERSION_H
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include "sys/system.h"
 #include "per/gpio.h"
 #include "per/tim.h"
+#include "usbd_cdc.h"
 
 #include <vector>
 
@@ -14,6 +15,9 @@
 #define DSY_MAX(in, mx) (in > mx ? in : mx)
 #define DSY_CLAMP(in, mn, mx) (DSY_MIN(DSY_MAX(in, mn), mx))
 
+// Device handle of the internal USB port, owned by libDaisy's UsbHandle
+extern "C" USBD_HandleTypeDef hUsbDeviceFS;
+
 // #define EXTERNAL_SDRAM_SECTION __attribute__((section(".sdram_bss")))
 // uint8_t EXTERNAL_SDRAM_SECTION buff[1024];
 
@@ -420,16 +424,19 @@ namespace daisy
             tim5_.Start();
         }
 
-        void DPT::InitMidi()
+        bool DPT::UsbMidiTxReady() const
         {
-            /*
-            MidiUsbHandler::Config usb_midi_config;
-            usb_midi_config.transport_config.periph = MidiUsbTransport::Config::Periph::INTERNAL;
+            const USBD_CDC_HandleTypeDef *cdc = static_cast<const USBD_CDC_HandleTypeDef *>(hUsbDeviceFS.pClassData);
+            return cdc != nullptr && cdc->TxState == 0;
+        }
 
-            MidiUsbHandler::Config midi_cfg;
-            midi_cfg.transport_config.periph = MidiUsbTransport::Config::INTERNAL;
-            usb_midi.Init(midi_cfg);
-            */
+        void DPT::InitMidi()
+        {
+            // USB MIDI device next to TRS; both feed the same event bus
+            MidiUsbTransport::Config usb_midi_config;
+            usb_midi_config.periph = MidiUsbTransport::Config::Periph::INTERNAL;
+            usb_midi_config.tx_retry_count = 0; // never stall on a busy host
+            usb_midi.Init(usb_midi_config);
 
             MidiUartHandler::Config midi_config;
 
@@ -437,6 +444,20 @@ namespace daisy
             midi_config.transport_config.tx = DPT::A8;
             midi_config.transport_config.periph = UartHandler::Config::Peripheral::USART_1;
             midi.Init(midi_config);
+
+            // Second handle on the same USART. libDaisy keeps one state object per
+            // peripheral, so this shares the RX FIFO with `midi` and lets the timer
+            // ISR read bytes directly instead of going through MidiHandler::Listen().
+            UartHandler::Config uart_config;
+            uart_config.baudrate = 31250;
+            uart_config.stopbits = UartHandler::Config::StopBits::BITS_1;
+            uart_config.parity = UartHandler::Config::Parity::NONE;
+            uart_config.mode = UartHandler::Config::Mode::TX_RX;
+            uart_config.wordlength = UartHandler::Config::WordLength::BITS_8;
+            uart_config.periph = midi_config.transport_config.periph;
+            uart_config.pin_config.rx = midi_config.transport_config.rx;
+            uart_config.pin_config.tx = midi_config.transport_config.tx;
+            midi_uart.Init(uart_config);
         }
 
         void DPT::StartAudio(AudioHandle::AudioCallback cb)
@@ -196,6 +196,15 @@ namespace daisy
              */
             void WriteCvOutExp(float a, float b, float c, float d, bool raw);
 
+            /** Split each WriteCvOutExp() into this many interpolated DAC frames (1-4), paced by TickCvOutExp() */
+            void SetCvOutExpFrames(int frames) { dac_exp.SetFramesPerBlock(frames); }
+
+            /** Call from a timer interrupt faster than frames x the block rate */
+            void TickCvOutExp() { dac_exp.Tick(); }
+
+            /** Expander DAC frames dropped on an SPI DMA error */
+            uint32_t CvOutExpErrors() const { return dac_exp.Errors(); }
+
             /** Convert -8 to 8 range to 4096 */
             uint16_t VoltageToCodeExp(float input);
 
@@ -338,7 +347,10 @@ namespace daisy
             Pcm3060 codec;
             DacHandle dac;
             MidiUartHandler midi;
-            MidiUsbHandler usb_midi;
+            UartHandler midi_uart; // raw access to the MIDI UART FIFO for timestamped input
+            MidiUsbTransport usb_midi; // raw transport, bytes are parsed by KaliMIDIBus
+            /** False while the USB IN endpoint is still sending the last transfer (usb_midi.Tx() or usb.TransmitInternal()) */
+            bool UsbMidiTxReady() const;
 
             daisy::TimerHandle tim5_;
             daisy::TimerHandle::Config timcfg;
@@ -7,6 +7,7 @@
 #include "../per/qspi.h"
 #include "../per/gpio.h"
 #include "../sys/system.h"
+#include "../util/scopedirqblocker.h"
 
 // Driver for DAC7554 based on code from Making Sound Machines
 // Based on Code from Westlicht Performer   - https://westlicht.github.io/performer/
@@ -48,9 +49,17 @@ using namespace daisy;
 using namespace patch_sm;
 using namespace std;
 
-#define MAX_DAC7554_BUF_SIZE 256
-uint8_t DMA_BUFFER_MEM_SECTION dac7554buf[MAX_DAC7554_BUF_SIZE];
-uint8_t DMA_BUFFER_MEM_SECTION dac7554buf_count = 0;
+// Double buffered: the audio callback fills one side while the DMA sends the
+// other. Each 16 bit DAC word is its own 2 byte transfer so SYNC frames it.
+#define DAC7554_FRAME_BYTES (Dac7554::Channels * 2)
+uint8_t DMA_BUFFER_MEM_SECTION dac7554buf[2][Dac7554::MaxFramesPerBlock * DAC7554_FRAME_BYTES];
+static volatile int dac7554_frames[2] = {0, 0}; // frames filled in each side
+static volatile int dac7554_front = 0;          // side the DMA reads
+static volatile bool dac7554_pending = false;   // back side holds a new block
+static volatile bool dac7554_busy = false;      // a frame is on the wire
+static volatile int dac7554_frame = 0;          // frame of the front side being / last sent
+static volatile int dac7554_word = 0;
+static volatile uint32_t dac7554_errors = 0;    // frames dropped on an SPI DMA error
 
 typedef struct
 {
@@ -62,22 +71,61 @@ static dsy_gpio pin_sync;
 static Dac7554_t Dac7554_;
 static SpiHandle::Config spi_config;
 
-void TxCpltCallback(void *context, daisy::SpiHandle::Result result)
+void TxCpltCallback(void *context, daisy::SpiHandle::Result result);
+
+// Call with interrupts blocked: give up on the front side after a failed transfer.
+// The next WriteDac7554() starts the chain again.
+static void AbortFrames()
 {
-    if (dac7554buf_count < 3)
+    dac7554_errors = dac7554_errors + 1;
+    dac7554_busy = false;
+    dac7554_frame = dac7554_frames[dac7554_front];
+}
+
+// Call with interrupts blocked: start the next frame if there is one and the line is free
+static void StartNextFrame()
+{
+    if (dac7554_busy)
+        return;
+    if (dac7554_pending)
     {
-        dac7554buf_count++;
-        h_spi.DmaTransmit(dac7554buf + (2 * dac7554buf_count), 2, nullptr, TxCpltCallback, nullptr);
+        // A new block wins over frames of the last one not sent yet
+        dac7554_front = 1 - dac7554_front;
+        dac7554_pending = false;
+        dac7554_frame = 0;
     }
+    else if (dac7554_frame + 1 < dac7554_frames[dac7554_front])
+        dac7554_frame = dac7554_frame + 1;
     else
-    {
-        dac7554buf_count = 0;
-    }
+        return;
+
+    dac7554_busy = true;
+    dac7554_word = 0;
+    if (h_spi.DmaTransmit(dac7554buf[dac7554_front] + dac7554_frame * DAC7554_FRAME_BYTES, 2, nullptr, TxCpltCallback,
+                          nullptr) != SpiHandle::Result::OK)
+        AbortFrames();
 }
 
-void TxStartCallback(void *context)
+void TxCpltCallback(void *context, daisy::SpiHandle::Result result)
 {
-    return;
+    (void)context;
+    ScopedIrqBlocker block;
+    if (result != SpiHandle::Result::OK)
+    {
+        AbortFrames();
+        return;
+    }
+    if (++dac7554_word < Dac7554::Channels)
+    {
+        if (h_spi.DmaTransmit(dac7554buf[dac7554_front] + dac7554_frame * DAC7554_FRAME_BYTES + 2 * dac7554_word, 2,
+                              nullptr, TxCpltCallback, nullptr) != SpiHandle::Result::OK)
+            AbortFrames();
+        return;
+    }
+    dac7554_busy = false;
+    // A block that came in while this frame was going out is already late
+    if (dac7554_pending)
+        StartNextFrame();
 }
 
 void Dac7554::Init()
@@ -119,15 +167,28 @@ void Dac7554::Write(int16_t gogo[4])
 
 void Dac7554::WriteDac7554()
 {
-    for (int i = 0; i < 4; i++)
-    {
-        uint8_t chan = i;
-        uint16_t cmd = (2 << 14) | (chan << 12) | (uint16_t)_values[chan];
+    ScopedIrqBlocker block;
 
-        dac7554buf[2 * i] = (cmd >> 8) & 0xff;
-        dac7554buf[2 * i + 1] = cmd & 0xff;
+    // The DMA never reads the back side, and only swaps to it from StartNextFrame
+    const int frames = _framesPerBlock;
+    uint8_t *back = dac7554buf[1 - dac7554_front];
+    for (int f = 0; f < frames; f++)
+    {
+        for (int i = 0; i < Channels; i++)
+        {
+            uint8_t chan = i;
+            const int32_t v = _last[chan] + (static_cast<int32_t>(_values[chan]) - _last[chan]) * (f + 1) / frames;
+            uint16_t cmd = (2 << 14) | (chan << 12) | (uint16_t)v;
+
+            back[f * DAC7554_FRAME_BYTES + 2 * i] = (cmd >> 8) & 0xff;
+            back[f * DAC7554_FRAME_BYTES + 2 * i + 1] = cmd & 0xff;
+        }
     }
-    h_spi.DmaTransmit(dac7554buf, 2, TxStartCallback, TxCpltCallback, nullptr);
+    for (int i = 0; i < Channels; i++)
+        _last[i] = _values[i];
+    dac7554_frames[1 - dac7554_front] = frames;
+    dac7554_pending = true;
+    StartNextFrame();
 
     // older blocking method, for reference
     // h_spi.BlockingTransmit(dac7554buf, 2, 100);
@@ -135,23 +196,43 @@ void Dac7554::WriteDac7554()
     // lock = false;
 }
 
+void Dac7554::Tick()
+{
+    ScopedIrqBlocker block;
+    StartNextFrame();
+}
+
+uint32_t Dac7554::Errors() const
+{
+    return dac7554_errors;
+}
+
+void Dac7554::SetFramesPerBlock(int frames)
+{
+    ScopedIrqBlocker block;
+    _framesPerBlock = frames < 1 ? 1 : (frames > MaxFramesPerBlock ? MaxFramesPerBlock : frames);
+}
+
 void Dac7554::Clear(void *context, int result)
 {
+    (void)context;
+    (void)result;
     for (int i = 0; i < 4; i++)
         _values[i] = 0;
 }
 
 void Dac7554::Reset()
 {
-    dac7554buf[0] = 0x0;
-
-    h_spi.BlockingTransmit(dac7554buf, 2, 100);
+    uint8_t zero[2] = {0, 0};
+    h_spi.BlockingTransmit(zero, 2, 100);
 }
 
 void Dac7554::SetInternalRef(bool enabled)
 {
+    (void)enabled;
 }
 
 void Dac7554::SetClearCode(ClearCode code)
 {
+    (void)code;
 }
\ No newline at end of file
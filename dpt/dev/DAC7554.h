@@ -53,12 +53,13 @@ namespace daisy
         };
 
         static constexpr int Channels = 4; // #define CONFIG_DAC_CHANNELS 8
+        static constexpr int MaxFramesPerBlock = 4;
 
         typedef int16_t Value;
 
         vector<uint8_t> buf;
 
-        Dac7554(Type type = Type::DAC7554) {}
+        Dac7554(Type type = Type::DAC7554) { (void)type; }
         ~Dac7554() {}
 
         // configuration currently only uses SPI1, w/ soft chip select.
@@ -70,7 +71,19 @@ namespace daisy
         void Init();
         void Set(int channel, Value value) { _values[channel] = value; }
         void Write(int16_t gogo[4]);
+        /**
+        Queues the values from Write() and returns; the SPI DMA sends them.
+        With more than one frame per block, the block is split into that many
+        frames stepping linearly from the last values; the first goes out now,
+        the rest on each Tick().
+        */
         void WriteDac7554();
+        /** From a timer interrupt, to pace the interpolated frames. */
+        void Tick();
+        /** 1 (default) to MaxFramesPerBlock. */
+        void SetFramesPerBlock(int frames);
+        /** Frames dropped because an SPI DMA transfer failed. */
+        uint32_t Errors() const;
 
         bool dac_ready;
         bool lock;
@@ -92,6 +105,8 @@ namespace daisy
         void SetClearCode(ClearCode code);
 
         uint32_t _dataShift = 0;
+        int _framesPerBlock = 1;
+        Value _last[Channels] = {0};
     };
     /** @} */
 } // namespace daisy
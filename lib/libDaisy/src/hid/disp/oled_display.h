@@ -50,7 +50,10 @@ class OledDisplay : public OneBitGraphicsDisplayImpl<OledDisplay<DisplayDriver>>
     */
     void Update() override { driver_.Update(); }
 
-//  private:
+    /** Returns the driver, for what this class does not wrap (contrast, blits) */
+    DisplayDriver& GetDriver() { return driver_; }
+
+  private:
     DisplayDriver driver_;
 
     void Reset() { driver_.Reset(); };
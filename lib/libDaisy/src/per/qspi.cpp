@@ -51,6 +51,10 @@ class QSPIHandle::Impl
 
     QSPIHandle::Result EraseSector(uint32_t address);
 
+    QSPIHandle::Result StartEraseSector(uint32_t address);
+
+    bool EraseBusy();
+
     uint32_t GetPin(size_t pin);
 
     GPIO_TypeDef* GetPort(size_t pin);
@@ -86,11 +90,12 @@ class QSPIHandle::Impl
     // These functions are defined, but we haven't added the ability to switch to quad mode. So they're currently unused.
     QSPIHandle::Result EnterQuadMode() __attribute__((unused));
     QSPIHandle::Result ExitQuadMode() __attribute__((unused));
-    uint8_t            GetStatusRegister() __attribute__((unused));
+    uint8_t            GetStatusRegister();
 
     QSPIHandle::Config config_;
     QSPI_HandleTypeDef halqspi_;
     Status             status_;
+    bool               erasing_ = false;
 
     static constexpr size_t pin_count_
         = sizeof(QSPIHandle::Config::pin_config) / sizeof(dsy_gpio_pin);
@@ -348,6 +353,20 @@ QSPIHandle::Result QSPIHandle::Impl::Erase(uint32_t start_addr,
 
 
 QSPIHandle::Result QSPIHandle::Impl::EraseSector(uint32_t address)
+{
+    RETURN_IF_ERR(StartEraseSector(address));
+    erasing_ = false;
+    if(AutopollingMemReady(HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
+       != QSPIHandle::Result::OK)
+    {
+        ERR_RECOVERY(Status::E_HAL_ERROR);
+    }
+
+    RETURN_IF_ERR(SetMode(Config::Mode::MEMORY_MAPPED));
+    return QSPIHandle::Result::OK;
+}
+
+QSPIHandle::Result QSPIHandle::Impl::StartEraseSector(uint32_t address)
 {
     uint8_t             use_qpi = 0;
     QSPI_CommandTypeDef s_command;
@@ -387,16 +406,23 @@ QSPIHandle::Result QSPIHandle::Impl::EraseSector(uint32_t address)
     {
         ERR_RECOVERY(Status::E_HAL_ERROR);
     }
-    if(AutopollingMemReady(HAL_QPSI_TIMEOUT_DEFAULT_VALUE)
-       != QSPIHandle::Result::OK)
-    {
-        ERR_RECOVERY(Status::E_HAL_ERROR);
-    }
-
-    RETURN_IF_ERR(SetMode(Config::Mode::MEMORY_MAPPED));
+    erasing_ = true;
     return QSPIHandle::Result::OK;
 }
 
+bool QSPIHandle::Impl::EraseBusy()
+{
+    if(!erasing_)
+        return false;
+    // A failed status read reads as 0x00, i.e. done; the caller should
+    // check the sector really is blank
+    if(GetStatusRegister() & IS25LP080D_SR_WIP)
+        return true;
+    erasing_ = false;
+    SetMode(Config::Mode::MEMORY_MAPPED);
+    return false;
+}
+
 
 QSPIHandle::Result QSPIHandle::Impl::ResetMemory()
 {
@@ -901,6 +927,16 @@ QSPIHandle::Result QSPIHandle::EraseSector(uint32_t address)
     return pimpl_->EraseSector(address);
 }
 
+QSPIHandle::Result QSPIHandle::StartEraseSector(uint32_t address)
+{
+    return pimpl_->StartEraseSector(address);
+}
+
+bool QSPIHandle::EraseBusy()
+{
+    return pimpl_->EraseBusy();
+}
+
 void* QSPIHandle::GetData(uint32_t offset)
 {
     return pimpl_->GetData(offset);
@@ -149,6 +149,22 @@ class QSPIHandle
         */
     Result EraseSector(uint32_t address);
 
+    /**
+        Starts erasing a single sector and returns without waiting for it.
+        The chip stays out of memory mapped mode until EraseBusy() returns
+        false, so nothing may read through GetData() or write meanwhile.
+        \param address Address of sector to erase
+        \return Result::OK or Result::ERR
+        */
+    Result StartEraseSector(uint32_t address);
+
+    /**
+        Polls an erase begun with StartEraseSector() once.
+        \return true while it is still running; false once the chip is
+        back in memory mapped mode (or when no erase was started)
+        */
+    bool EraseBusy();
+
     /** Returns the current class status. Useful for debugging.
      *  \returns Status
      */
@@ -6,7 +6,7 @@
 char *DSY_SDRAM_BSS string_tables[MAX_STRING_TABLE][MAX_STRING_TABLE_COUNT];
 
 // Store string data in flash but copy to SDRAM at init
-#define NUM_SOURCE_STRING_TABLES 18
+#define NUM_SOURCE_STRING_TABLES 23
 static const char *const source_strings[NUM_SOURCE_STRING_TABLES][MAX_STRING_TABLE_COUNT] = {
     {},
     {"Sin", "Tri", "Saw", "Ramp", "[ ]", "Ptri", "PSaw", "P[ ]", "Noise"},
@@ -31,6 +31,12 @@ static const char *const source_strings[NUM_SOURCE_STRING_TABLES][MAX_STRING_TAB
     {"Internal", "Ext CV", "MIDI Clk"},
     {"FIR", "IIR", "Off"},
     {"Prec", "Studio", "Amb", "Loop", "Exp"}, // Delay range presets
+    {"Full", "Low", "Mid", "High"},
+    {"Peak", "RMS"},
+    {"Off", "Pitch", "Clock"},
+    {"Off", "Manual", "CV", "Time"},
+    {"Off", "Out", "Out+In"},
+    {"Manual", "AtBoot", "Save", "Load"},
 };
 
 // Buffer to store all string data in SDRAM
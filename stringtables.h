@@ -29,6 +29,12 @@ enum StringTableType
     STSyncMode,
     STFilterMode,
     STDelayRange,
+    STFollowBands,
+    STFollowDetectors,
+    STKeyTrackModes,
+    STMorphSources,
+    STRecordModes,
+    STSnapshotActions,
     STRING_TABLE_TYPE_LAST
 };
 
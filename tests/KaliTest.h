@@ -0,0 +1,85 @@
+#pragma once
+#ifndef KALI_TEST_H
+#define KALI_TEST_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Minimal checks for the host tests
+ *
+ * Each test is one executable; CHECK() reports and counts failures and
+ * TEST_RESULT() turns the count into the exit status make looks at.
+ */
+static int kali_test_failures = 0;
+
+#define CHECK(cond)                                                            \
+    do                                                                         \
+    {                                                                          \
+        if (!(cond))                                                           \
+        {                                                                      \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            kali_test_failures++;                                              \
+        }                                                                      \
+    } while (0)
+
+#define TEST_RESULT() (kali_test_failures ? (std::printf("FAIL (%d)\n", kali_test_failures), 1) : (std::printf("ok\n"), 0))
+
+/**
+ * @brief A fixture file: "# key value..." header lines followed by rows of numbers
+ *
+ * Header lines that are not key/value pairs are free text and are skipped by
+ * Find(). Rows keep every whitespace separated number on the line.
+ */
+struct KaliFixture
+{
+    std::vector<std::vector<std::string>> headers;
+    std::vector<std::vector<double>> rows;
+
+    bool Load(const char *path)
+    {
+        FILE *f = std::fopen(path, "r");
+        if (!f)
+        {
+            std::printf("cannot open %s\n", path);
+            kali_test_failures++;
+            return false;
+        }
+        char line[512];
+        while (std::fgets(line, sizeof(line), f))
+        {
+            std::vector<std::string> words;
+            for (char *w = std::strtok(line, " \t\r\n"); w; w = std::strtok(nullptr, " \t\r\n"))
+                words.push_back(w);
+            if (words.empty())
+                continue;
+            if (words[0] == "#")
+            {
+                words.erase(words.begin());
+                if (!words.empty())
+                    headers.push_back(words);
+                continue;
+            }
+            std::vector<double> row;
+            for (const std::string &w : words)
+                row.push_back(std::strtod(w.c_str(), nullptr));
+            rows.push_back(row);
+        }
+        std::fclose(f);
+        return true;
+    }
+
+    /** @return value n of the first header line starting with key, or fallback */
+    double Find(const char *key, double fallback, size_t n = 0) const
+    {
+        for (const auto &h : headers)
+            if (h[0] == key && h.size() > n + 1)
+                return std::strtod(h[n + 1].c_str(), nullptr);
+        return fallback;
+    }
+};
+
+#endif
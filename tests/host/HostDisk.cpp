@@ -0,0 +1,80 @@
+#include "HostDisk.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace host
+{
+DiskStats disk_stats;
+
+static int disk_fd = -1;
+static uint32_t disk_sectors = 0;
+static const uint32_t SECTOR = 512;
+
+bool DiskOpen(const char *path, uint32_t sectors)
+{
+    DiskClose();
+    disk_fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (disk_fd < 0 || ftruncate(disk_fd, static_cast<off_t>(sectors) * SECTOR) != 0)
+        return false;
+    disk_sectors = sectors;
+    disk_stats = DiskStats();
+    return true;
+}
+
+void DiskClose()
+{
+    if (disk_fd >= 0)
+        close(disk_fd);
+    disk_fd = -1;
+}
+
+static DSTATUS Initialize(BYTE) { return disk_fd < 0 ? STA_NOINIT : 0; }
+
+static DSTATUS Status(BYTE) { return disk_fd < 0 ? STA_NOINIT : 0; }
+
+static DRESULT Read(BYTE, BYTE *buff, DWORD sector, UINT count)
+{
+    if (sector + count > disk_sectors)
+        return RES_PARERR;
+    disk_stats.reads++;
+    const ssize_t len = static_cast<ssize_t>(count) * SECTOR;
+    return pread(disk_fd, buff, len, static_cast<off_t>(sector) * SECTOR) == len ? RES_OK : RES_ERROR;
+}
+
+static DRESULT Write(BYTE, const BYTE *buff, DWORD sector, UINT count)
+{
+    if (sector + count > disk_sectors)
+        return RES_PARERR;
+    disk_stats.writes++;
+    disk_stats.sectors += count;
+    if (count == 1)
+        disk_stats.single_sector++;
+    if (count > disk_stats.largest)
+        disk_stats.largest = count;
+    const ssize_t len = static_cast<ssize_t>(count) * SECTOR;
+    return pwrite(disk_fd, buff, len, static_cast<off_t>(sector) * SECTOR) == len ? RES_OK : RES_ERROR;
+}
+
+static DRESULT Ioctl(BYTE, BYTE cmd, void *buff)
+{
+    switch (cmd)
+    {
+    case CTRL_SYNC:
+        return RES_OK;
+    case GET_SECTOR_COUNT:
+        *static_cast<DWORD *>(buff) = disk_sectors;
+        return RES_OK;
+    case GET_SECTOR_SIZE:
+        *static_cast<WORD *>(buff) = SECTOR;
+        return RES_OK;
+    case GET_BLOCK_SIZE:
+        *static_cast<DWORD *>(buff) = 1;
+        return RES_OK;
+    default:
+        return RES_PARERR;
+    }
+}
+
+const Diskio_drvTypeDef disk_driver = {Initialize, Status, Read, Write, Ioctl};
+} // namespace host
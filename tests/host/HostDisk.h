@@ -0,0 +1,36 @@
+#pragma once
+#ifndef KALI_HOST_DISK_H
+#define KALI_HOST_DISK_H
+
+#include <cstdint>
+#include "ff_gen_drv.h"
+
+/**
+ * @brief A file on the host as the SD card's block device
+ *
+ * Linked into libDaisy's FatFs the way sd_diskio is on the hardware, so
+ * f_mount(), f_open() and daisy::WavWriter run unchanged on top of it.
+ * Every write is counted, with its size and whether it started on a
+ * cluster boundary, so a test can see what the card would have been asked
+ * to do.
+ */
+namespace host
+{
+struct DiskStats
+{
+    uint32_t reads;
+    uint32_t writes;        // disk_write() calls
+    uint32_t sectors;       // sectors written
+    uint32_t single_sector; // writes of one sector (FAT and directory updates, partial clusters)
+    uint32_t largest;       // most sectors in one write
+};
+
+extern const Diskio_drvTypeDef disk_driver;
+extern DiskStats disk_stats;
+
+/** Create (or truncate) the image and size it; link disk_driver afterwards */
+bool DiskOpen(const char *path, uint32_t sectors);
+void DiskClose();
+} // namespace host
+
+#endif
@@ -0,0 +1,154 @@
+#include "HostI2C.h"
+#include <cstring>
+#include "HostSystem.h"
+
+namespace host
+{
+void Ssd1306::Reset()
+{
+    memset(ram, 0, sizeof(ram));
+    page = column = 0;
+    contrast = 0x7F;
+    args_ = 0;
+}
+
+void Ssd1306::Command(uint8_t cmd)
+{
+    if (args_ > 0)
+    {
+        if (pending_cmd_ == 0x81)
+            contrast = cmd;
+        args_--;
+        return;
+    }
+    pending_cmd_ = cmd;
+    if (cmd >= 0xB0 && cmd <= 0xB7)
+        page = cmd & 0x07;
+    else if (cmd <= 0x0F)
+        column = (column & 0xF0) | cmd;
+    else if (cmd <= 0x1F)
+        column = static_cast<uint8_t>(((cmd & 0x0F) << 4) | (column & 0x0F));
+    else if (cmd == 0x21 || cmd == 0x22)
+        args_ = 2;
+    else if (cmd == 0x20 || cmd == 0x81 || cmd == 0x8D || cmd == 0xA8 || cmd == 0xD3 || cmd == 0xD5 ||
+             cmd == 0xD9 || cmd == 0xDA || cmd == 0xDB)
+        args_ = 1;
+}
+
+// Control bytes: bit 7 set means one byte follows and then another control
+// byte; clear means the rest of the transaction is all commands or all data
+void Ssd1306::Receive(const uint8_t *data, size_t size)
+{
+    size_t i = 0;
+    while (i < size)
+    {
+        const uint8_t control = data[i++];
+        const bool is_data = control & 0x40;
+        const size_t end = (control & 0x80) ? (i + 1 < size ? i + 1 : size) : size;
+        for (; i < end; i++)
+        {
+            if (!is_data)
+            {
+                Command(data[i]);
+                continue;
+            }
+            // Page addressing: the column wraps within the page
+            if (column < 128)
+                ram[page][column] = data[i];
+            column = (column + 1) & 0x7F;
+        }
+    }
+}
+
+static I2CBus buses[4];
+
+I2CBus &Bus(daisy::I2CHandle::Config::Peripheral periph) { return buses[static_cast<int>(periph)]; }
+
+static uint32_t TransactionTicks(const I2CBus &bus, uint16_t size)
+{
+    const uint32_t clocks = 1 + 9 * (1 + size) + 1;
+    return static_cast<uint32_t>(static_cast<uint64_t>(clocks) * TICK_FREQ / bus.speed);
+}
+
+static void Deliver(I2CBus &bus, uint16_t address, const uint8_t *data, uint16_t size)
+{
+    const uint32_t ticks = TransactionTicks(bus, size);
+    bus.transactions++;
+    bus.bytes += 1 + size;
+    bus.busy_ticks += ticks;
+    if (address < 128 && bus.device[address] && data)
+        bus.device[address]->Receive(data, size);
+}
+
+void RunI2C(double us)
+{
+    const uint32_t end = Tick() + static_cast<uint32_t>(us * (TICK_FREQ / 1e6));
+    for (;;)
+    {
+        // The earliest transfer to finish before end, on any bus
+        I2CBus *next = nullptr;
+        for (I2CBus &bus : buses)
+            if (bus.dma_busy && static_cast<int32_t>(end - bus.dma_end) >= 0 &&
+                (!next || static_cast<int32_t>(next->dma_end - bus.dma_end) > 0))
+                next = &bus;
+        if (!next)
+            break;
+        SetTick(next->dma_end);
+        next->dma_busy = false;
+        const bool fail = next->fail_next;
+        next->fail_next = false;
+        if (!fail)
+            Deliver(*next, next->dma_address, next->dma_data, next->dma_size);
+        if (next->dma_callback)
+            next->dma_callback(next->dma_context,
+                               fail ? daisy::I2CHandle::Result::ERR : daisy::I2CHandle::Result::OK);
+    }
+    SetTick(end);
+}
+} // namespace host
+
+namespace daisy
+{
+class I2CHandle::Impl
+{
+public:
+    host::I2CBus *bus;
+};
+
+static I2CHandle::Impl impls[4];
+
+I2CHandle::Result I2CHandle::Init(const Config &config)
+{
+    static const uint32_t speeds[] = {100000, 400000, 1000000};
+    pimpl_ = &impls[static_cast<int>(config.periph)];
+    pimpl_->bus = &host::Bus(config.periph);
+    pimpl_->bus->speed = speeds[static_cast<int>(config.speed)];
+    return Result::OK;
+}
+
+I2CHandle::Result I2CHandle::TransmitBlocking(uint16_t address, uint8_t *data, uint16_t size, uint32_t)
+{
+    host::I2CBus &bus = *pimpl_->bus;
+    if (bus.dma_busy) // the real driver would wait for the DMA first
+        host::RunI2C(static_cast<int32_t>(bus.dma_end - host::Tick()) / (host::TICK_FREQ / 1e6));
+    host::Deliver(bus, address, data, size);
+    host::AdvanceUs(host::TransactionTicks(bus, size) / (host::TICK_FREQ / 1e6));
+    return Result::OK;
+}
+
+I2CHandle::Result I2CHandle::TransmitDma(uint16_t address, uint8_t *data, uint16_t size,
+                                         CallbackFunctionPtr callback, void *callback_context)
+{
+    host::I2CBus &bus = *pimpl_->bus;
+    if (bus.dma_busy)
+        return Result::ERR;
+    bus.dma_busy = true;
+    bus.dma_end = host::Tick() + host::TransactionTicks(bus, size);
+    bus.dma_address = address;
+    bus.dma_data = data;
+    bus.dma_size = size;
+    bus.dma_callback = callback;
+    bus.dma_context = callback_context;
+    return Result::OK;
+}
+} // namespace daisy
@@ -0,0 +1,62 @@
+#pragma once
+#ifndef KALI_HOST_I2C_H
+#define KALI_HOST_I2C_H
+
+#include <cstddef>
+#include <cstdint>
+#include "daisy.h"
+
+/**
+ * @brief The host build of daisy::I2CHandle: a timed bus with an SSD1306 on it
+ *
+ * Each peripheral is its own bus. A transaction takes the bus time of its
+ * bytes at the configured speed (start, address, 9 clocks a byte, stop).
+ * TransmitBlocking() advances the host clock by that much, as the CPU
+ * would spin; TransmitDma() returns at once and the transfer completes,
+ * callback and all, when RunI2C() moves the clock past its end. Every
+ * byte is delivered to the Ssd1306 attached at that address, which keeps
+ * the controller's RAM, so a test can compare what ends up on the glass.
+ */
+namespace host
+{
+struct Ssd1306
+{
+    uint8_t ram[8][128];
+    uint8_t page, column, contrast;
+
+    Ssd1306() { Reset(); }
+    void Reset();
+    void Receive(const uint8_t *data, size_t size);
+
+private:
+    void Command(uint8_t cmd);
+    uint8_t pending_cmd_ = 0;
+    int args_ = 0; // argument bytes still owed to pending_cmd_
+};
+
+struct I2CBus
+{
+    uint32_t speed = 1000000;
+    Ssd1306 *device[128] = {nullptr};
+    uint32_t transactions = 0;
+    uint32_t bytes = 0;      // on the wire, address bytes included
+    uint32_t busy_ticks = 0; // time the bus spent transferring
+    bool fail_next = false;  // the next DMA transfer reports an error
+
+    // The DMA transfer in flight
+    bool dma_busy = false;
+    uint32_t dma_end = 0;
+    uint16_t dma_address = 0;
+    const uint8_t *dma_data = nullptr;
+    uint16_t dma_size = 0;
+    daisy::I2CHandle::CallbackFunctionPtr dma_callback = nullptr;
+    void *dma_context = nullptr;
+};
+
+I2CBus &Bus(daisy::I2CHandle::Config::Peripheral periph);
+
+/** Advance the clock by us, completing DMA transfers as their time comes */
+void RunI2C(double us);
+} // namespace host
+
+#endif
@@ -0,0 +1,21 @@
+#include "HostPeripherals.h"
+
+namespace host
+{
+EXTI_Core_TypeDef exti_d1;
+RCC_TypeDef rcc;
+uint32_t irq_priority[256];
+bool irq_enabled[256];
+} // namespace host
+
+extern "C"
+{
+    void HAL_GPIO_Init(GPIO_TypeDef *, GPIO_InitTypeDef *) {}
+    void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t preempt, uint32_t) { host::irq_priority[irq + 16] = preempt; }
+    void HAL_NVIC_EnableIRQ(IRQn_Type irq) { host::irq_enabled[irq + 16] = true; }
+    void HAL_NVIC_DisableIRQ(IRQn_Type irq) { host::irq_enabled[irq + 16] = false; }
+
+    GPIO_TypeDef *dsy_hal_map_get_port(const dsy_gpio_pin *) { return nullptr; }
+    uint16_t dsy_hal_map_get_pin(const dsy_gpio_pin *p) { return static_cast<uint16_t>(1u << p->pin); }
+    void dsy_hal_map_gpio_clk_enable(dsy_gpio_port) {}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#ifndef KALI_HOST_PERIPHERALS_H
+#define KALI_HOST_PERIPHERALS_H
+
+#include "daisy.h"
+
+extern "C"
+{
+#include "util/hal_map.h"
+}
+
+/**
+ * @brief RAM stand-ins for the peripheral registers the headers under test touch
+ *
+ * Include before the header under test. The CMSIS peripheral macros are
+ * pointed at these blocks so register accesses land in RAM, and the HAL
+ * calls used at init time only record what they were asked to do.
+ */
+namespace host
+{
+extern EXTI_Core_TypeDef exti_d1;
+extern RCC_TypeDef rcc;
+
+/** Preemption priority set through HAL_NVIC_SetPriority, by IRQn + 16 */
+extern uint32_t irq_priority[256];
+extern bool irq_enabled[256];
+
+inline uint32_t Priority(IRQn_Type irq) { return irq_priority[irq + 16]; }
+} // namespace host
+
+#undef EXTI_D1
+#define EXTI_D1 (&host::exti_d1)
+#undef RCC
+#define RCC (&host::rcc)
+
+#endif
@@ -0,0 +1,25 @@
+#include "daisy.h"
+#include "HostSystem.h"
+
+namespace
+{
+double now_ticks = 0.0;
+}
+
+namespace host
+{
+void SetTick(uint32_t tick) { now_ticks = tick; }
+void AdvanceUs(double us) { now_ticks += us * (TICK_FREQ / 1e6); }
+uint32_t Tick() { return static_cast<uint32_t>(static_cast<uint64_t>(now_ticks)); }
+} // namespace host
+
+namespace daisy
+{
+uint32_t System::GetTick() { return host::Tick(); }
+uint32_t System::GetTickFreq() { return host::TICK_FREQ; }
+uint32_t System::GetUs() { return static_cast<uint32_t>(static_cast<uint64_t>(now_ticks / (host::TICK_FREQ / 1e6))); }
+uint32_t System::GetNow() { return GetUs() / 1000; }
+void System::Delay(uint32_t delay_ms) { host::AdvanceUs(delay_ms * 1000.0); }
+void System::DelayUs(uint32_t delay_us) { host::AdvanceUs(delay_us); }
+void System::DelayTicks(uint32_t delay_ticks) { now_ticks += delay_ticks; }
+} // namespace daisy
@@ -0,0 +1,22 @@
+#pragma once
+#ifndef KALI_HOST_SYSTEM_H
+#define KALI_HOST_SYSTEM_H
+
+#include <cstdint>
+
+/**
+ * @brief Controls the clock behind the host build of daisy::System
+ *
+ * The tick runs at 200 MHz like the H750's, and only moves when a test says
+ * so. Delay() advances it instead of sleeping.
+ */
+namespace host
+{
+static const uint32_t TICK_FREQ = 200000000;
+
+void SetTick(uint32_t tick);
+void AdvanceUs(double us);
+uint32_t Tick();
+} // namespace host
+
+#endif
@@ -0,0 +1,28 @@
+#include "HostTimer.h"
+#include "HostSystem.h"
+
+namespace host
+{
+daisy::TimerHandle::PeriodElapsedCallback timer_callback = nullptr;
+void *timer_data = nullptr;
+} // namespace host
+
+namespace daisy
+{
+TimerHandle::Result TimerHandle::Init(const Config &config)
+{
+    // As libDaisy's tim.cpp does for TIM2-5
+    static const IRQn_Type irqs[] = {TIM2_IRQn, TIM3_IRQn, TIM4_IRQn, TIM5_IRQn};
+    HAL_NVIC_SetPriority(irqs[static_cast<int>(config.periph)], 0x0f, 0);
+    return Result::OK;
+}
+TimerHandle::Result TimerHandle::SetPeriod(uint32_t) { return Result::OK; }
+TimerHandle::Result TimerHandle::Start() { return Result::OK; }
+TimerHandle::Result TimerHandle::Stop() { return Result::OK; }
+uint32_t TimerHandle::GetFreq() { return host::TICK_FREQ; }
+void TimerHandle::SetCallback(PeriodElapsedCallback cb, void *data)
+{
+    host::timer_callback = cb;
+    host::timer_data = data;
+}
+} // namespace daisy
@@ -0,0 +1,24 @@
+#pragma once
+#ifndef KALI_HOST_TIMER_H
+#define KALI_HOST_TIMER_H
+
+#include "daisy.h"
+
+/**
+ * @brief The host build of daisy::TimerHandle only keeps the period callback
+ *
+ * The test decides when the timer interrupt runs and calls Fire().
+ */
+namespace host
+{
+extern daisy::TimerHandle::PeriodElapsedCallback timer_callback;
+extern void *timer_data;
+
+inline void FireTimer()
+{
+    if (timer_callback)
+        timer_callback(timer_data);
+}
+} // namespace host
+
+#endif
@@ -0,0 +1,138 @@
+// Latency and noise floor of the knob and CV conditioning, replayed from
+// ADC traces (fixtures/adc). Each block's raw code goes through libDaisy's
+// AnalogControl, the KaliInput stage and KaliKnob's hysteresis, the value
+// the per-sample ramps start from. The pipeline it replaced (CV truncated
+// to 0.001 then 0.001 hysteresis, pots with 0.01 hysteresis) runs next to
+// it for comparison. Limits are in each trace's header.
+#include <cmath>
+#include "KaliTest.h"
+#include "hid/ctrl.h"
+#include "KaliInput.h"
+
+struct Stats
+{
+    double rest_rms = 0;       // error against the known value where it has held for a while
+    double updates_per_s = 0;  // knob value changes while at rest
+    double settle_ms = 0;      // worst time to within 1% of a move once it stops
+    double lag = 0;            // mean distance behind a moving input, in units
+    double lag_ms = 0;         // the same in time
+    int reversals = 0;         // value steps against the direction of travel
+};
+
+template <typename Stage>
+static Stats Replay(const KaliFixture &trace, bool cv, float hysteresis, Stage stage)
+{
+    const double rate = trace.Find("rate", 500);
+    uint16_t raw = 0;
+    daisy::AnalogControl control;
+    if (cv)
+        control.InitBipolarCv(&raw, rate);
+    else
+        control.Init(&raw, rate);
+    KaliKnob knob;
+    knob.Hysteresis = hysteresis;
+
+    std::vector<double> truth, out;
+    std::vector<bool> changed;
+    for (const auto &row : trace.rows)
+    {
+        raw = static_cast<uint16_t>(row[0]);
+        knob.UpdateValue(stage(control.Process()));
+        truth.push_back(row[1]);
+        out.push_back(knob._Value);
+        changed.push_back(knob.Changed);
+    }
+
+    Stats s;
+    const size_t n = truth.size();
+    const size_t hold = static_cast<size_t>(0.3 * rate); // at rest once the value has held this long
+    double err2 = 0, lag = 0, lag_ms = 0;
+    int rest = 0, rest_updates = 0, moving = 0;
+    size_t still_since = 0, move_start = 0;
+    bool in_move = false;
+    for (size_t i = 1; i < n; i++)
+    {
+        const double slope = truth[i] - truth[i - 1];
+        if (slope != 0)
+        {
+            if (!in_move)
+                move_start = i - 1;
+            in_move = true;
+            still_since = i;
+            if (i - move_start > 25 && std::fabs(slope) < 0.005) // a ramp, not a step or a twist
+            {
+                lag += std::fabs(truth[i] - out[i]);
+                lag_ms += 1000.0 * (truth[i] - out[i]) / (slope * rate);
+                moving++;
+                if (changed[i] && (out[i] - out[i - 1]) * slope < 0)
+                    s.reversals++;
+            }
+            continue;
+        }
+        if (in_move)
+        {
+            in_move = false;
+            // A move just ended: how long until the value stays within 1% of it
+            const double size = std::fabs(truth[i] - truth[move_start]);
+            const size_t end = std::min(n, i + hold);
+            size_t settled = i;
+            for (size_t k = i; k < end; k++)
+                if (std::fabs(out[k] - truth[i]) > 0.01 * size)
+                    settled = k + 1;
+            s.settle_ms = std::max(s.settle_ms, (settled - i) * 1000.0 / rate);
+        }
+        if (i - still_since > hold)
+        {
+            err2 += (out[i] - truth[i]) * (out[i] - truth[i]);
+            rest_updates += changed[i];
+            rest++;
+        }
+    }
+    s.rest_rms = std::sqrt(err2 / rest);
+    s.updates_per_s = rest_updates * rate / rest;
+    s.lag = moving ? lag / moving : 0;
+    s.lag_ms = moving ? lag_ms / moving : 0;
+    return s;
+}
+
+static void Print(const char *name, const Stats &s)
+{
+    std::printf("    %-5s rest %.5f rms, %5.1f updates/s; settle %5.1f ms; lag %.4f (%5.1f ms), %3d reversals\n",
+                name, s.rest_rms, s.updates_per_s, s.settle_ms, s.lag, s.lag_ms, s.reversals);
+}
+
+int main()
+{
+    const char *traces[] = {"cv_step", "cv_ramp", "knob_slow", "knob_fast"};
+    std::printf("\n");
+    for (const char *name : traces)
+    {
+        KaliFixture trace;
+        const std::string path = std::string("fixtures/adc/") + name + ".txt";
+        if (!trace.Load(path.c_str()))
+            continue;
+        bool cv = false;
+        for (const auto &h : trace.headers)
+            if (h[0] == "input")
+                cv = h.size() > 1 && h[1] == "cv";
+        const float rate = static_cast<float>(trace.Find("rate", 500));
+
+        KaliControlFilter filter;
+        filter.Init(rate, cv ? KALI_CV_FILTER : KALI_KNOB_FILTER);
+        const Stats now = Replay(trace, cv, 0.0005f, [&](float v) {
+            return cv ? fabsf(filter.Process(v)) : filter.Process(v);
+        });
+        const Stats before = Replay(trace, cv, cv ? 0.001f : 0.01f, [&](float v) {
+            return cv ? fabsf(static_cast<int>(v * 1000.f) * 0.001f) : v;
+        });
+        std::printf("  %s\n", name);
+        Print("now", now);
+        Print("old", before);
+
+        CHECK(now.rest_rms <= trace.Find("rest_rms", 0));
+        CHECK(now.settle_ms <= trace.Find("settle_ms", 0));
+        CHECK(now.lag <= trace.Find("lag", 0));
+        CHECK(now.reversals <= trace.Find("reversals", 0));
+    }
+    return TEST_RESULT();
+}
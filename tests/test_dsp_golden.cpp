@@ -0,0 +1,480 @@
+// Golden renders of every KaliDSP mode, the distortion algorithms and the
+// feedback FIR (fixtures/dsp). Each mode runs the audio callback's loop on
+// four fixed inputs with its controls automated: dry into Process(), the
+// wet through OptimizedFIR and the feedback gain back into the delay lines.
+// Windows of the output must match the golden samples and the spectrum of
+// the whole render the golden band levels. Every mode is rendered twice
+// with other code drawing rand() in between, and must not change.
+//
+// The goldens come from this harness on the host. After an intended change
+// to the sound, run `build/test_dsp_golden --update` from tests/ and commit
+// the new files with the change. Timing is host time and only printed.
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include "KaliTest.h"
+#include "daisy.h"
+#include "KaliOptions.h"
+#include "KaliDsp.h"
+#include "KaliFIR.h"
+
+// libDaisy's Random reads the hardware RNG. KaliOscillator asks for one when
+// it picks a random waveform, which none of the renders do.
+float daisy::Random::GetFloat(float min, float max) { return min; }
+
+static const float SAMPLERATE = 48000.f;
+static const size_t BLOCK = 96;
+static const size_t N = 1 << 15; // samples per input, about 0.7 s
+static const size_t WINDOW = 16;
+static const size_t WINDOW_STARTS[] = {2400, 10592, 18784, 26976};
+static const int BANDS = 24; // log spaced, 40 Hz to 20 kHz
+static const float MAX_ABS = 1e-4f;
+static const float BAND_DB = 0.5f;
+static const float BAND_FLOOR_DB = 60.f; // bands further below the loudest are not compared
+
+static const char *const MODE_FILES[] = {
+    "basic", "pingpong", "unlinked", "resonator", "chorus", "knuth", "granular",
+    "granular_octave", "granular_texture", "granular_shimmer", "granular_crystals",
+#if ENABLE_FFT_BLUR
+    "spectral_blur",
+#endif
+    "fluid"};
+static_assert(sizeof(MODE_FILES) / sizeof(MODE_FILES[0]) == KaliDSP::DSP_MODE_LAST, "one golden per mode");
+
+enum Signal
+{
+    IMPULSE,
+    SWEEP,
+    NOISE,
+    CLIP,
+    SIGNAL_LAST
+};
+
+static float Input(Signal signal, size_t i, int channel)
+{
+    static const float TWOPI = 6.28318530718f;
+    const float t = i / SAMPLERATE;
+    switch (signal)
+    {
+    case IMPULSE:
+        return i == 0 ? 1.f : 0.f;
+    case SWEEP:
+    {
+        // log sweep from 30 Hz to 18 kHz over the render
+        const float T = N / SAMPLERATE, k = logf(600.f);
+        return 0.5f * sinf(TWOPI * 30.f * T / k * (expf(k * t / T) - 1.f));
+    }
+    case NOISE:
+    {
+        // white noise from a fixed LCG, the same for every channel
+        uint32_t x = static_cast<uint32_t>(i) * 2654435761u + 12345u;
+        x = x * 1664525u + 1013904223u;
+        return 0.25f * ((x >> 8) * (2.f / 16777215.f) - 1.f);
+    }
+    case CLIP:
+    default:
+    {
+        // a synthesized stand-in for program material: plucked A minor
+        // arpeggio notes with three harmonics and a low thump on each, the
+        // right side a few samples late
+        static const float NOTES[] = {220.f, 261.63f, 329.63f, 440.f};
+        const size_t late = (channel & 1) ? 7 : 0;
+        if (i < late)
+            return 0.f;
+        const size_t note_len = N / 8;
+        const size_t n = (i - late) / note_len;
+        const float u = ((i - late) % note_len) / SAMPLERATE;
+        const float f = NOTES[n % 4];
+        const float env = expf(-u * 6.f);
+        float x = 0.f;
+        for (int h = 1; h <= 3; h++)
+            x += sinf(TWOPI * f * h * u) / h;
+        return 0.3f * env * x + 0.2f * expf(-u * 30.f) * sinf(TWOPI * 55.f * u);
+    }
+    }
+}
+
+struct Render
+{
+    std::vector<float> out[SIGNAL_LAST][4];
+    double us_per_block = 0;
+};
+
+static KaliDelayLine<float, MAX_DELAY> *lines[4];
+static DelayPhasor phasors[4];
+static OptimizedFIR fir[4];
+static KaliInput controls;
+
+static void RenderMode(int mode, Render &r)
+{
+    double seconds = 0;
+    for (int signal = 0; signal < SIGNAL_LAST; signal++)
+    {
+        // a fresh instance, as at boot: Init() leaves the read positions
+        // where the last mode put them, which is what a mode change wants
+        std::unique_ptr<KaliDSP> owner(new KaliDSP);
+        KaliDSP &dsp = *owner;
+        std::memset(&controls, 0, sizeof(controls));
+        for (int j = 0; j < 4; j++)
+        {
+            lines[j]->Reset();
+            phasors[j].Init(SAMPLERATE);
+            fir[j].Init();
+            r.out[signal][j].assign(N, 0.f);
+        }
+        dsp.Init(SAMPLERATE);
+        dsp.SetMode(mode);
+
+        KaliInputState s{};
+        s.inp = &controls;
+        s.size = BLOCK;
+        s.MAX_DELAY_WORKING = s.override = MAX_DELAY / 4;
+        for (int j = 0; j < 4; j++)
+        {
+            s.delays[j] = lines[j];
+            s.dp[j] = &phasors[j];
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < N; i++)
+        {
+            // control automation, moved once a block like the knobs: the
+            // metas and mode parameters sweep, delay times step, the filter
+            // closes from 16 kHz to 2 kHz
+            const float t = static_cast<float>(i - i % BLOCK) / N;
+            const float feedback = 0.3f + 0.4f * t;
+            if (i % BLOCK == 0)
+            {
+                controls.Feedback = feedback;
+                controls.TimeL = t;
+                controls.TimeR = 1.f - t;
+                controls.DelayAdjust = 0.5f;
+                s.curmet = 0.05f + 0.9f * t;
+                s.curmet2 = 0.95f - 0.9f * t;
+                s.cursplat = 0.5f * t;
+                for (int j = 0; j < 4; j++)
+                {
+                    const KaliDSP::ParamSpec &spec = dsp.GetParamSpec(j);
+                    s.delaytimes[j] = 2400.f + 4800.f * ((i / 8192 + j) % 3);
+                    s.warb[j] = 1.f + 0.01f * sinf(6.2831853f * t * (j + 1));
+                    s.config_new[j] = spec.def + (j & 1 ? -1.f : 1.f) * 0.25f * t * (spec.max - spec.min);
+                    s.config_new[j] = DSY_CLAMP(s.config_new[j], spec.min, spec.max);
+                    lines[j]->SetDelay(s.delaytimes[j]);
+                    fir[j].UpdateFilter(16000.f * powf(0.125f, t), SAMPLERATE);
+                }
+            }
+            float dry[4];
+            for (int j = 0; j < 4; j++)
+                s.dry[j] = dry[j] = Input(static_cast<Signal>(signal), i, j);
+            dsp.Process(s);
+            for (int j = 0; j < 4; j++)
+            {
+                r.out[signal][j][i] = dsp.wet[j];
+                lines[j]->Write(fir[j].ProcessSample(dry[j] + dsp.wet[j] * feedback));
+            }
+        }
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    r.us_per_block = seconds * 1e6 / (SIGNAL_LAST * N / BLOCK);
+}
+
+// In place radix 2 FFT
+static void Fft(std::vector<double> &re, std::vector<double> &im)
+{
+    const size_t n = re.size();
+    for (size_t i = 1, j = 0; i < n; i++)
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+        {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+    }
+    for (size_t len = 2; len <= n; len <<= 1)
+    {
+        const double a = -2.0 * M_PI / len;
+        for (size_t i = 0; i < n; i += len)
+            for (size_t k = 0; k < len / 2; k++)
+            {
+                const double wr = cos(a * k), wi = sin(a * k);
+                const size_t p = i + k, q = p + len / 2;
+                const double xr = re[q] * wr - im[q] * wi, xi = re[q] * wi + im[q] * wr;
+                re[q] = re[p] - xr;
+                im[q] = im[p] - xi;
+                re[p] += xr;
+                im[p] += xi;
+            }
+    }
+}
+
+/** Hann windowed energy per band in dB */
+static std::vector<double> Bands(const std::vector<float> &x)
+{
+    std::vector<double> re(x.size()), im(x.size(), 0.0);
+    for (size_t i = 0; i < x.size(); i++)
+        re[i] = x[i] * (0.5 - 0.5 * cos(2.0 * M_PI * i / x.size()));
+    Fft(re, im);
+    std::vector<double> bands(BANDS, 0.0);
+    for (size_t k = 1; k < x.size() / 2; k++)
+    {
+        const double f = k * SAMPLERATE / x.size();
+        const int b = static_cast<int>(floor(log(f / 40.0) / log(500.0) * BANDS));
+        if (b >= 0 && b < BANDS)
+            bands[b] += re[k] * re[k] + im[k] * im[k];
+    }
+    for (double &b : bands)
+        b = 10.0 * log10(b + 1e-30);
+    return bands;
+}
+
+static std::string GoldenPath(const char *name) { return std::string("fixtures/dsp/") + name + ".txt"; }
+
+static void WriteMode(int mode, const Render &r)
+{
+    FILE *f = std::fopen(GoldenPath(MODE_FILES[mode]).c_str(), "w");
+    std::fprintf(f, "# KaliDSP mode %d (%s), rendered by test_dsp_golden --update on the host.\n", mode, MODE_FILES[mode]);
+    std::fprintf(f, "# Inputs impulse, log sweep, noise and a synthesized clip, %zu samples each.\n", N);
+    std::fprintf(f, "# Rows: input channel start, then %zu output samples. bands: input channel,\n", WINDOW);
+    std::fprintf(f, "# then the output energy in dB of %d log bands from 40 Hz to 20 kHz.\n", BANDS);
+    if (mode == KaliDSP::Fluid)
+    {
+        std::fprintf(f, "# Fluid's targets come from KaliDSP's own xorshift (Random01, Seed(1) in\n");
+        std::fprintf(f, "# Init), not rand(); this is its output since that change.\n");
+    }
+    std::fprintf(f, "# us_per_block %.2f\n", r.us_per_block);
+    for (int signal = 0; signal < SIGNAL_LAST; signal++)
+        for (int j = 0; j < 4; j++)
+        {
+            std::fprintf(f, "# bands %d %d", signal, j);
+            for (double b : Bands(r.out[signal][j]))
+                std::fprintf(f, " %.3f", b);
+            std::fprintf(f, "\n");
+        }
+    for (int signal = 0; signal < SIGNAL_LAST; signal++)
+        for (int j = 0; j < 4; j++)
+            for (size_t start : WINDOW_STARTS)
+            {
+                std::fprintf(f, "%d %d %zu", signal, j, start);
+                for (size_t i = start; i < start + WINDOW; i++)
+                    std::fprintf(f, " %.9g", r.out[signal][j][i]);
+                std::fprintf(f, "\n");
+            }
+    std::fclose(f);
+}
+
+static void CheckMode(int mode, const Render &r)
+{
+    KaliFixture golden;
+    if (!golden.Load(GoldenPath(MODE_FILES[mode]).c_str()))
+        return;
+
+    double max_abs = 0;
+    size_t windows = 0;
+    for (const auto &row : golden.rows)
+    {
+        const int signal = static_cast<int>(row[0]), j = static_cast<int>(row[1]);
+        const size_t start = static_cast<size_t>(row[2]);
+        CHECK(row.size() == 3 + WINDOW && signal < SIGNAL_LAST && j < 4 && start + WINDOW <= N);
+        if (row.size() != 3 + WINDOW || signal >= SIGNAL_LAST || j >= 4 || start + WINDOW > N)
+            continue;
+        for (size_t i = 0; i < WINDOW; i++)
+            max_abs = std::max(max_abs, std::fabs(r.out[signal][j][start + i] - row[3 + i]));
+        windows++;
+    }
+
+    double band_err = 0;
+    size_t spectra = 0;
+    for (const auto &h : golden.headers)
+    {
+        if (h[0] != "bands" || h.size() != 3 + BANDS)
+            continue;
+        const int signal = std::atoi(h[1].c_str()), j = std::atoi(h[2].c_str());
+        const std::vector<double> bands = Bands(r.out[signal][j]);
+        double loudest = -1e30;
+        for (int b = 0; b < BANDS; b++)
+            loudest = std::max(loudest, std::strtod(h[3 + b].c_str(), nullptr));
+        for (int b = 0; b < BANDS; b++)
+        {
+            const double want = std::strtod(h[3 + b].c_str(), nullptr);
+            if (want > loudest - BAND_FLOOR_DB)
+                band_err = std::max(band_err, std::fabs(bands[b] - want));
+        }
+        spectra++;
+    }
+
+    CHECK(windows == SIGNAL_LAST * 4 * (sizeof(WINDOW_STARTS) / sizeof(WINDOW_STARTS[0])));
+    CHECK(spectra == SIGNAL_LAST * 4);
+    CHECK(max_abs <= MAX_ABS);
+    CHECK(band_err <= BAND_DB);
+    std::printf("  %-17s max err %.2g, bands %.3f dB; %6.2f us/block (golden %.2f)\n", MODE_FILES[mode], max_abs,
+                band_err, r.us_per_block, golden.Find("us_per_block", 0));
+}
+
+static void CheckRenders(bool update)
+{
+    static Render first, second;
+    for (int mode = 0; mode < KaliDSP::DSP_MODE_LAST; mode++)
+    {
+        RenderMode(mode, first);
+        for (int i = 0; i < 7777; i++)
+            (void)std::rand(); // the rest of the firmware drawing random numbers
+        RenderMode(mode, second);
+
+        bool same = true, finite = true;
+        for (int signal = 0; signal < SIGNAL_LAST; signal++)
+            for (int j = 0; j < 4; j++)
+            {
+                same = same && std::memcmp(first.out[signal][j].data(), second.out[signal][j].data(), N * sizeof(float)) == 0;
+                for (float x : first.out[signal][j])
+                    finite = finite && std::isfinite(x);
+            }
+        CHECK(same);
+        CHECK(finite);
+
+        if (update)
+            WriteMode(mode, first);
+        else
+            CheckMode(mode, first);
+    }
+}
+
+// Distortion algorithms 0..8 over an amount sweep, one row per algorithm and
+// amount: the output for inputs from -2 to 2.
+static const int AMOUNTS[] = {1, 10, 25, 50, 75, 100};
+static const int DIST_POINTS = 25;
+static const int DIST_ALGOS = 9;
+
+static float DistInput(int k) { return -2.f + 4.f * k / (DIST_POINTS - 1); }
+
+static void CheckDistortion(bool update)
+{
+    const std::string path = GoldenPath("distortion");
+    if (update)
+    {
+        FILE *f = std::fopen(path.c_str(), "w");
+        std::fprintf(f, "# KaliDSP::Distort, written by test_dsp_golden --update on the host.\n");
+        std::fprintf(f, "# Rows: algorithm amount, then the output for %d inputs from -2 to 2.\n", DIST_POINTS);
+        for (int algo = 0; algo < DIST_ALGOS; algo++)
+            for (int amount : AMOUNTS)
+            {
+                std::fprintf(f, "%d %d", algo, amount);
+                for (int k = 0; k < DIST_POINTS; k++)
+                    std::fprintf(f, " %.9g", KaliDSP::Distort(DistInput(k), algo, amount));
+                std::fprintf(f, "\n");
+            }
+        std::fclose(f);
+    }
+
+    KaliFixture golden;
+    if (!golden.Load(path.c_str()))
+        return;
+    CHECK(golden.rows.size() == DIST_ALGOS * sizeof(AMOUNTS) / sizeof(AMOUNTS[0]));
+    double max_abs = 0;
+    for (const auto &row : golden.rows)
+    {
+        CHECK(row.size() == 2 + DIST_POINTS);
+        if (row.size() != 2 + DIST_POINTS)
+            continue;
+        for (int k = 0; k < DIST_POINTS; k++)
+        {
+            const float y = KaliDSP::Distort(DistInput(k), static_cast<int>(row[0]), static_cast<int>(row[1]));
+            CHECK(std::isfinite(y));
+            max_abs = std::max(max_abs, std::fabs(y - row[2 + k]));
+        }
+    }
+    CHECK(max_abs <= 1e-6);
+
+    // an algorithm the option does not offer passes the signal through
+    CHECK(KaliDSP::Distort(0.3f, DIST_ALGOS, 50) == 0.3f);
+    std::printf("  distortion        max err %.2g\n", max_abs);
+}
+
+// OptimizedFIR: the impulse response at a spread of cutoffs against the
+// golden, plus what holds whatever the golden says: linear phase, unity gain
+// at DC down to 30 Hz, the extra cut below it, and no NaN reaching the
+// delay lines.
+static const float CUTOFFS[] = {10.f, 20.f, 29.f, 30.f, 100.f, 1000.f, 4000.f, 12000.f, 20000.f};
+static const int TAPS = 17;
+
+static std::vector<float> Taps(float cutoff)
+{
+    OptimizedFIR f;
+    f.Init();
+    f.UpdateFilter(cutoff, SAMPLERATE);
+    std::vector<float> h;
+    for (int i = 0; i < TAPS; i++)
+        h.push_back(f.ProcessSample(i == 0 ? 1.f : 0.f));
+    return h;
+}
+
+static void CheckFir(bool update)
+{
+    const std::string path = GoldenPath("fir");
+    if (update)
+    {
+        FILE *f = std::fopen(path.c_str(), "w");
+        std::fprintf(f, "# OptimizedFIR impulse responses, written by test_dsp_golden --update on the host.\n");
+        std::fprintf(f, "# Rows: cutoff in Hz at 48 kHz, then the %d taps.\n", TAPS);
+        for (float cutoff : CUTOFFS)
+        {
+            std::fprintf(f, "%g", cutoff);
+            for (float h : Taps(cutoff))
+                std::fprintf(f, " %.9g", h);
+            std::fprintf(f, "\n");
+        }
+        std::fclose(f);
+    }
+
+    KaliFixture golden;
+    if (!golden.Load(path.c_str()))
+        return;
+    CHECK(golden.rows.size() == sizeof(CUTOFFS) / sizeof(CUTOFFS[0]));
+    double max_abs = 0;
+    for (const auto &row : golden.rows)
+    {
+        CHECK(row.size() == 1 + TAPS);
+        if (row.size() != 1 + TAPS)
+            continue;
+        const float cutoff = static_cast<float>(row[0]);
+        const std::vector<float> h = Taps(cutoff);
+        double dc = 0;
+        for (int i = 0; i < TAPS; i++)
+        {
+            max_abs = std::max(max_abs, std::fabs(h[i] - row[1 + i]));
+            CHECK(std::fabs(h[i] - h[TAPS - 1 - i]) <= 1e-6f);
+            dc += h[i];
+        }
+        const double atten = cutoff < 30.f ? (cutoff - 10.0) / 20.0 : 1.0;
+        CHECK(std::fabs(dc - atten * atten) <= 1e-5);
+    }
+    CHECK(max_abs <= 1e-6);
+
+    // a NaN or infinity is dropped, and the line carries on with the rest
+    OptimizedFIR f;
+    f.Init();
+    f.UpdateFilter(1000.f, SAMPLERATE);
+    CHECK(f.ProcessSample(NAN) == 0.f);
+    CHECK(f.ProcessSample(INFINITY) == 0.f);
+    float y = 0;
+    for (int i = 0; i < 64; i++)
+        y = f.ProcessSample(1.f);
+    CHECK(std::fabs(y - 1.f) <= 1e-5f);
+    std::printf("  fir               max err %.2g\n", max_abs);
+}
+
+int main(int argc, char **argv)
+{
+    const bool update = argc > 1 && std::strcmp(argv[1], "--update") == 0;
+    for (int j = 0; j < 4; j++)
+        lines[j] = new KaliDelayLine<float, MAX_DELAY>;
+
+    std::printf("\n");
+    CheckRenders(update);
+    CheckDistortion(update);
+    CheckFir(update);
+    return TEST_RESULT();
+}
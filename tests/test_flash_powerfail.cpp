@@ -0,0 +1,292 @@
+// Power-fail test for the QSPI clients. A RAM NOR model follows the
+// KaliFlash contract (programs only clear bits, erases are started and
+// polled, the flash is busy for everyone while one runs) and cuts the power
+// after a random number of flash operations, tearing the one in flight.
+// The record store and a snapshot save share it, stepped in turn as the
+// main loop does. After every cut the store must mount with the old or a
+// new copy of each key, and the snapshot must be absent or restore exactly
+// as an uninterrupted save of the same lines does. Neither Step() may ever
+// wait on or be refused by the other client's erase.
+#include <map>
+#include <random>
+#include "KaliTest.h"
+#include "KaliRecordStore.h"
+#include "KaliSnapshot.h"
+
+struct PowerCut
+{
+};
+
+class Nor : public KaliFlash
+{
+public:
+    explicit Nor(uint32_t size, std::mt19937 *rng) : mem(size, 0xFF), rng_(rng) {}
+
+    const uint8_t *Data(uint32_t addr) override
+    {
+        Wait();
+        return &mem[addr];
+    }
+
+    bool Program(uint32_t addr, const uint8_t *data, uint32_t len) override
+    {
+        if (erasing_)
+        {
+            refused++;
+            return false;
+        }
+        Op(addr, len, false);
+        for (uint32_t i = 0; i < len; i++)
+            mem[addr + i] &= data[i];
+        return true;
+    }
+
+    bool EraseSector(uint32_t addr) override
+    {
+        Wait();
+        Op(addr, SECTOR_SIZE, true);
+        memset(&mem[addr], 0xFF, SECTOR_SIZE);
+        return true;
+    }
+
+    bool StartErase(uint32_t addr) override
+    {
+        if (erasing_)
+        {
+            refused++;
+            return false;
+        }
+        erasing_ = true;
+        erase_addr_ = addr;
+        polls_ = 2 + (*rng_)() % 6;
+        return true;
+    }
+
+    bool EraseBusy() override
+    {
+        if (!erasing_)
+            return false;
+        Op(erase_addr_, SECTOR_SIZE, true);
+        if (--polls_ > 0)
+            return true;
+        memset(&mem[erase_addr_], 0xFF, SECTOR_SIZE);
+        erasing_ = false;
+        return false;
+    }
+
+    void PowerOn()
+    {
+        cut_at = -1;
+        erasing_ = false;
+    }
+
+    std::vector<uint8_t> mem;
+    long ops = 0, cut_at = -1;
+    bool in_step = false; // set around the clients' Step()
+    uint32_t step_waits = 0, refused = 0;
+
+private:
+    void Wait()
+    {
+        if (erasing_ && in_step)
+            step_waits++;
+        while (EraseBusy())
+        {
+        }
+    }
+
+    // Counts an operation; at the cut it leaves the bytes half done
+    void Op(uint32_t addr, uint32_t len, bool erase)
+    {
+        if (cut_at < 0 || ++ops < cut_at)
+            return;
+        for (uint32_t i = 0; i < len; i++)
+            if ((*rng_)() & 1)
+                mem[addr + i] = erase ? (mem[addr + i] | (*rng_)()) : (mem[addr + i] & (*rng_)());
+        throw PowerCut();
+    }
+
+    bool erasing_ = false;
+    uint32_t erase_addr_ = 0;
+    int polls_ = 0;
+    std::mt19937 *rng_;
+};
+
+static const uint32_t STORE_SECTORS = 8;
+static const uint32_t SNAP_BASE = STORE_SECTORS * KaliFlash::SECTOR_SIZE;
+static const uint32_t SNAP_SIZE = 4 * KaliFlash::SECTOR_SIZE;
+static const uint32_t NOR_SIZE = SNAP_BASE + SNAP_SIZE;
+static const int LINES = 4;
+static const size_t LINE_SIZE = 4096;
+static const size_t FRAMES = 2048;
+static const int KEYS = 12;
+
+static uint8_t store_staging[32768];
+static uint8_t snap_staging[SNAP_SIZE];
+
+struct Lines
+{
+    std::vector<float> data[LINES];
+    float *ptr[LINES];
+    size_t bases[LINES];
+
+    Lines()
+    {
+        for (int i = 0; i < LINES; i++)
+        {
+            data[i].assign(LINE_SIZE, 0.f);
+            ptr[i] = data[i].data();
+            bases[i] = 0;
+        }
+    }
+
+    /** Noise and a sine, the right pair mirroring the left one on odd versions */
+    void Fill(int version)
+    {
+        std::mt19937 rng(version);
+        std::uniform_real_distribution<float> noise(-0.3f, 0.3f);
+        for (int i = 0; i < LINES; i++)
+        {
+            bases[i] = (version * 131 + i * 17) % LINE_SIZE;
+            for (size_t s = 0; s < LINE_SIZE; s++)
+                data[i][s] = (i >= 2 && version % 2) ? data[i - 2][s] : 0.5f * sinf(s * 0.01f * (i + version)) + noise(rng);
+        }
+    }
+};
+
+/** What a save of this version restores to with nothing going wrong */
+static Lines Reference(int version, std::mt19937 &rng)
+{
+    Lines in, out;
+    in.Fill(version);
+    Nor nor(NOR_SIZE, &rng);
+    KaliSnapshot snap;
+    snap.Init(&nor, SNAP_BASE, SNAP_SIZE, snap_staging, sizeof(snap_staging));
+    CHECK(snap.StartSave(in.ptr, in.bases, LINES, LINE_SIZE, FRAMES, 48000));
+    while (snap.GetState() != KaliSnapshot::IDLE)
+        snap.Step(true);
+    CHECK(snap.Valid());
+    KaliSnapshot again;
+    again.Init(&nor, SNAP_BASE, SNAP_SIZE, snap_staging, sizeof(snap_staging));
+    CHECK(again.StartRestore(out.ptr, out.bases, LINES, LINE_SIZE));
+    while (again.GetState() != KaliSnapshot::IDLE)
+        again.Step(false);
+    return out;
+}
+
+int main()
+{
+    std::mt19937 rng(38);
+    std::map<int, Lines> reference;
+    int cuts = 0, snapshots_valid = 0;
+    long erases = 0;
+    uint32_t step_waits = 0, refused = 0;
+
+    for (int trial = 0; trial < 1500; trial++)
+    {
+        Nor nor(NOR_SIZE, &rng);
+        std::map<int, std::vector<uint8_t>> committed;            // known flushed
+        std::map<int, std::vector<std::vector<uint8_t>>> pending; // every put since
+        KaliRecordStore store;
+        store.Init(&nor, 0, STORE_SECTORS, store_staging, sizeof(store_staging));
+        store.Mount();
+        KaliSnapshot snap;
+        snap.Init(&nor, SNAP_BASE, SNAP_SIZE, snap_staging, sizeof(snap_staging));
+        Lines lines;
+        std::vector<int> saved; // versions whose save completed, or was in progress at the cut
+        nor.cut_at = 50 + rng() % 5000;
+        try
+        {
+            for (int round = 0; round < 400; round++)
+            {
+                const int key = rng() % KEYS;
+                std::vector<uint8_t> v(16 + rng() % 600);
+                for (uint8_t &b : v)
+                    b = static_cast<uint8_t>(rng());
+                if (store.Put(key, v.data(), v.size()))
+                    pending[key].push_back(v);
+
+                if (round % 100 == 10 && snap.GetState() == KaliSnapshot::IDLE)
+                {
+                    const int version = trial * 4 + round / 100;
+                    lines.Fill(version);
+                    if (snap.StartSave(lines.ptr, lines.bases, LINES, LINE_SIZE, FRAMES, 48000))
+                        saved.push_back(version);
+                }
+
+                // The main loop: the store, then the snapshot, right after each other
+                for (int i = 0; i < 3; i++)
+                {
+                    nor.in_step = true;
+                    store.Step();
+                    snap.Step(true);
+                    nor.in_step = false;
+                }
+                if (!store.Busy())
+                {
+                    for (auto &p : pending)
+                        committed[p.first] = p.second.back();
+                    pending.clear();
+                }
+            }
+            store.Flush();
+            for (auto &p : pending)
+                committed[p.first] = p.second.back();
+            pending.clear();
+        }
+        catch (PowerCut &)
+        {
+            cuts++;
+        }
+        erases += store.sectors_erased;
+        step_waits += nor.step_waits;
+        refused += nor.refused;
+
+        // Power back on
+        nor.PowerOn();
+        KaliRecordStore again;
+        again.Init(&nor, 0, STORE_SECTORS, store_staging, sizeof(store_staging));
+        again.Mount();
+        for (int key = 0; key < KEYS; key++)
+        {
+            uint32_t len;
+            const uint8_t *d = again.Get(key, len);
+            const auto c = committed.find(key);
+            const auto p = pending.find(key);
+            bool ok = c != committed.end() ? (d && len == c->second.size() && !memcmp(d, c->second.data(), len))
+                                           : d == nullptr;
+            if (p != pending.end() && d)
+                for (const auto &v : p->second)
+                    ok |= len == v.size() && !memcmp(d, v.data(), len);
+            CHECK(ok);
+        }
+
+        KaliSnapshot snap_again;
+        snap_again.Init(&nor, SNAP_BASE, SNAP_SIZE, snap_staging, sizeof(snap_staging));
+        if (!snap_again.Valid())
+            continue;
+        snapshots_valid++;
+        Lines restored;
+        CHECK(snap_again.StartRestore(restored.ptr, restored.bases, LINES, LINE_SIZE));
+        while (snap_again.GetState() != KaliSnapshot::IDLE)
+            snap_again.Step(false);
+        bool matches = false;
+        for (int version : saved)
+        {
+            if (!reference.count(version))
+                reference[version] = Reference(version, rng);
+            bool same = true;
+            for (int i = 0; i < LINES; i++)
+                same &= restored.data[i] == reference[version].data[i];
+            matches |= same;
+        }
+        CHECK(matches);
+    }
+
+    std::printf("\n  1500 trials, %d power cuts, %ld sectors erased by the store, %d snapshots valid after the cut,"
+                "\n  %u waits and %u refusals inside Step()\n",
+                cuts, erases, snapshots_valid, step_waits, refused);
+    CHECK(step_waits == 0);
+    CHECK(refused == 0);
+    return TEST_RESULT();
+}
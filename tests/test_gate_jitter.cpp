@@ -0,0 +1,136 @@
+// Simulates a CV clock on gate 1 against the audio block timing and compares
+// where the clock edges land on the sample timeline: polled once per block
+// at sample 0 (the old GateIn::State() path), or stamped by KaliGateCapture
+// and placed inside the block through KaliTimebase.
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "KaliTest.h"
+#include "HostSystem.h"
+#include "HostPeripherals.h"
+#include "KaliGateCapture.h"
+#include "KaliTempoTracker.h"
+
+static const size_t BLOCK = 96;
+static const double CODEC_RATE = 48000.0 * (1.0 + 40e-6); // codec crystal 40 ppm off the CPU clock
+
+struct Timeline
+{
+    std::vector<double> error; // landed sample time minus edge time, seconds
+    std::vector<long> position;
+
+    double PeakToPeakUs() const
+    {
+        auto mm = std::minmax_element(error.begin(), error.end());
+        return (*mm.second - *mm.first) * 1e6;
+    }
+
+    /** RMS error of the tracked period, relative to the true one */
+    double TrackedPeriodError(double true_period) const
+    {
+        KaliTempoTracker tracker;
+        tracker.SetBandwidth(0.02f);
+        double sum_sq = 0.0;
+        int n = 0;
+        for (size_t i = 1; i < position.size(); i++)
+        {
+            tracker.Process(static_cast<float>(position[i] - position[i - 1]));
+            if (i < 32)
+                continue;
+            const double e = (tracker.GetPeriod() - true_period) / true_period;
+            sum_sq += e * e;
+            n++;
+        }
+        return std::sqrt(sum_sq / n);
+    }
+};
+
+static void SetTime(double seconds)
+{
+    host::SetTick(static_cast<uint32_t>(static_cast<uint64_t>(seconds * host::TICK_FREQ)));
+}
+
+static void Run(double bpm, double seconds, std::mt19937 &rng)
+{
+    const double period = 60.0 / (bpm * 4.0); // 4 PPQN
+    std::uniform_real_distribution<double> audio_irq_latency(0.0, 3e-6), exti_latency(0.0, 0.3e-6);
+    std::uniform_real_distribution<double> phase(0.0, period);
+
+    KaliTimebase timebase;
+    KaliGateCapture capture;
+    const dsy_gpio_pin gate1 = {DSY_GPIOG, 13};
+    SetTime(0.0);
+    timebase.Init(BLOCK);
+    capture.Init(gate1);
+
+    Timeline polled, stamped;
+    std::vector<double> pending_polled; // edges not yet seen by a block poll
+    std::vector<double> pending_stamped;
+
+    double edge = 0.01 + phase(rng);
+    for (long block = 1;; block++)
+    {
+        const double block_start = block * BLOCK / CODEC_RATE + audio_irq_latency(rng);
+        if (block_start > seconds)
+            break;
+
+        // Edges before this block's DMA interrupt
+        while (edge < block_start)
+        {
+            const double stamp = edge + exti_latency(rng);
+            SetTime(stamp);
+            host::exti_d1.PR1 = 1u << gate1.pin;
+            capture.OnInterrupt();
+            pending_polled.push_back(edge);
+            pending_stamped.push_back(edge);
+            edge += period;
+        }
+
+        SetTime(block_start);
+        timebase.BeginBlock(BLOCK);
+
+        // Old path: a rising State() is passed to the clock on sample 0
+        for (double e : pending_polled)
+        {
+            const long pos = block * static_cast<long>(BLOCK);
+            polled.position.push_back(pos);
+            polled.error.push_back(pos / CODEC_RATE - e);
+        }
+        pending_polled.clear();
+
+        uint8_t offsets[8];
+        const int n = capture.Collect(timebase, offsets, 8);
+        CHECK(n == static_cast<int>(pending_stamped.size()));
+        for (int i = 0; i < n && i < static_cast<int>(pending_stamped.size()); i++)
+        {
+            const long pos = block * static_cast<long>(BLOCK) + offsets[i];
+            stamped.position.push_back(pos);
+            stamped.error.push_back(pos / CODEC_RATE - pending_stamped[i]);
+        }
+        pending_stamped.clear();
+    }
+
+    const double true_period = period * CODEC_RATE;
+    const double one_sample_us = 1e6 / CODEC_RATE;
+    std::printf("\n  %6.1f bpm  edge jitter p-p: polled %7.1f us, stamped %5.1f us;"
+                "  tracked period rms error: polled %.4f%%, stamped %.4f%%",
+                bpm, polled.PeakToPeakUs(), stamped.PeakToPeakUs(),
+                polled.TrackedPeriodError(true_period) * 100.0, stamped.TrackedPeriodError(true_period) * 100.0);
+
+    CHECK(stamped.error.size() == polled.error.size());
+    CHECK(polled.PeakToPeakUs() > 0.9 * BLOCK * one_sample_us);
+    // Truncation to a whole sample plus the interrupt latencies
+    CHECK(stamped.PeakToPeakUs() < 1.5 * one_sample_us);
+    CHECK(stamped.TrackedPeriodError(true_period) < polled.TrackedPeriodError(true_period));
+}
+
+int main()
+{
+    std::mt19937 rng(31);
+    // Long enough that the 200 MHz tick wraps (every 21.5 s)
+    Run(120.0, 30.0, rng);
+    Run(133.7, 30.0, rng);
+    Run(171.3, 30.0, rng);
+    std::printf("\n");
+    return TEST_RESULT();
+}
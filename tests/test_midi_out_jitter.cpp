@@ -0,0 +1,193 @@
+// Runs KaliMIDIOut against a model of the H750's interrupt timing: audio
+// callbacks every 2 ms, short top priority interrupts (USB, MIDI in), the
+// TIM4 service every 125 us and a 31250 baud transmitter. MIDI clock is
+// scheduled from the end of each callback the way AudioCallback does it,
+// and every clock byte's lateness is measured at the data register write
+// (late_max_us) and at its start bit on the wire.
+#include <cmath>
+#include <deque>
+#include "KaliTest.h"
+#include "HostSystem.h"
+#include "HostPeripherals.h"
+#include "HostTimer.h"
+#include "KaliMIDIOut.h"
+
+static const int BLOCK_US = 2000;
+static const int SERVICE_US = 1000000 / KaliMIDIOut::SERVICE_HZ;
+static const int BYTE_US = 320;
+
+// Top priority interrupts besides TIM4: period, phase, duration (us)
+struct Noise
+{
+    int period, phase, duration;
+};
+static const Noise NOISE[] = {
+    {1000, 300, 8}, // USB SOF and endpoint handling
+    {640, 77, 2},   // MIDI in byte, UART RX
+};
+
+/** 31250 baud transmitter: shift register plus the TDR, no FIFO */
+struct Uart
+{
+    double busy_until = 0.0;
+    bool tdr_full = false;
+    uint8_t tdr = 0;
+    std::vector<std::pair<double, uint8_t>> started;
+
+    void Update(double t, USART_TypeDef &regs)
+    {
+        if (tdr_full && busy_until <= t)
+        {
+            started.push_back({busy_until, tdr});
+            busy_until += BYTE_US;
+            tdr_full = false;
+        }
+        regs.ISR = tdr_full ? 0 : USART_ISR_TXE_TXFNF;
+    }
+
+    void Write(double t, uint8_t byte)
+    {
+        if (busy_until <= t)
+        {
+            started.push_back({t, byte});
+            busy_until = t + BYTE_US;
+        }
+        else
+        {
+            tdr_full = true;
+            tdr = byte;
+        }
+    }
+};
+
+struct Result
+{
+    float late_max_us;  // as the firmware reports it
+    double wire_max_us; // start bit after the due time
+    uint32_t clocks;
+};
+
+static void SetTime(double us) { host::SetTick(static_cast<uint32_t>(static_cast<uint64_t>(us * (host::TICK_FREQ / 1e6)))); }
+
+/**
+ * @param callback_us audio callback duration
+ * @param timer_preempts_audio TIM4 above the audio DMA priority
+ * @param sysex keep a SysEx dump going from the main loop
+ */
+static Result Run(int callback_us, bool timer_preempts_audio, bool sysex, double bpm, int seconds)
+{
+    USART_TypeDef usart = {};
+    Uart uart;
+    KaliMIDIOut out;
+    SetTime(0.0);
+    out.Init(&usart);
+    out.ResetStats();
+
+    const double clock_period = 60e6 / (bpm * 24.0);
+    long next_clock = 0;
+    std::deque<double> clock_due; // due times of scheduled clocks, in order
+    double wire_max = 0.0;
+    uint32_t clocks = 0;
+    bool timer_pending = false;
+    size_t seen = 0;
+
+    uint8_t dump[200];
+    dump[0] = 0xF0;
+    for (size_t i = 1; i < sizeof(dump) - 1; i++)
+        dump[i] = i & 0x7F;
+    dump[sizeof(dump) - 1] = 0xF7;
+
+    for (int t = 0; t < seconds * 1000000; t++)
+    {
+        const int in_block = t % BLOCK_US;
+        const bool in_callback = in_block < callback_us;
+        bool top_busy = false;
+        for (const Noise &n : NOISE)
+            top_busy |= (t - n.phase) % n.period < n.duration && t >= n.phase;
+
+        // End of the callback: schedule the clocks due one block after it started
+        if (in_block == callback_us)
+        {
+            SetTime(t);
+            const double window_start = t - callback_us + BLOCK_US;
+            while (next_clock * clock_period < window_start + BLOCK_US)
+            {
+                const double due = next_clock * clock_period;
+                if (due >= window_start)
+                {
+                    CHECK(out.Schedule(static_cast<uint32_t>(static_cast<uint64_t>(due * (host::TICK_FREQ / 1e6))), 0xF8));
+                    clock_due.push_back(due);
+                }
+                next_clock++;
+            }
+            if (sysex && out.BulkIdle())
+                out.SendBulk(dump, sizeof(dump));
+        }
+
+        if (t % SERVICE_US == 37)
+            timer_pending = true; // update flag, several periods coalesce into one
+        const bool blocked = top_busy || (!timer_preempts_audio && in_callback);
+        uart.Update(t, usart);
+        if (timer_pending && !blocked)
+        {
+            timer_pending = false;
+            SetTime(t);
+            usart.TDR = 0x1FF;
+            host::FireTimer();
+            if (usart.TDR != 0x1FF)
+                uart.Write(t, static_cast<uint8_t>(usart.TDR));
+        }
+
+        for (; seen < uart.started.size(); seen++)
+        {
+            if (uart.started[seen].second != 0xF8)
+                continue;
+            const double late = uart.started[seen].first - clock_due.front();
+            clock_due.pop_front();
+            wire_max = std::fmax(wire_max, late);
+            clocks++;
+        }
+    }
+    CHECK(out.Dropped() == 0);
+    return {out.late_max_us, wire_max, clocks};
+}
+
+int main()
+{
+    // Top-priority interrupt time that can sit in front of one service pass
+    int noise_us = 0;
+    for (const Noise &n : NOISE)
+        noise_us += n.duration;
+
+    SetTime(0.0);
+    KaliMIDIOut probe;
+    USART_TypeDef usart = {};
+    probe.Init(&usart);
+    CHECK(host::Priority(TIM4_IRQn) == 0);
+
+    std::printf("\n  callback  TIM4 priority     sysex  clocks  late_max  wire_max");
+    for (int callback_us : {500, 1000, 1500, 1900})
+    {
+        for (bool preempt : {false, true})
+        {
+            for (bool sysex : {false, true})
+            {
+                const Result r = Run(callback_us, preempt, sysex, 137.0, 5);
+                std::printf("\n  %5d us  %-16s  %-5s  %6u  %5.0f us  %5.0f us", callback_us,
+                            preempt ? "0 (above audio)" : "0x0f (libDaisy)", sysex ? "yes" : "no",
+                            static_cast<unsigned>(r.clocks), r.late_max_us, r.wire_max_us);
+                CHECK(r.clocks > 0);
+                if (!preempt)
+                    continue;
+                // The bound: one service period plus the other top priority interrupts
+                CHECK(r.late_max_us <= SERVICE_US + noise_us + 1);
+                if (!sysex || callback_us <= BLOCK_US - static_cast<int>(KaliMIDIOut::BULK_GUARD_US))
+                    CHECK(r.wire_max_us <= SERVICE_US + noise_us + 1);
+                else
+                    CHECK(r.wire_max_us <= SERVICE_US + noise_us + 2 * BYTE_US);
+            }
+        }
+    }
+    std::printf("\n");
+    return TEST_RESULT();
+}
@@ -0,0 +1,130 @@
+// Replays TRS and USB byte streams into KaliMIDIBus, both at once and
+// interleaved by time, and checks every message, stamp and SysEx body that
+// comes out against the expectations in the stream files.
+#include <algorithm>
+#include "KaliTest.h"
+#include "KaliMIDIBus.h"
+
+static const uint32_t TICKS_PER_US = 200;
+
+struct Stream
+{
+    KaliMIDIBus::Source source;
+    KaliFixture fx;
+    std::vector<std::vector<double>> expect;
+    std::vector<std::vector<int>> expect_sysex;
+
+    bool Load(KaliMIDIBus::Source src, const char *path)
+    {
+        source = src;
+        if (!fx.Load(path))
+            return false;
+        for (const auto &h : fx.headers)
+        {
+            if (h[0] == "expect" && h.size() == 5)
+                expect.push_back({std::strtod(h[1].c_str(), nullptr), std::strtod(h[2].c_str(), nullptr),
+                                  std::strtod(h[3].c_str(), nullptr), std::strtod(h[4].c_str(), nullptr)});
+            if (h[0] == "expect-sysex")
+            {
+                std::vector<int> body;
+                for (size_t i = 1; i < h.size(); i++)
+                    body.push_back(std::atoi(h[i].c_str()));
+                expect_sysex.push_back(body);
+            }
+        }
+        return true;
+    }
+};
+
+static void Check(KaliMIDIBus &bus, const std::vector<Stream *> &streams)
+{
+    size_t seen[KaliMIDIBus::SOURCE_LAST] = {0};
+    const KaliMidiMessage *m;
+    for (; (m = bus.queue.Peek()) != nullptr; bus.queue.Drop())
+    {
+        const Stream *s = nullptr;
+        for (const Stream *st : streams)
+            if (st->source == m->source)
+                s = st;
+        CHECK(s && seen[m->source] < s->expect.size());
+        if (!s || seen[m->source] >= s->expect.size())
+            continue;
+        const auto &e = s->expect[seen[m->source]++];
+        CHECK(m->tick == static_cast<uint32_t>(e[0]) * TICKS_PER_US);
+        CHECK(m->status == e[1]);
+        CHECK(m->data[0] == e[2]);
+        CHECK(m->data[1] == e[3]);
+    }
+    for (const Stream *s : streams)
+        CHECK(seen[s->source] == s->expect.size());
+}
+
+/** Feeds the streams merged by time, leaving everything queued on the bus */
+static void Replay(KaliMIDIBus &bus, std::vector<Stream *> streams)
+{
+    struct Byte
+    {
+        double time;
+        int stream;
+        uint8_t value;
+    };
+    std::vector<Byte> bytes;
+    for (size_t i = 0; i < streams.size(); i++)
+        for (const auto &row : streams[i]->fx.rows)
+            bytes.push_back({row[0], static_cast<int>(i), static_cast<uint8_t>(row[1])});
+    std::stable_sort(bytes.begin(), bytes.end(), [](const Byte &a, const Byte &b) { return a.time < b.time; });
+
+    bus.Init();
+    for (const Byte &b : bytes)
+        bus.Feed(streams[b.stream]->source, b.value, static_cast<uint32_t>(b.time) * TICKS_PER_US);
+    CHECK(bus.queue.Dropped() == 0);
+}
+
+static void CheckSysex(KaliMIDIBus &bus, const std::vector<Stream *> &streams)
+{
+    size_t seen[KaliMIDIBus::SOURCE_LAST] = {0};
+    KaliSysexPacket p;
+    while (bus.sysex_queue.Pop(p))
+    {
+        const Stream *s = nullptr;
+        for (const Stream *st : streams)
+            if (st->source == p.source)
+                s = st;
+        CHECK(s && seen[p.source] < s->expect_sysex.size());
+        if (!s || seen[p.source] >= s->expect_sysex.size())
+            continue;
+        const auto &body = s->expect_sysex[seen[p.source]++];
+        CHECK(p.length == body.size());
+        for (size_t i = 0; i < body.size() && i < p.length; i++)
+            CHECK(p.data[i] == body[i]);
+    }
+    for (const Stream *s : streams)
+        CHECK(seen[s->source] == s->expect_sysex.size());
+}
+
+int main()
+{
+    static Stream trs, usb;
+    trs.Load(KaliMIDIBus::SOURCE_UART, "fixtures/midi/trs.txt");
+    usb.Load(KaliMIDIBus::SOURCE_USB, "fixtures/midi/usb.txt");
+
+    static KaliMIDIBus bus;
+
+    // Each on its own
+    for (Stream *s : {&trs, &usb})
+    {
+        Replay(bus, {s});
+        CHECK(bus.bytes_received[s->source] == s->fx.rows.size());
+        Check(bus, {s});
+        CheckSysex(bus, {s});
+    }
+
+    // Both at once: a USB burst in the middle of a TRS message must not disturb it
+    Replay(bus, {&trs, &usb});
+    CHECK(bus.queue.Size() == trs.expect.size() + usb.expect.size());
+    Check(bus, {&trs, &usb});
+    CheckSysex(bus, {&trs, &usb});
+
+    std::printf("%zu TRS and %zu USB messages ", trs.expect.size(), usb.expect.size());
+    return TEST_RESULT();
+}
@@ -0,0 +1,178 @@
+// KaliOledDriver against libDaisy's blocking SSD130x I2C driver, each on a
+// timed 1 MHz bus with an SSD1306 RAM model behind it. Both draw the same
+// 30 fps sequence of screens. After every frame the two controllers' RAM
+// must match; the test counts the bytes each puts on the wire and how long
+// Update() keeps the main loop.
+#include "KaliTest.h"
+#include "HostI2C.h"
+#include "HostSystem.h"
+#include "dev/oled_ssd130x.h"
+#include "KaliOledDriver.h"
+
+using namespace daisy;
+
+using KaliDisplay = OledDisplay<KaliOledDriver<I2CHandle>>;
+using StockDisplay = OledDisplay<SSD130xI2c128x32Driver>;
+
+static uint8_t oled_dma[KaliOledDriver<I2CHandle>::DMA_BUFFER_SIZE];
+static KaliDisplay kali;
+static StockDisplay stock;
+static host::Ssd1306 kali_glass, stock_glass;
+
+static const double FRAME_US = 1e6 / 30;
+
+enum Scene
+{
+    METERS,   // static text, the VU meters moving
+    KNOB,     // a value being turned, meters moving
+    SILENCE,  // nothing moves
+    SPECTRUM, // every column changes every frame
+    NUM_SCENES
+};
+
+static const char *scene_names[NUM_SCENES] = {"meters", "knob", "silence", "spectrum"};
+
+template <typename Display>
+static void Draw(Display &d, Scene scene, int frame)
+{
+    d.Fill(false);
+    const int level_l = scene == SILENCE ? 0 : static_cast<int>(40 + 38 * sinf(frame * 0.31f));
+    const int level_r = scene == SILENCE ? 0 : static_cast<int>(40 + 38 * sinf(frame * 0.23f + 1.f));
+    if (level_l > 0)
+        d.DrawRect(0, 0, level_l, 2, true, true);
+    if (level_r > 0)
+        d.DrawRect(0, 4, level_r, 6, true, true);
+
+    if (scene == SPECTRUM)
+    {
+        for (int x = 0; x < 128; x += 4)
+        {
+            const int h = 4 + static_cast<int>(10 + 9 * sinf(x * 0.2f + frame * 0.7f));
+            d.DrawRect(x, 31 - h, x + 2, 31, true, true);
+        }
+        return;
+    }
+    d.SetCursor(0, 12);
+    d.WriteString("Delay Time", Font_6x8, true);
+    char value[16];
+    snprintf(value, sizeof(value), "%4d ms", scene == KNOB ? 250 + frame * 3 : 250);
+    d.SetCursor(0, 22);
+    d.WriteString(value, Font_6x8, true);
+}
+
+static bool SameGlass()
+{
+    return memcmp(kali_glass.ram, stock_glass.ram, sizeof(kali_glass.ram)) == 0 &&
+           kali_glass.contrast == stock_glass.contrast;
+}
+
+struct Totals
+{
+    int frames = 0;
+    uint64_t kali_bytes = 0, stock_bytes = 0;
+    double kali_blocked_us = 0, stock_blocked_us = 0;
+};
+
+int main()
+{
+    KaliDisplay::Config kali_cfg;
+    kali_cfg.driver_config.transport_config.i2c_config.periph = I2CHandle::Config::Peripheral::I2C_1;
+    kali_cfg.driver_config.transport_config.i2c_config.speed = I2CHandle::Config::Speed::I2C_1MHZ;
+    kali_cfg.driver_config.transport_config.i2c_config.mode = I2CHandle::Config::Mode::I2C_MASTER;
+    kali_cfg.driver_config.transport_config.i2c_address = 0x3C;
+    kali_cfg.driver_config.transport_config.dma_buffer = oled_dma;
+    StockDisplay::Config stock_cfg;
+    stock_cfg.driver_config.transport_config.i2c_config.periph = I2CHandle::Config::Peripheral::I2C_2;
+    stock_cfg.driver_config.transport_config.i2c_config.speed = I2CHandle::Config::Speed::I2C_1MHZ;
+    stock_cfg.driver_config.transport_config.i2c_config.mode = I2CHandle::Config::Mode::I2C_MASTER;
+    stock_cfg.driver_config.transport_config.i2c_address = 0x3C;
+
+    host::I2CBus &kali_bus = host::Bus(I2CHandle::Config::Peripheral::I2C_1);
+    host::I2CBus &stock_bus = host::Bus(I2CHandle::Config::Peripheral::I2C_2);
+    kali_bus.device[0x3C] = &kali_glass;
+    stock_bus.device[0x3C] = &stock_glass;
+    kali.Init(kali_cfg);
+    stock.Init(stock_cfg);
+    KaliOledDriver<I2CHandle> &driver = kali.GetDriver();
+
+    const Scene script[] = {METERS, KNOB, SILENCE, METERS, SPECTRUM};
+    Totals totals[NUM_SCENES];
+    int frame = 0;
+    uint32_t glass_mismatches = 0, static_bytes = 0, blocked = 0;
+    for (Scene scene : script)
+    {
+        for (int i = 0; i < 60; i++, frame++)
+        {
+            Draw(kali, scene, frame);
+            Draw(stock, scene, frame);
+            if (frame == 200)
+            {
+                kali.GetDriver().SetContrast(0x20);
+                uint8_t contrast[2][2] = {{0x00, 0x81}, {0x00, 0x20}};
+                I2CHandle stock_i2c;
+                stock_i2c.Init(stock_cfg.driver_config.transport_config.i2c_config);
+                stock_i2c.TransmitBlocking(0x3C, contrast[0], 2, 1000);
+                stock_i2c.TransmitBlocking(0x3C, contrast[1], 2, 1000);
+            }
+            if (frame == 250)
+                kali_bus.fail_next = true;
+
+            const uint32_t kali_bytes = kali_bus.bytes;
+            const uint32_t stock_bytes = stock_bus.bytes;
+            uint32_t t = host::Tick();
+            stock.Update();
+            const double stock_us = (host::Tick() - t) / (host::TICK_FREQ / 1e6);
+            t = host::Tick();
+            kali.Update();
+            const double kali_us = (host::Tick() - t) / (host::TICK_FREQ / 1e6);
+            blocked += host::Tick() != t;
+
+            if (frame == 270)
+            {
+                // The loop comes round again before the frame is out
+                host::RunI2C(100);
+                Draw(kali, METERS, frame + 1000);
+                CHECK(!kali.GetDriver().Update());
+            }
+            host::RunI2C(FRAME_US - stock_us);
+
+            Totals &s = totals[scene];
+            s.frames++;
+            s.kali_bytes += kali_bus.bytes - kali_bytes;
+            s.stock_bytes += stock_bus.bytes - stock_bytes;
+            s.kali_blocked_us += kali_us;
+            s.stock_blocked_us += stock_us;
+            if (scene == SILENCE && i > 0)
+                static_bytes += kali_bus.bytes - kali_bytes;
+            if (frame == 250)
+                CHECK(driver.errors == 1);
+            if (frame == 251)
+                CHECK(kali_bus.bytes - kali_bytes == 4 * (1 + driver.PAGE_BYTES)); // whole screen again
+            if (frame == 250 || frame == 270)
+                continue; // the glass is behind until the next frame
+            glass_mismatches += !SameGlass();
+        }
+    }
+
+    std::printf("\n  scene     frames  bytes/frame kali  stock   main loop blocked/frame kali  stock\n");
+    for (int s = 0; s < NUM_SCENES; s++)
+    {
+        const Totals &t = totals[s];
+        std::printf("  %-9s %6d  %16.0f %6.0f   %27.1f us %6.0f us\n", scene_names[s], t.frames,
+                    t.kali_bytes / double(t.frames), t.stock_bytes / double(t.frames),
+                    t.kali_blocked_us / t.frames, t.stock_blocked_us / t.frames);
+    }
+    std::printf("  %u frames sent, %u skipped, %u errors; bus busy %.1f%% (kali) vs %.1f%% (stock)\n",
+                driver.frames, driver.skipped, driver.errors,
+                100.0 * kali_bus.busy_ticks / host::Tick(), 100.0 * stock_bus.busy_ticks / host::Tick());
+
+    CHECK(glass_mismatches == 0);
+    CHECK(static_bytes == 0);
+    CHECK(blocked == 0);
+    CHECK(driver.skipped == 1);
+    CHECK(driver.errors == 1);
+    CHECK(kali_glass.contrast == 0x20);
+    // Meters only touch the top page
+    CHECK(totals[METERS].kali_bytes <= totals[METERS].frames * (1 + driver.PAGE_BYTES) + 4 * (1 + driver.PAGE_BYTES));
+    return TEST_RESULT();
+}
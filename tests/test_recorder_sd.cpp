@@ -0,0 +1,148 @@
+// KaliRecorder with daisy::WavWriter and libDaisy's FatFs on a disk image.
+// The audio side pushes 96 frame blocks of a known signal; the main loop
+// calls Service() every few blocks. Afterwards the volume is mounted again
+// and the file read back: the header must agree with the data, every block
+// that was not counted as an overrun must be there in order, exactly as
+// WavWriter converts it, and the tail must be silence padding.
+#include "KaliTest.h"
+#include "HostDisk.h"
+#include "daisy_core.h"
+#include "util/wav_format.h"
+#include "util/WavWriter.h"
+#include "KaliRecorder.h"
+
+using namespace daisy;
+
+static const size_t TRANSFER = 16384; // Kali::RECORD_TRANSFER
+static const size_t BLOCK = 96;
+static const float SAMPLERATE = 48000.f;
+// A sparse 4 GB image formatted like an SD card: FAT32, 32 KB clusters
+static const uint32_t IMAGE_SECTORS = 8u << 20;
+static const uint32_t CLUSTER = 32768;
+
+// The firmware's FIFO is 1 << 18 floats; a smaller one overruns within a
+// short run when the main loop is too slow.
+static float fifo[1 << 15];
+static KaliRecorder<WavWriter<TRANSFER>> recorder; // static: WavWriter leaves its write pointer to zero-init
+static FATFS fs;
+static char path[4];
+static uint8_t work[4096];
+
+static float Signal(uint32_t n, int c)
+{
+    // Every sample different from its neighbours and from the other channels
+    return static_cast<float>(static_cast<int>((n * 37 + c * 9001) % 60001) - 30000) / 32768.f;
+}
+
+struct Run
+{
+    const char *name;
+    bool with_input;
+    int service_every; // blocks per main loop pass
+    bool expect_overruns;
+};
+
+static void Record(const Run &run)
+{
+    const int channels = run.with_input ? 4 : 2;
+    char file[16];
+    std::snprintf(file, sizeof(file), "%s.WAV", run.name);
+    CHECK(recorder.Start(file, run.with_input));
+
+    std::vector<int16_t> expected;
+    const uint32_t blocks = static_cast<uint32_t>(10 * SAMPLERATE) / BLOCK;
+    std::vector<float> buf[4];
+    for (auto &b : buf)
+        b.resize(BLOCK);
+    const float *in[2] = {buf[2].data(), buf[3].data()};
+    const float *out[2] = {buf[0].data(), buf[1].data()};
+    const host::DiskStats before = host::disk_stats;
+
+    for (uint32_t b = 0; b < blocks; b++)
+    {
+        for (size_t i = 0; i < BLOCK; i++)
+            for (int c = 0; c < 4; c++)
+                buf[c][i] = Signal(b * BLOCK + i, c);
+        const uint32_t overruns = recorder.overruns;
+        recorder.Push(in, out, BLOCK);
+        if (recorder.overruns == overruns)
+            for (size_t i = 0; i < BLOCK; i++)
+                for (int c = 0; c < channels; c++)
+                    expected.push_back(f2s16(buf[c][i]));
+        if ((b + 1) % run.service_every == 0)
+            recorder.Service();
+    }
+    recorder.Stop();
+    for (int guard = 0; guard < 100000 && recorder.Recording(); guard++)
+        recorder.Service();
+    CHECK(!recorder.Recording());
+    CHECK(recorder.frames_written * channels == expected.size());
+    CHECK((recorder.overruns > 0) == run.expect_overruns);
+    const uint32_t writes = host::disk_stats.writes - before.writes;
+    const uint32_t sectors = host::disk_stats.sectors - before.sectors;
+
+    // Mount again and read the file back
+    CHECK(f_mount(&fs, path, 1) == FR_OK);
+    FIL f;
+    CHECK(f_open(&f, file, FA_READ) == FR_OK);
+    WAV_FormatTypeDef header;
+    UINT got = 0;
+    CHECK(f_read(&f, &header, sizeof(header), &got) == FR_OK && got == sizeof(header));
+    CHECK(header.ChunkId == kWavFileChunkId && header.SubChunk2ID == kWavFileSubChunk2Id);
+    CHECK(header.NbrChannels == channels && header.BitPerSample == 16 && header.SampleRate == 48000);
+    CHECK(header.SubCHunk2Size == f_size(&f) - sizeof(header));
+    CHECK(header.FileSize == f_size(&f) - 8);
+    const size_t samples = header.SubCHunk2Size / 2;
+    CHECK(samples % (TRANSFER / 2) == 0); // whole transfers only
+    std::vector<int16_t> data(samples);
+    CHECK(f_read(&f, data.data(), samples * 2, &got) == FR_OK && got == samples * 2);
+    f_close(&f);
+
+    size_t mismatches = 0, padding_errors = 0;
+    for (size_t i = 0; i < samples; i++)
+    {
+        if (i < expected.size())
+            mismatches += data[i] != expected[i];
+        else
+            padding_errors += data[i] != 0;
+    }
+    CHECK(samples >= expected.size() && samples - expected.size() < TRANSFER / 2);
+    CHECK(mismatches == 0);
+    CHECK(padding_errors == 0);
+
+    // The 44 byte header leaves each transfer one sector off alignment, so
+    // FatFs writes it as 31 sectors straight through plus one from its
+    // sector buffer; a few more for the FAT and directory when closing
+    const uint32_t transfers = samples * 2 / TRANSFER;
+    CHECK(writes <= 2 * transfers + 8);
+
+    std::printf("\n  %-5s %d ch, Service() every %2d blocks: %6u frames + %4zu padding, %4u blocks dropped, "
+                "FIFO peak %5u floats, %4u card writes (%u sectors, %.2f per transfer)",
+                run.name, channels, run.service_every, recorder.frames_written,
+                (samples - expected.size()) / channels, recorder.overruns, recorder.fifo_peak, writes, sectors,
+                writes / (samples * 2.0 / TRANSFER));
+}
+
+int main()
+{
+    CHECK(host::DiskOpen("build/sdcard.img", IMAGE_SECTORS));
+    CHECK(FATFS_LinkDriver(&host::disk_driver, path) == 0);
+    CHECK(f_mkfs(path, FM_FAT32, CLUSTER, work, sizeof(work)) == FR_OK);
+    CHECK(f_mount(&fs, path, 1) == FR_OK);
+    recorder.Init(fifo, sizeof(fifo) / sizeof(fifo[0]), SAMPLERATE, TRANSFER);
+
+    const Run runs[] = {
+        {"OUT", false, 1, false},
+        {"OUTIN", true, 1, false},
+        {"SLOW", true, 8, false},
+        {"STALL", true, 40, true},
+    };
+    for (const Run &run : runs)
+        Record(run);
+    std::printf("\n  largest card write %u sectors\n", host::disk_stats.largest);
+    CHECK(host::disk_stats.largest == TRANSFER / 512 - 1);
+
+    FATFS_UnLinkDriver(path);
+    host::DiskClose();
+    return TEST_RESULT();
+}
@@ -0,0 +1,196 @@
+// Round-trips sections of random data through the SysEx dump protocol:
+// encoded as the firmware sends them (BEGIN, DATA chunks, END), carried
+// over USB-MIDI event packets to a host-side parser, or over TRS into
+// KaliMIDIBus, then decoded and reassembled with the sequence and checksum
+// checks a receiver makes.
+#include <random>
+#include "KaliTest.h"
+#include "KaliSysex.h"
+#include "KaliMIDIBus.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+/** The dump side: every message for one section, F0 to F7 */
+static std::vector<Bytes> EncodeSection(uint8_t section, const Bytes &data)
+{
+    std::vector<Bytes> out;
+    uint8_t msg[KaliSysex::MAX_MESSAGE];
+    out.push_back(Bytes(msg, msg + KaliSysex::EncodeWord(msg, KaliSysex::BEGIN, section, data.size())));
+    uint32_t checksum = KaliSysex::CHECKSUM_INIT;
+    uint16_t seq = 0;
+    for (size_t offset = 0; offset < data.size(); offset += KaliSysex::CHUNK, seq++)
+    {
+        const size_t chunk = std::min(KaliSysex::CHUNK, data.size() - offset);
+        out.push_back(Bytes(msg, msg + KaliSysex::Encode(msg, KaliSysex::DATA, section, seq, &data[offset], chunk)));
+        KaliSysex::Checksum(checksum, &data[offset], chunk);
+    }
+    out.push_back(Bytes(msg, msg + KaliSysex::EncodeWord(msg, KaliSysex::END, section, checksum)));
+    return out;
+}
+
+/** The restore side: decode in order, as HandleSysex() does, and rebuild the section */
+static bool DecodeSection(const std::vector<Bytes> &messages, uint8_t section, Bytes &data)
+{
+    uint32_t size = 0, checksum = KaliSysex::CHECKSUM_INIT;
+    uint16_t seq = 0;
+    bool begun = false;
+    for (const Bytes &m : messages)
+    {
+        KaliSysex::Header h;
+        uint8_t payload[KaliSysex::CHUNK];
+        size_t len = 0;
+        if (KaliSysex::Decode(m.data(), m.size(), h, payload, len) != KaliSysex::OK || h.section != section)
+            return false;
+        if (h.command == KaliSysex::BEGIN && len == 4)
+        {
+            size = KaliSysex::ReadWord(payload);
+            data.clear();
+            begun = true;
+        }
+        else if (h.command == KaliSysex::DATA && begun)
+        {
+            if (h.seq != seq++ || data.size() + len > size)
+                return false;
+            data.insert(data.end(), payload, payload + len);
+            KaliSysex::Checksum(checksum, payload, len);
+        }
+        else if (h.command == KaliSysex::END && len == 4)
+            return begun && data.size() == size && KaliSysex::ReadWord(payload) == checksum;
+        else
+            return false;
+    }
+    return false;
+}
+
+/**
+ * @brief A host's USB-MIDI SysEx reassembly, strict about the code index numbers
+ *
+ * CIN 0x4 starts or continues a message, 0x5-0x7 end it with 1-3 bytes
+ * and the last of them must be F7. Anything else mid-message is an error.
+ */
+static bool FromUsbPackets(const uint8_t *p, size_t len, std::vector<Bytes> &messages)
+{
+    if (len % 4)
+        return false;
+    Bytes current;
+    for (size_t i = 0; i < len; i += 4)
+    {
+        const uint8_t cin = p[i] & 0x0F;
+        if (cin < 0x4 || cin > 0x7 || (p[i] >> 4) != 0)
+            return false;
+        const size_t count = cin == 0x4 ? 3 : cin - 0x4;
+        if (current.empty() && p[i + 1] != 0xF0)
+            return false;
+        for (size_t j = 0; j < count; j++)
+        {
+            const uint8_t b = p[i + 1 + j];
+            const bool last = cin != 0x4 && j == count - 1;
+            if ((b == 0xF7) != last || (b & 0x80 && b != 0xF7 && !(current.empty() && j == 0)))
+                return false;
+            current.push_back(b);
+        }
+        for (size_t j = count; j < 3; j++)
+            if (p[i + 1 + j] != 0)
+                return false;
+        if (cin != 0x4)
+        {
+            messages.push_back(current);
+            current.clear();
+        }
+    }
+    return current.empty();
+}
+
+static void CheckPacketizer()
+{
+    uint8_t msg[KaliSysex::MAX_MESSAGE];
+    uint8_t packets[KaliSysex::MAX_USB];
+    for (size_t len = 2; len <= KaliSysex::MAX_MESSAGE; len++)
+    {
+        msg[0] = 0xF0;
+        for (size_t i = 1; i < len - 1; i++)
+            msg[i] = i & 0x7F;
+        msg[len - 1] = 0xF7;
+        const size_t n = KaliSysex::ToUsbPackets(msg, len, packets);
+        CHECK(n == (len + 2) / 3 * 4);
+        CHECK(n <= KaliSysex::MAX_USB);
+        std::vector<Bytes> back;
+        CHECK(FromUsbPackets(packets, n, back));
+        CHECK(back.size() == 1 && back[0] == Bytes(msg, msg + len));
+    }
+}
+
+static void RoundTrip(std::mt19937 &rng, uint8_t section, size_t size)
+{
+    Bytes data(size);
+    for (uint8_t &b : data)
+        b = static_cast<uint8_t>(rng());
+    const std::vector<Bytes> sent = EncodeSection(section, data);
+
+    // Device to host over USB, one transfer per message like Kali::SendSysex()
+    std::vector<Bytes> over_usb;
+    for (const Bytes &m : sent)
+    {
+        CHECK(m.size() <= KaliSysex::MAX_MESSAGE);
+        uint8_t packets[KaliSysex::MAX_USB];
+        const size_t n = KaliSysex::ToUsbPackets(m.data(), m.size(), packets);
+        CHECK(FromUsbPackets(packets, n, over_usb));
+    }
+    Bytes usb_data;
+    CHECK(DecodeSection(over_usb, section, usb_data));
+    CHECK(usb_data == data);
+
+    // Host to device over TRS, with clock bytes interleaved, into the parser
+    KaliMIDIBus bus;
+    bus.Init();
+    std::vector<Bytes> over_trs;
+    for (const Bytes &m : sent)
+    {
+        for (size_t i = 0; i < m.size(); i++)
+        {
+            bus.Feed(KaliMIDIBus::SOURCE_UART, m[i], 0);
+            if (i % 17 == 5)
+                bus.Feed(KaliMIDIBus::SOURCE_UART, 0xF8, 0);
+        }
+        KaliSysexPacket p;
+        CHECK(bus.sysex_queue.Pop(p));
+        over_trs.push_back(Bytes(p.data, p.data + p.length));
+    }
+    Bytes trs_data;
+    CHECK(DecodeSection(over_trs, section, trs_data));
+    CHECK(trs_data == data);
+
+    if (sent.size() < 4)
+        return;
+
+    // A flipped bit fails the message checksum
+    std::vector<Bytes> corrupt = sent;
+    corrupt[1][KaliSysex::HEADER + 3] ^= 0x01;
+    CHECK(!DecodeSection(corrupt, section, trs_data));
+
+    // Swapped chunks fail the sequence check, and with renumbered sequences the section checksum
+    std::vector<Bytes> swapped = sent;
+    std::swap(swapped[1], swapped[2]);
+    CHECK(!DecodeSection(swapped, section, trs_data));
+    uint8_t msg[KaliSysex::MAX_MESSAGE];
+    KaliSysex::Header h;
+    uint8_t payload[KaliSysex::CHUNK];
+    size_t len = 0;
+    for (int i = 1; i <= 2; i++)
+    {
+        KaliSysex::Decode(swapped[i].data(), swapped[i].size(), h, payload, len);
+        swapped[i] = Bytes(msg, msg + KaliSysex::Encode(msg, KaliSysex::DATA, section, i - 1, payload, len));
+    }
+    CHECK(!DecodeSection(swapped, section, trs_data));
+}
+
+int main()
+{
+    CheckPacketizer();
+    std::mt19937 rng(36);
+    const size_t sizes[] = {1, 7, 63, 64, 65, 128, 1000, 2976};
+    for (size_t size : sizes)
+        RoundTrip(rng, 1 + size % 32, size);
+    RoundTrip(rng, KaliSysex::SECTION_CONFIG, 777);
+    return TEST_RESULT();
+}
@@ -0,0 +1,76 @@
+// Feeds recorded clock streams through KaliTempoTracker the way KaliClock
+// does (integer sample counts between pulses) and checks the period estimate
+// against the tempo the stream was played at.
+#include <cmath>
+#include "KaliTest.h"
+#include "KaliTempoTracker.h"
+
+static const double SAMPLE_RATE = 48000.0;
+
+static void CheckStream(const char *path)
+{
+    KaliFixture fx;
+    if (!fx.Load(path))
+        return;
+
+    const double ppqn = fx.Find("ppqn", 1);
+    const double tolerance = fx.Find("tolerance", 0.005);
+    const int settle = static_cast<int>(fx.Find("settle", 2 * ppqn));
+
+    // True pulse period from each tempo change on
+    std::vector<double> change_at, period_at;
+    for (const auto &h : fx.headers)
+        if (h[0] == "tempo" && h.size() == 3)
+        {
+            change_at.push_back(std::strtod(h[1].c_str(), nullptr));
+            period_at.push_back(SAMPLE_RATE * 60.0 / (std::strtod(h[2].c_str(), nullptr) * ppqn));
+        }
+    CHECK(!change_at.empty());
+
+    KaliTempoTracker tracker;
+    tracker.SetBandwidth(0.02f); // Clock Tracking BW default
+
+    double max_error = 0.0, sum_sq = 0.0;
+    int checked = 0, since_change = 0;
+    size_t segment = 0;
+    long last = -1;
+    for (const auto &row : fx.rows)
+    {
+        const long t = static_cast<long>(row[0]);
+        if (segment + 1 < change_at.size() && t >= change_at[segment + 1])
+        {
+            segment++;
+            since_change = 0;
+        }
+        since_change++;
+        if (last >= 0)
+            tracker.Process(static_cast<float>(t - last));
+        last = t;
+
+        if (since_change <= settle || !tracker.IsLocked())
+            continue;
+        const double error = std::fabs(tracker.GetPeriod() - period_at[segment]) / period_at[segment];
+        if (error > max_error)
+            max_error = error;
+        sum_sq += error * error;
+        checked++;
+    }
+
+    std::printf("\n  %-28s %4d pulses, max %.3f%% rms %.3f%% (limit %.2f%%), jitter %.1f smp, %u rejected, %u relocks",
+                path + std::string(path).rfind('/') + 1, checked, max_error * 100.0,
+                std::sqrt(sum_sq / (checked ? checked : 1)) * 100.0, tolerance * 100.0,
+                tracker.GetJitter(), static_cast<unsigned>(tracker.GetRejected()),
+                static_cast<unsigned>(tracker.GetRelocks()));
+    CHECK(tracker.IsLocked());
+    CHECK(checked > static_cast<int>(fx.rows.size()) / 2);
+    CHECK(max_error <= tolerance);
+}
+
+int main()
+{
+    CheckStream("fixtures/clock/cv_4ppqn.txt");
+    CheckStream("fixtures/clock/usb_midi_24ppqn.txt");
+    CheckStream("fixtures/clock/trs_midi_24ppqn.txt");
+    std::printf("\n");
+    return TEST_RESULT();
+}
@@ -0,0 +1,125 @@
+// KaliTextCache::Print() against libDaisy's WriteStringAligned(), and what
+// each costs per frame. Both draw into an OledDisplay over KaliOledDriver
+// on the emulated bus; the driver only sends pages that differ from the
+// last frame, so drawing the same thing the other way and finding nothing
+// to send means the two framebuffers are identical.
+#include <chrono>
+#include "KaliTest.h"
+#include "HostI2C.h"
+#include "KaliOledDriver.h"
+#include "KaliTextCache.h"
+
+using namespace daisy;
+using Display = OledDisplay<KaliOledDriver<I2CHandle>>;
+
+static uint8_t oled_dma[KaliOledDriver<I2CHandle>::DMA_BUFFER_SIZE];
+static Display display;
+static KaliTextCache cache;
+static host::Ssd1306 glass;
+
+static uint32_t Sent()
+{
+    display.Update();
+    host::RunI2C(20000);
+    return display.GetDriver().bytes;
+}
+
+// One options screen as Kali draws it: labels, string table entries and
+// a couple of numbers, one of them moving
+static void Screen(int frame, bool cached)
+{
+    const Rectangle screen(0, 0, 128, 32);
+    char value[32];
+    struct Label
+    {
+        const char *text;
+        Alignment alignment;
+    };
+    static const Label labels[] = {
+        {"Delay Time", Alignment::topLeft},      {"Pingpong", Alignment::topRight},
+        {"Feedback", Alignment::centeredLeft},   {"Sync: MIDI", Alignment::bottomLeft},
+        {"3/12", Alignment::bottomRight},
+    };
+    display.Fill(false);
+    for (const Label &l : labels)
+    {
+        if (cached)
+            cache.Print(display, l.text, Font_5x5, screen, l.alignment, true);
+        else
+            display.WriteStringAligned(l.text, Font_5x5, screen, l.alignment, true);
+    }
+    std::snprintf(value, sizeof(value), "%d ms", 250 + frame / 4);
+    if (cached)
+        cache.Print(display, value, Font_10x10, screen, Alignment::centeredRight, true);
+    else
+        display.WriteStringAligned(value, Font_10x10, screen, Alignment::centeredRight, true);
+}
+
+template <typename F>
+static double NsPerCall(int calls, F f)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; i++)
+        f(i);
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+}
+
+int main()
+{
+    InitFont10x10();
+    Display::Config cfg;
+    cfg.driver_config.transport_config.i2c_config.periph = I2CHandle::Config::Peripheral::I2C_1;
+    cfg.driver_config.transport_config.i2c_config.speed = I2CHandle::Config::Speed::I2C_1MHZ;
+    cfg.driver_config.transport_config.dma_buffer = oled_dma;
+    host::Bus(I2CHandle::Config::Peripheral::I2C_1).device[0x3C] = &glass;
+    display.Init(cfg);
+
+    // Same pixels: every font in use, every alignment, both polarities, a
+    // string with an unprintable char and one too long for the screen
+    const FontDef *fonts[] = {&Font_5x5, &Font_6x8, &Font_7x10, &Font_10x10};
+    const Alignment alignments[] = {Alignment::topLeft,     Alignment::topCentered,  Alignment::topRight,
+                                    Alignment::centeredLeft, Alignment::centered,    Alignment::centeredRight,
+                                    Alignment::bottomLeft,  Alignment::bottomCentered, Alignment::bottomRight};
+    const char *texts[] = {"Delay", "-12.5 dB", "A\x01" "BC", "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789", ""};
+    const Rectangle boxes[] = {Rectangle(0, 0, 128, 32), Rectangle(70, 8, 40, 16), Rectangle(120, 28, 20, 10)};
+    int cases = 0, differ = 0;
+    for (const FontDef *font : fonts)
+        for (Alignment a : alignments)
+            for (const char *text : texts)
+                for (const Rectangle &box : boxes)
+                    for (bool on : {true, false})
+                    {
+                        display.Fill(!on);
+                        display.DrawLine(0, 31, 127, 0, true); // ink under the text, which the cell overwrites
+                        display.WriteStringAligned(text, *font, box, a, on);
+                        const uint32_t before = Sent();
+                        display.Fill(!on);
+                        display.DrawLine(0, 31, 127, 0, true);
+                        cache.Print(display, text, *font, box, a, on);
+                        differ += Sent() != before;
+                        cases++;
+                    }
+    CHECK(differ == 0);
+
+    // A frame of the options screen both ways
+    const int frames = 20000;
+    for (int i = 0; i < 4; i++)
+    {
+        Screen(i, false);
+        const uint32_t before = Sent();
+        Screen(i, true);
+        CHECK(Sent() == before);
+    }
+    cache.hits = cache.misses = 0;
+    const double glyph_ns = NsPerCall(frames, [](int i) { Screen(i, false); });
+    const double cached_ns = NsPerCall(frames, [](int i) { Screen(i, true); });
+    const double fill_ns = NsPerCall(frames, [](int) { display.Fill(false); });
+
+    std::printf("\n  %d cases identical to WriteStringAligned"
+                "\n  options screen, 6 strings: %.0f ns drawing glyphs, %.0f ns from the cache (Fill alone %.0f ns)"
+                "\n  %u hits, %u misses over %d frames (the value changes every 4th frame)\n",
+                cases, glyph_ns, cached_ns, fill_ns, cache.hits, cache.misses, frames);
+    CHECK(cache.misses <= frames / 4); // one rasterization per new value, nothing else
+    CHECK(cached_ns < glyph_ns);
+    return TEST_RESULT();
+}